@@ -0,0 +1,106 @@
+// 基准测试用的 SMS-DELIVER PDU 构造器：生成带空 SMSC 信息的 PDU，与设备
+// 原始读取返回的格式一致。正文仅支持 GSM-7 与默认字母表一致的 ASCII 字符
+// （字母、数字、空格及常见标点），或任意 BMP 字符的 UCS-2。
+#ifndef PDU_BUILDER_HPP
+#define PDU_BUILDER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace pdubuilder {
+
+struct Concat {
+  int reference = 0;
+  int total = 1;
+  int number = 1;
+};
+
+// 两位十进制数按半字节交换编码
+inline uint8_t swappedBcd(int value) {
+  return static_cast<uint8_t>(((value % 10) << 4) | (value / 10 % 10));
+}
+
+inline void appendAddress(std::vector<uint8_t> &out, const std::string &number) {
+  std::string digits = number[0] == '+' ? number.substr(1) : number;
+  out.push_back(static_cast<uint8_t>(digits.size()));
+  out.push_back(number[0] == '+' ? 0x91 : 0x81);
+  for (size_t i = 0; i < digits.size(); i += 2) {
+    uint8_t lo = digits[i] - '0';
+    uint8_t hi = i + 1 < digits.size() ? digits[i + 1] - '0' : 0x0F;
+    out.push_back(static_cast<uint8_t>((hi << 4) | lo));
+  }
+}
+
+// timestamp 为 14 位 YYYYMMDDhhmmss
+inline void appendTimestamp(std::vector<uint8_t> &out,
+                            const std::string &timestamp) {
+  for (int i = 2; i < 14; i += 2) {
+    out.push_back(swappedBcd(std::stoi(timestamp.substr(i, 2))));
+  }
+  out.push_back(0x23); // UTC+8
+}
+
+inline std::vector<uint8_t> concatHeader(const Concat &concat) {
+  if (concat.total <= 1)
+    return {};
+  return {0x05, 0x00, 0x03, static_cast<uint8_t>(concat.reference),
+          static_cast<uint8_t>(concat.total),
+          static_cast<uint8_t>(concat.number)};
+}
+
+// GSM-7 正文
+inline std::vector<uint8_t> deliverGsm7(const std::string &sender,
+                                        const std::string &timestamp,
+                                        const std::string &text,
+                                        const Concat &concat = {}) {
+  std::vector<uint8_t> udh = concatHeader(concat);
+  std::vector<uint8_t> out{0x00};
+  out.push_back(udh.empty() ? 0x04 : 0x44);
+  appendAddress(out, sender);
+  out.push_back(0x00); // PID
+  out.push_back(0x00); // DCS: GSM-7
+  appendTimestamp(out, timestamp);
+
+  // UDH 之后补齐到 septet 边界
+  size_t headerSeptets = (udh.size() * 8 + 6) / 7;
+  size_t septets = headerSeptets + text.size();
+  out.push_back(static_cast<uint8_t>(septets));
+  std::vector<uint8_t> ud((septets * 7 + 7) / 8, 0);
+  for (size_t i = 0; i < udh.size(); ++i)
+    ud[i] = udh[i];
+  for (size_t i = 0; i < text.size(); ++i) {
+    size_t bit = (headerSeptets + i) * 7;
+    uint16_t septet = static_cast<uint8_t>(text[i]) & 0x7F;
+    ud[bit / 8] |= static_cast<uint8_t>(septet << (bit % 8));
+    if (bit % 8 > 1 && bit / 8 + 1 < ud.size())
+      ud[bit / 8 + 1] |= static_cast<uint8_t>(septet >> (8 - bit % 8));
+  }
+  out.insert(out.end(), ud.begin(), ud.end());
+  return out;
+}
+
+// UCS-2 正文，text 为 UTF-16 码元
+inline std::vector<uint8_t> deliverUcs2(const std::string &sender,
+                                        const std::string &timestamp,
+                                        const std::u16string &text,
+                                        const Concat &concat = {}) {
+  std::vector<uint8_t> udh = concatHeader(concat);
+  std::vector<uint8_t> out{0x00};
+  out.push_back(udh.empty() ? 0x04 : 0x44);
+  appendAddress(out, sender);
+  out.push_back(0x00); // PID
+  out.push_back(0x08); // DCS: UCS-2
+  appendTimestamp(out, timestamp);
+  out.push_back(static_cast<uint8_t>(udh.size() + text.size() * 2));
+  out.insert(out.end(), udh.begin(), udh.end());
+  for (char16_t unit : text) {
+    out.push_back(static_cast<uint8_t>(unit >> 8));
+    out.push_back(static_cast<uint8_t>(unit & 0xFF));
+  }
+  return out;
+}
+
+} // namespace pdubuilder
+
+#endif // PDU_BUILDER_HPP
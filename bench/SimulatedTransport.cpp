@@ -0,0 +1,288 @@
+#include "SimulatedTransport.hpp"
+
+#include <algorithm>
+
+using Clock = std::chrono::steady_clock;
+
+SimulatedTransport::SimulatedTransport(IoContext &io, Options options)
+    : io_(io), options_(options), rng_(options.seed) {}
+
+void SimulatedTransport::updateOccupancy() {
+  size_t total = 0;
+  for (const auto &messages : storage_) {
+    total += messages.size();
+    if (messages.size() > stats_.peakOccupancy)
+      stats_.peakOccupancy = messages.size();
+  }
+  occupancy_ = total;
+}
+
+void SimulatedTransport::preload(const std::vector<std::vector<uint8_t>> &pdus,
+                                 SmsStorage storage) {
+  auto &messages = store(storage);
+  int index = 0;
+  for (const auto &pdu : pdus) {
+    if (index >= options_.capacity)
+      break;
+    messages[index++] = StoredMessage{pdu, false};
+  }
+  updateOccupancy();
+}
+
+void SimulatedTransport::inject(std::vector<uint8_t> pdu, SmsStorage storage) {
+  io_.post([this, storage, pdu = std::move(pdu)]() mutable {
+    auto &messages = store(storage);
+    // 取最小的空闲索引
+    int index = 0;
+    for (const auto &kv : messages) {
+      if (kv.first != index)
+        break;
+      ++index;
+    }
+    if (index >= options_.capacity) {
+      ++stats_.dropped;
+      return;
+    }
+    messages[index] = StoredMessage{std::move(pdu), false};
+    updateOccupancy();
+    if (options_.indications && onNewMessage_) {
+      // 指示经过半个往返到达
+      MessageSlot slot{storage, index};
+      io_.postAfter(options_.rtt / 2, [this, slot] {
+        if (onNewMessage_)
+          onNewMessage_(slot);
+      });
+    }
+  });
+}
+
+void SimulatedTransport::wedge() {
+  io_.post([this] { wedged_ = true; });
+}
+
+bool SimulatedTransport::live(WmsClient *client, std::function<void()> fail) {
+  if (clients_.count(client))
+    return true;
+  io_.post(std::move(fail));
+  return false;
+}
+
+void SimulatedTransport::schedule(std::chrono::microseconds service,
+                                  std::function<void()> apply,
+                                  std::function<void()> onTimeout) {
+  if (wedged_) {
+    if (onTimeout)
+      hung_.push_back(std::move(onTimeout));
+    return;
+  }
+  auto now = Clock::now();
+  auto arrive = now + options_.rtt / 2;
+  auto start = std::max(arrive, busyUntil_);
+  busyUntil_ = start + service;
+  std::bernoulli_distribution lost(options_.timeoutRate);
+  if (onTimeout && lost(rng_)) {
+    ++stats_.timeouts;
+    // 按请求丢失处理：设备时间照常占用，但不改变存储内容
+    io_.postAfter(options_.timeout, std::move(onTimeout));
+    return;
+  }
+  auto respond = busyUntil_ + options_.rtt / 2;
+  io_.postAfter(
+      std::chrono::duration_cast<std::chrono::microseconds>(respond - now),
+      std::move(apply));
+}
+
+void SimulatedTransport::open(const std::string & /*devicePath*/,
+                              std::function<void(bool success)> done) {
+  schedule(options_.serviceTime, [done] { done(true); }, nullptr);
+}
+
+void SimulatedTransport::close(std::function<void()> done) {
+  // 关闭总能完成：未应答的请求以失败结束，client 全部失效
+  wedged_ = false;
+  auto hung = std::move(hung_);
+  hung_.clear();
+  for (auto &fail : hung)
+    io_.post(std::move(fail));
+  clients_.clear();
+  onNewMessage_ = nullptr;
+  schedule(options_.serviceTime, std::move(done), nullptr);
+}
+
+void SimulatedTransport::allocateClient(
+    std::function<void(WmsClient *client, WmsStatus)> done) {
+  ++stats_.allocations;
+  schedule(
+      options_.serviceTime,
+      [this, done] {
+        auto *client = reinterpret_cast<WmsClient *>(nextClientId_++);
+        clients_.insert(client);
+        done(client, WmsStatus::Ok);
+      },
+      [done] { done(nullptr, WmsStatus::Timeout); });
+}
+
+void SimulatedTransport::releaseClient(WmsClient *client,
+                                       std::function<void()> done) {
+  if (!clients_.erase(client)) {
+    io_.post(std::move(done));
+    return;
+  }
+  schedule(options_.serviceTime, std::move(done), nullptr);
+}
+
+void SimulatedTransport::listMessages(
+    WmsClient *client, SmsStorage storage, WmsMessageTag tag,
+    std::function<void(WmsStatus, std::vector<int> indices)> done) {
+  if (!live(client, [done] { done(WmsStatus::Error, {}); }))
+    return;
+  ++stats_.lists;
+  schedule(
+      options_.listServiceTime,
+      [this, storage, tag, done] {
+        if (storage == SmsStorage::Nv && !options_.nvSupported) {
+          done(WmsStatus::Error, {});
+          return;
+        }
+        bool read = tag == WmsMessageTag::Read;
+        const auto &messages = store(storage);
+        std::vector<int> indices;
+        indices.reserve(messages.size());
+        for (const auto &kv : messages) {
+          if (kv.second.read == read)
+            indices.push_back(kv.first);
+        }
+        done(WmsStatus::Ok, std::move(indices));
+      },
+      [done] { done(WmsStatus::Timeout, {}); });
+}
+
+void SimulatedTransport::rawRead(
+    WmsClient *client, MessageSlot slot,
+    std::function<void(WmsStatus, std::vector<uint8_t> pdu)> done) {
+  if (!live(client, [done] { done(WmsStatus::Error, {}); }))
+    return;
+  ++stats_.reads;
+  schedule(
+      options_.serviceTime,
+      [this, slot, done] {
+        auto &messages = store(slot.storage);
+        auto it = messages.find(slot.index);
+        if (it == messages.end()) {
+          done(WmsStatus::Error, {});
+          return;
+        }
+        done(WmsStatus::Ok, it->second.pdu);
+      },
+      [done] { done(WmsStatus::Timeout, {}); });
+}
+
+void SimulatedTransport::deleteMessage(WmsClient *client, MessageSlot slot,
+                                       std::function<void(WmsStatus)> done) {
+  if (!live(client, [done] { done(WmsStatus::Error); }))
+    return;
+  ++stats_.deletes;
+  schedule(
+      options_.serviceTime,
+      [this, slot, done] {
+        bool erased = store(slot.storage).erase(slot.index) > 0;
+        updateOccupancy();
+        done(erased ? WmsStatus::Ok : WmsStatus::Error);
+      },
+      [done] { done(WmsStatus::Timeout); });
+}
+
+void SimulatedTransport::deleteByTag(WmsClient *client, SmsStorage storage,
+                                     WmsMessageTag tag,
+                                     std::function<void(bool success)> done) {
+  if (!live(client, [done] { done(false); }))
+    return;
+  ++stats_.deletes;
+  schedule(
+      options_.serviceTime,
+      [this, storage, tag, done] {
+        bool read = tag == WmsMessageTag::Read;
+        std::erase_if(store(storage),
+                      [read](const auto &kv) { return kv.second.read == read; });
+        updateOccupancy();
+        done(true);
+      },
+      [done] { done(false); });
+}
+
+void SimulatedTransport::markRead(WmsClient *client, MessageSlot slot,
+                                  std::function<void(bool success)> done) {
+  if (!live(client, [done] { done(false); }))
+    return;
+  ++stats_.tagUpdates;
+  schedule(
+      options_.serviceTime,
+      [this, slot, done] {
+        auto &messages = store(slot.storage);
+        auto it = messages.find(slot.index);
+        if (it == messages.end()) {
+          done(false);
+          return;
+        }
+        it->second.read = true;
+        done(true);
+      },
+      [done] { done(false); });
+}
+
+void SimulatedTransport::rawSend(
+    WmsClient *client, const std::vector<uint8_t> & /*pdu*/,
+    std::function<void(WmsStatus, uint16_t messageId)> done) {
+  if (!live(client, [done] { done(WmsStatus::Error, 0); }))
+    return;
+  ++stats_.sends;
+  schedule(
+      options_.serviceTime,
+      [this, done] {
+        // 设备受理后等待网络确认，期间照常处理其他请求
+        auto now = Clock::now();
+        sendBusyUntil_ = std::max(now, sendBusyUntil_) + options_.sendTime;
+        std::bernoulli_distribution rejected(options_.sendFailRate);
+        bool ok = !rejected(rng_);
+        uint16_t messageId = ok ? nextMessageId_++ : 0;
+        io_.postAfter(std::chrono::duration_cast<std::chrono::microseconds>(
+                          sendBusyUntil_ - now),
+                      [this, done, ok, messageId] {
+                        if (ok)
+                          ++stats_.submitted;
+                        done(ok ? WmsStatus::Ok : WmsStatus::Error, messageId);
+                      });
+      },
+      [done] { done(WmsStatus::Timeout, 0); });
+}
+
+void SimulatedTransport::getStoreMaxSize(
+    WmsClient *client, SmsStorage storage,
+    std::function<void(WmsStatus, uint32_t maxSize)> done) {
+  if (!live(client, [done] { done(WmsStatus::Error, 0); }))
+    return;
+  schedule(
+      options_.serviceTime,
+      [this, storage, done] {
+        if (storage == SmsStorage::Nv && !options_.nvSupported) {
+          done(WmsStatus::Error, 0);
+          return;
+        }
+        done(WmsStatus::Ok, static_cast<uint32_t>(options_.capacity));
+      },
+      [done] { done(WmsStatus::Timeout, 0); });
+}
+
+void SimulatedTransport::registerNewMessageIndications(
+    WmsClient *client, std::function<void(MessageSlot slot)> onNewMessage,
+    std::function<void(bool success)> done) {
+  if (!live(client, [done] { done(false); }))
+    return;
+  onNewMessage_ = std::move(onNewMessage);
+  schedule(options_.serviceTime, [done] { done(true); }, nullptr);
+}
+
+void SimulatedTransport::unregisterNewMessageIndications(
+    WmsClient * /*client*/) {
+  onNewMessage_ = nullptr;
+}
@@ -0,0 +1,137 @@
+// 模拟 WMS 设备：在读取器的 I/O 线程上以定时事件模拟串行处理请求的调制解调器，
+// 可配置单次调用延迟、超时、存储内容，并可在运行中注入新短信（含分段与重复分段）。
+#ifndef SIMULATED_TRANSPORT_HPP
+#define SIMULATED_TRANSPORT_HPP
+
+#include "IoContext.hpp"
+#include "WmsTransport.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <random>
+#include <set>
+#include <vector>
+
+class SimulatedTransport : public WmsTransport {
+public:
+  struct Options {
+    int capacity = 50;                           // 每个存储的容量（条）
+    std::chrono::microseconds rtt{8000};         // 请求与应答的链路往返
+    std::chrono::microseconds serviceTime{1500}; // 设备处理单个请求的耗时
+    std::chrono::microseconds listServiceTime{3000};
+    std::chrono::microseconds timeout{50000};    // 丢失应答后报告超时的时间
+    double timeoutRate = 0.0;                    // 请求丢失的概率
+    bool indications = true;                     // 注入短信时是否发出指示
+    bool nvSupported = true; // 为 false 时列出 NV 存储返回错误
+    // 设备受理发送请求后经网络提交、收到确认的耗时；各次提交依次进行
+    std::chrono::microseconds sendTime{200000};
+    double sendFailRate = 0.0; // 提交被网络拒绝的概率
+    uint32_t seed = 1;
+  };
+
+  struct Stats {
+    std::atomic<uint64_t> lists{0};
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> deletes{0};
+    std::atomic<uint64_t> tagUpdates{0};
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> sends{0};    // 收到的发送请求
+    std::atomic<uint64_t> submitted{0}; // 网络确认的提交
+    std::atomic<uint64_t> dropped{0}; // 存储已满时丢弃的注入短信
+    std::atomic<size_t> peakOccupancy{0}; // 单个存储的最大占用
+  };
+
+  SimulatedTransport(IoContext &io, Options options);
+
+  // 在打开设备之前预置 storage 的内容，按顺序占用索引 0..n-1
+  void preload(const std::vector<std::vector<uint8_t>> &pdus,
+               SmsStorage storage = SmsStorage::Uim);
+
+  // 任意线程调用：短信到达设备的 storage 存储，占用其中最小的空闲索引并
+  // 按配置发出指示
+  void inject(std::vector<uint8_t> pdu, SmsStorage storage = SmsStorage::Uim);
+
+  // 任意线程调用：模拟设备卡死，之后的请求既不应答也不超时，直到设备被
+  // 关闭后重新打开；关闭时未应答的请求以失败结束
+  void wedge();
+
+  // 各存储中的短信总数（I/O 线程上更新）
+  size_t occupancy() const { return occupancy_; }
+  const Stats &stats() const { return stats_; }
+
+  void open(const std::string &devicePath,
+            std::function<void(bool success)> done) override;
+  void close(std::function<void()> done) override;
+  void allocateClient(
+      std::function<void(WmsClient *client, WmsStatus)> done) override;
+  void releaseClient(WmsClient *client, std::function<void()> done) override;
+  void listMessages(
+      WmsClient *client, SmsStorage storage, WmsMessageTag tag,
+      std::function<void(WmsStatus, std::vector<int> indices)> done) override;
+  void rawRead(WmsClient *client, MessageSlot slot,
+               std::function<void(WmsStatus, std::vector<uint8_t> pdu)> done)
+      override;
+  void deleteMessage(WmsClient *client, MessageSlot slot,
+                     std::function<void(WmsStatus)> done) override;
+  void deleteByTag(WmsClient *client, SmsStorage storage, WmsMessageTag tag,
+                   std::function<void(bool success)> done) override;
+  void markRead(WmsClient *client, MessageSlot slot,
+                std::function<void(bool success)> done) override;
+  void rawSend(WmsClient *client, const std::vector<uint8_t> &pdu,
+               std::function<void(WmsStatus, uint16_t messageId)> done)
+      override;
+  void getStoreMaxSize(
+      WmsClient *client, SmsStorage storage,
+      std::function<void(WmsStatus, uint32_t maxSize)> done) override;
+  void registerNewMessageIndications(
+      WmsClient *client, std::function<void(MessageSlot slot)> onNewMessage,
+      std::function<void(bool success)> done) override;
+  void unregisterNewMessageIndications(WmsClient *client) override;
+
+private:
+  // 以串行设备模型调度一次请求：apply 在应答到达时执行；请求丢失时改为
+  // 在超时后调用 onTimeout（为空则不会丢失）
+  void schedule(std::chrono::microseconds service, std::function<void()> apply,
+                std::function<void()> onTimeout);
+
+  // client 是否属于当前打开的设备；否则在下一轮事件中调用 fail
+  bool live(WmsClient *client, std::function<void()> fail);
+
+  IoContext &io_;
+  Options options_;
+  std::mt19937 rng_;
+  std::chrono::steady_clock::time_point busyUntil_{};
+  // 网络侧提交的排队，与设备处理其他请求互不阻塞
+  std::chrono::steady_clock::time_point sendBusyUntil_{};
+  uint16_t nextMessageId_ = 1;
+
+  struct StoredMessage {
+    std::vector<uint8_t> pdu;
+    bool read = false; // 标签为 MT_READ 时不再出现在未读列表中
+  };
+
+  std::map<int, StoredMessage> &store(SmsStorage storage) {
+    return storage_[static_cast<size_t>(storage)];
+  }
+  void updateOccupancy();
+
+  // 各存储的内容：索引 -> 短信，仅在 I/O 线程上访问
+  std::array<std::map<int, StoredMessage>, kSmsStorageCount> storage_;
+  std::atomic<size_t> occupancy_{0};
+  std::function<void(MessageSlot)> onNewMessage_;
+  uintptr_t nextClientId_ = 1;
+  std::set<WmsClient *> clients_;
+  // 卡死期间收到的请求的失败回调，关闭设备时调用
+  bool wedged_ = false;
+  std::vector<std::function<void()>> hung_;
+
+  Stats stats_;
+};
+
+#endif // SIMULATED_TRANSPORT_HPP
@@ -0,0 +1,134 @@
+// 基准测试用的本地桥接服务器替身：逐条确认收到的短信，并可模拟服务器的
+// 处理耗时与信用窗口。
+#ifndef STAND_IN_SERVER_HPP
+#define STAND_IN_SERVER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <ixwebsocket/IXWebSocketServer.h>
+#include <nlohmann/json.hpp>
+
+class StandInServer {
+public:
+  struct Options {
+    int port = 18008;
+    int credit = 0;     // >0 时在连接建立后授予该信用窗口
+    int serviceUs = 0;  // 每条短信的处理耗时
+  };
+
+  explicit StandInServer(Options options)
+      : options_(options), server_(options.port) {
+    server_.setOnClientMessageCallback(
+        [this](std::shared_ptr<ix::ConnectionState>, ix::WebSocket &ws,
+               const ix::WebSocketMessagePtr &msg) {
+          if (msg->type == ix::WebSocketMessageType::Open) {
+            if (options_.credit > 0) {
+              nlohmann::json frame;
+              frame["action"] = "credit";
+              frame["credit"] = options_.credit;
+              ws.send(frame.dump());
+            }
+            return;
+          }
+          if (msg->type != ix::WebSocketMessageType::Message)
+            return;
+          onFrame(ws, msg->str);
+        });
+  }
+
+  ~StandInServer() { stop(); }
+
+  bool start() {
+    auto res = server_.listen();
+    if (!res.first)
+      return false;
+    server_.start();
+    worker_ = std::thread(&StandInServer::work, this);
+    return true;
+  }
+
+  void stop() {
+    {
+      std::lock_guard lock(mutex_);
+      if (stopping_)
+        return;
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    if (worker_.joinable())
+      worker_.join();
+    server_.stop();
+  }
+
+  uint64_t frames() const { return frames_; }
+  uint64_t messages() const { return messages_; }
+
+private:
+  void onFrame(ix::WebSocket &ws, const std::string &text) {
+    auto frame = nlohmann::json::parse(text, nullptr, false);
+    if (frame.is_discarded())
+      return;
+    std::vector<uint64_t> ids;
+    std::string action = frame.value("action", "");
+    if (action == "send_message") {
+      ids.push_back(frame.value("id", uint64_t{0}));
+    } else if (action == "send_batch") {
+      for (const auto &m : frame["messages"])
+        ids.push_back(m.value("id", uint64_t{0}));
+    } else {
+      return;
+    }
+    ++frames_;
+    messages_ += ids.size();
+    std::lock_guard lock(mutex_);
+    work_.emplace_back(&ws, std::move(ids));
+    cv_.notify_one();
+  }
+
+  // 按 FIFO 串行处理，处理完一帧后以一个 ack 帧确认其中所有短信
+  void work() {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      cv_.wait(lock, [this] { return stopping_ || !work_.empty(); });
+      if (stopping_)
+        return;
+      auto [ws, ids] = std::move(work_.front());
+      work_.pop_front();
+      lock.unlock();
+      if (options_.serviceUs > 0) {
+        std::this_thread::sleep_for(
+            std::chrono::microseconds(options_.serviceUs * ids.size()));
+      }
+      nlohmann::json ack;
+      ack["action"] = "ack";
+      ack["ids"] = nlohmann::json::array();
+      for (uint64_t id : ids) {
+        if (id != 0)
+          ack["ids"].push_back(id);
+      }
+      ws->send(ack.dump());
+      lock.lock();
+    }
+  }
+
+  Options options_;
+  ix::WebSocketServer server_;
+  std::thread worker_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::pair<ix::WebSocket *, std::vector<uint64_t>>> work_;
+  bool stopping_ = false;
+  std::atomic<uint64_t> frames_{0};
+  std::atomic<uint64_t> messages_{0};
+};
+
+#endif // STAND_IN_SERVER_HPP
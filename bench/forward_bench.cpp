@@ -0,0 +1,162 @@
+// 转发基准测试：向本地桥接服务器替身突发提交短信，测量不同批大小与信用窗口
+// 下的吞吐量以及提交到确认的 p50/p99 延迟。
+//
+// 批大小为 1、信用窗口为 1 时等价于逐条发送并等待确认。
+
+#include "Forwarder.hpp"
+#include "StandInServer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <ixwebsocket/IXNetSystem.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  int messages = 2000;
+  int serviceUs = 200;
+  int port = 18008;
+  int textBytes = 140;
+};
+
+struct RunResult {
+  double elapsedMs;
+  double p50Us;
+  double p99Us;
+  uint64_t frames;
+};
+
+double percentile(std::vector<double> &samples, double p) {
+  if (samples.empty())
+    return 0.0;
+  size_t k = static_cast<size_t>(p * (samples.size() - 1));
+  std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+  return samples[k];
+}
+
+RunResult runOnce(const BenchOptions &opts, int port, size_t batch,
+                  int credit) {
+  StandInServer::Options serverOptions;
+  serverOptions.port = port;
+  serverOptions.credit = credit;
+  serverOptions.serviceUs = opts.serviceUs;
+  StandInServer server(serverOptions);
+  if (!server.start()) {
+    std::fprintf(stderr, "无法监听端口 %d\n", port);
+    std::exit(1);
+  }
+
+  Forwarder::Options options;
+  options.url = "ws://127.0.0.1:" + std::to_string(port);
+  options.secret = "bench";
+  options.creditWindow = credit;
+  options.maxBatch = batch;
+  Forwarder forwarder(options);
+
+  std::vector<Clock::time_point> submitted(opts.messages + 1);
+  std::vector<double> latencies;
+  latencies.reserve(opts.messages);
+  std::mutex mutex;
+  std::condition_variable cv;
+  forwarder.setOnAcked([&](uint64_t id, bool) {
+    auto now = Clock::now();
+    std::lock_guard lock(mutex);
+    latencies.push_back(
+        std::chrono::duration<double, std::micro>(now - submitted[id]).count());
+    cv.notify_one();
+  });
+  forwarder.start();
+  while (!forwarder.connected()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  CompleteSMS sms;
+  sms.sender = "+8613800000000";
+  sms.timestamp = "20250101120000";
+  sms.fullText.assign(opts.textBytes, 'x');
+
+  auto start = Clock::now();
+  for (int id = 1; id <= opts.messages; ++id) {
+    {
+      std::lock_guard lock(mutex);
+      submitted[id] = Clock::now();
+    }
+    forwarder.submit(id, sms);
+  }
+  {
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [&] {
+      return latencies.size() >= static_cast<size_t>(opts.messages);
+    });
+  }
+  auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start);
+  forwarder.stop();
+  server.stop();
+
+  return RunResult{elapsed.count(), percentile(latencies, 0.50),
+                   percentile(latencies, 0.99), server.frames()};
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "用法: %s [--messages N] [--service-us N] [--port N] "
+               "[--text-bytes N]\n",
+               argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  BenchOptions opts;
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (!std::strcmp(argv[i], "--messages")) {
+      opts.messages = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--service-us")) {
+      opts.serviceUs = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--port")) {
+      opts.port = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--text-bytes")) {
+      opts.textBytes = std::atoi(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  ix::initNetSystem();
+  FLAGS_logtostderr = 1;
+  FLAGS_minloglevel = 1;
+  google::InitGoogleLogging("QmiSmsForwardBench");
+
+  std::printf("messages=%d service=%dus text=%dB\n", opts.messages,
+              opts.serviceUs, opts.textBytes);
+  std::printf("%6s %7s %10s %12s %10s %10s %8s\n", "batch", "credit",
+              "elapsed_ms", "msgs/s", "p50_us", "p99_us", "frames");
+  int port = opts.port;
+  for (size_t batch : {1, 4, 16, 64}) {
+    for (int credit : {1, 8, 32, 128}) {
+      RunResult r = runOnce(opts, port++, batch, credit);
+      std::printf("%6zu %7d %10.1f %12.1f %10.0f %10.0f %8llu\n", batch,
+                  credit, r.elapsedMs, opts.messages * 1000.0 / r.elapsedMs,
+                  r.p50Us, r.p99Us,
+                  static_cast<unsigned long long>(r.frames));
+    }
+  }
+  return 0;
+}
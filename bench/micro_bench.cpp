@@ -0,0 +1,360 @@
+// 单条短信 CPU 路径微基准测试：分别测量十六进制格式化、PDU 解码、分段重组、
+// 签名与 URL 编码、转发载荷构造各阶段的 ns/op 与每次操作的内存分配次数。
+//
+// 分配计数包括全局 operator new 与 OpenSSL 内部的 CRYPTO_malloc。语料默认由
+// PduBuilder 生成（GSM-7/UCS-2 单条与三段分段短信），也可用 --corpus 指定每行
+// 一条十六进制 PDU 的录制文件。
+
+#include "Forwarder.hpp"
+#include "MessageArchive.hpp"
+#include "MultipartAssembler.hpp"
+#include "PduBuilder.hpp"
+#include "PduCodec.hpp"
+#include "SeenSet.hpp"
+#include "SignUtils.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+#include <openssl/crypto.h>
+
+namespace {
+
+std::atomic<uint64_t> gAllocations{0};
+std::atomic<uint64_t> gAllocatedBytes{0};
+
+void countAllocation(size_t size) {
+  gAllocations.fetch_add(1, std::memory_order_relaxed);
+  gAllocatedBytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void *cryptoMalloc(size_t size, const char *, int) {
+  countAllocation(size);
+  return std::malloc(size);
+}
+
+void *cryptoRealloc(void *ptr, size_t size, const char *, int) {
+  countAllocation(size);
+  return std::realloc(ptr, size);
+}
+
+void cryptoFree(void *ptr, const char *, int) { std::free(ptr); }
+
+} // namespace
+
+void *operator new(size_t size) {
+  countAllocation(size);
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  int iterations = 100000;
+  std::string corpus;
+  std::string secret = "bench-secret";
+};
+
+struct StageResult {
+  double nsPerOp;
+  double allocsPerOp;
+  double bytesPerOp;
+};
+
+// 累加被测结果并在结束时输出，防止被优化掉
+size_t gSink = 0;
+
+// 计时与分配计数的累加器，允许在每轮之间暂停以排除准备工作
+class Meter {
+public:
+  void resume() {
+    allocations_ = gAllocations.load(std::memory_order_relaxed);
+    bytes_ = gAllocatedBytes.load(std::memory_order_relaxed);
+    start_ = Clock::now();
+  }
+
+  void pause(size_t ops) {
+    elapsed_ += Clock::now() - start_;
+    totalAllocations_ += gAllocations.load(std::memory_order_relaxed) - allocations_;
+    totalBytes_ += gAllocatedBytes.load(std::memory_order_relaxed) - bytes_;
+    ops_ += ops;
+  }
+
+  StageResult result() const {
+    double ops = ops_ ? static_cast<double>(ops_) : 1.0;
+    return StageResult{
+        std::chrono::duration<double, std::nano>(elapsed_).count() / ops,
+        totalAllocations_ / ops, totalBytes_ / ops};
+  }
+
+private:
+  Clock::time_point start_;
+  Clock::duration elapsed_{};
+  uint64_t allocations_ = 0;
+  uint64_t bytes_ = 0;
+  uint64_t totalAllocations_ = 0;
+  uint64_t totalBytes_ = 0;
+  size_t ops_ = 0;
+};
+
+// 对语料逐条执行 op，共 iterations 次
+StageResult runStage(size_t iterations, size_t corpusSize,
+                     const std::function<void(size_t)> &op) {
+  Meter meter;
+  meter.resume();
+  for (size_t i = 0; i < iterations; ++i) {
+    op(i % corpusSize);
+  }
+  meter.pause(iterations);
+  return meter.result();
+}
+
+std::vector<uint8_t> parseHex(const std::string &line) {
+  std::vector<uint8_t> out;
+  for (size_t i = 0; i + 1 < line.size(); i += 2) {
+    out.push_back(
+        static_cast<uint8_t>(std::stoi(line.substr(i, 2), nullptr, 16)));
+  }
+  return out;
+}
+
+std::vector<std::vector<uint8_t>> builtinCorpus() {
+  using namespace pdubuilder;
+  std::vector<std::vector<uint8_t>> corpus;
+  const std::string sender = "+8613800138000";
+  const std::string ts = "20250101120000";
+  corpus.push_back(deliverGsm7(sender, ts, "Your verification code is 482913"));
+  corpus.push_back(deliverGsm7("10086", ts,
+                               "Balance reminder: your account balance is 23.50, "
+                               "please top up in time to avoid interruption."));
+  corpus.push_back(deliverUcs2("95588", ts,
+                               u"您的验证码为 739201，五分钟内有效，请勿泄露。"));
+  for (int n = 1; n <= 3; ++n) {
+    std::string text(153, static_cast<char>('a' + n));
+    corpus.push_back(deliverGsm7(sender, ts, text, Concat{42, 3, n}));
+  }
+  for (int n = 1; n <= 3; ++n) {
+    std::u16string text(67, static_cast<char16_t>(0x4E00 + n));
+    corpus.push_back(deliverUcs2("10010", ts, text, Concat{7, 3, n}));
+  }
+  return corpus;
+}
+
+bool loadCorpus(const std::string &path,
+                std::vector<std::vector<uint8_t>> &corpus) {
+  std::ifstream in(path);
+  if (!in)
+    return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    while (!line.empty() && (line.back() == '\r' || line.back() == ' '))
+      line.pop_back();
+    if (!line.empty())
+      corpus.push_back(parseHex(line));
+  }
+  return !corpus.empty();
+}
+
+void printResult(const char *stage, const StageResult &r) {
+  std::printf("%-14s %10.1f %10.2f %10.1f\n", stage, r.nsPerOp, r.allocsPerOp,
+              r.bytesPerOp);
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr, "用法: %s [--iterations N] [--corpus FILE]\n", argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  // 必须先于任何 OpenSSL 调用
+  CRYPTO_set_mem_functions(cryptoMalloc, cryptoRealloc, cryptoFree);
+
+  BenchOptions opts;
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (!std::strcmp(argv[i], "--iterations")) {
+      opts.iterations = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--corpus")) {
+      opts.corpus = argv[++i];
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  FLAGS_logtostderr = 1;
+  FLAGS_minloglevel = 1;
+  google::InitGoogleLogging("QmiSmsMicroBench");
+
+  std::vector<std::vector<uint8_t>> corpus;
+  if (opts.corpus.empty()) {
+    corpus = builtinCorpus();
+  } else if (!loadCorpus(opts.corpus, corpus)) {
+    std::fprintf(stderr, "无法读取语料文件: %s\n", opts.corpus.c_str());
+    return 1;
+  }
+
+  // 预先解码一遍，供后续阶段使用
+  std::vector<SMSPart> decoded;
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    SMSPart part;
+    part.slot.index = static_cast<int>(i);
+    part.rawData = corpus[i];
+    if (!pdu::decodeDeliver(part.rawData, part)) {
+      std::fprintf(stderr, "语料第 %zu 条 PDU 解码失败\n", i + 1);
+      return 1;
+    }
+    decoded.push_back(std::move(part));
+  }
+
+  std::vector<CompleteSMS> messages;
+  {
+    MultipartAssembler assembler;
+    for (const auto &part : decoded) {
+      if (auto sms = assembler.add(part)) {
+        sms->deviceId = "/dev/cdc-wdm0";
+        messages.push_back(std::move(*sms));
+      }
+    }
+  }
+  if (messages.empty()) {
+    std::fprintf(stderr, "语料中没有可组装的完整短信\n");
+    return 1;
+  }
+
+  const size_t iterations = static_cast<size_t>(opts.iterations);
+  std::printf("corpus=%zu pdus (%zu messages) iterations=%zu\n", corpus.size(),
+              messages.size(), iterations);
+  std::printf("%-14s %10s %10s %10s\n", "stage", "ns/op", "allocs/op",
+              "bytes/op");
+
+  printResult("hex", runStage(iterations, decoded.size(), [&](size_t i) {
+                gSink += decoded[i].hexPDU().size();
+              }));
+
+  // 与读取路径一致：原始 PDU 拷贝进新分段（对应从 QMI 输出取出数据）后原地解码
+  printResult("decode", runStage(iterations, corpus.size(), [&](size_t i) {
+                SMSPart part;
+                part.slot.index = static_cast<int>(i);
+                part.rawData = corpus[i];
+                pdu::decodeDeliver(part.rawData, part);
+                gSink += part.text.size();
+              }));
+
+  // 分段重组：每轮使用新的重组表，分段副本的准备不计入
+  {
+    Meter meter;
+    size_t ops = 0;
+    while (ops < iterations) {
+      std::vector<SMSPart> parts = decoded;
+      MultipartAssembler assembler;
+      meter.resume();
+      for (auto &part : parts) {
+        if (auto sms = assembler.add(std::move(part)))
+          gSink += sms->fullText.size();
+      }
+      meter.pause(parts.size());
+      ops += parts.size();
+    }
+    printResult("assemble", meter.result());
+  }
+
+  // 签名与载荷均写入复用的缓冲区，与转发路径一致；容量在第一轮后稳定
+  SignKey signKey(opts.secret);
+  std::string buffer;
+  printResult("sign", runStage(iterations, messages.size(), [&](size_t i) {
+                buffer.clear();
+                signKey.appendSign(buffer, messages[i].timestamp);
+                gSink += buffer.size();
+              }));
+
+  const std::string b64 = "q3Kf0b9zX+1w/8Jm2t7YpV4cNe6aLhGdRsWuIoE5ByM=";
+  printResult("url_encode", runStage(iterations, 1, [&](size_t) {
+                gSink += url_encode(b64).size();
+              }));
+
+  // 去重：在已写满的大表中计算指纹并插入。时间戳末位随累加值变化，
+  // 命中与淘汰交替出现
+  {
+    SeenSet seen(262144);
+    for (uint64_t i = 0; i < seen.capacity(); ++i)
+      seen.insert(i * 0x9e3779b97f4a7c15ULL + 1);
+    printResult("seen", runStage(iterations, messages.size(), [&](size_t i) {
+                  CompleteSMS &sms = messages[i];
+                  sms.timestamp.back() = static_cast<char>('0' + gSink % 10);
+                  gSink += seen.insert(SeenSet::fingerprint(sms));
+                }));
+  }
+
+  // 载荷构造含签名，与转发路径一致
+  printResult("payload", runStage(iterations, messages.size(), [&](size_t i) {
+                buffer.clear();
+                JsonWriter writer(buffer);
+                Forwarder::writePayload(writer, messages[i], signKey);
+                gSink += buffer.size();
+              }));
+
+  // 归档：追加到临时目录（小段文件，使封存也计入），之后按发件人查询。
+  // 1000 个发件人轮流出现，查询应只读取命中的记录而不扫描整个归档
+  {
+    auto dir = std::filesystem::temp_directory_path() / "qmi_sms_bench_archive";
+    std::filesystem::remove_all(dir);
+    MessageArchive::Options archiveOptions;
+    archiveOptions.directory = dir.string();
+    archiveOptions.segmentBytes = 256 << 10;
+    archiveOptions.maxBytes = 0;
+    archiveOptions.maxAge = std::chrono::hours(0);
+    MessageArchive archive(archiveOptions);
+    constexpr size_t kSenders = 1000;
+    std::vector<CompleteSMS> archived;
+    for (size_t i = 0; i < kSenders; ++i) {
+      CompleteSMS sms = messages[i % messages.size()];
+      sms.sender = "+86138" + std::to_string(10000000 + i);
+      archived.push_back(std::move(sms));
+    }
+    int64_t base = 1700000000000;
+    size_t appended = 0;
+    printResult("archive_add", runStage(iterations, kSenders, [&](size_t i) {
+                  gSink += archive.append(archived[i], base + appended++);
+                }));
+    MessageArchive::Query query;
+    query.limit = 10;
+    printResult("archive_query",
+                runStage(std::max<size_t>(iterations / 100, 1), kSenders,
+                         [&](size_t i) {
+                           query.sender = archived[i].sender;
+                           gSink += archive.query(query).size();
+                         }));
+    auto stats = archive.stats();
+    std::printf("archive: %zu segments, %llu messages, %llu bytes\n",
+                stats.segments,
+                static_cast<unsigned long long>(stats.messages),
+                static_cast<unsigned long long>(stats.bytes));
+    std::filesystem::remove_all(dir);
+  }
+
+  std::printf("checksum=%zu\n", gSink);
+  return 0;
+}
@@ -0,0 +1,48 @@
+// UCS-2 解码检查：代理对被截断或不成对时替换为 U+FFFD，解码结果始终是合法
+// 的 UTF-8（转发帧与归档查询应答直接写出这些文本）。全部通过时返回 0。
+
+#include "PduBuilder.hpp"
+#include "PduCodec.hpp"
+
+#include <cstdio>
+#include <string>
+
+namespace {
+
+int gFailures = 0;
+
+void check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "[通过]" : "[失败]", what);
+  if (!ok)
+    ++gFailures;
+}
+
+std::string decodeUcs2(const std::u16string &text) {
+  SMSPart part;
+  part.rawData =
+      pdubuilder::deliverUcs2("+8613800138000", "20250101120000", text);
+  if (!pdu::decodeDeliver(part.rawData, part))
+    return "<解码失败>";
+  return part.text;
+}
+
+} // namespace
+
+int main() {
+  const std::string replacement = "\xEF\xBF\xBD"; // U+FFFD
+
+  check(decodeUcs2(u"\xD83D\xDE00") == "\xF0\x9F\x98\x80",
+        "成对的代理项解码为补充平面字符");
+  check(decodeUcs2(u"A\xD83D") == "A" + replacement,
+        "末尾被截断的高代理项替换为 U+FFFD");
+  check(decodeUcs2(u"\xDE00" u"B") == replacement + "B",
+        "落单的低代理项替换为 U+FFFD");
+  check(decodeUcs2(u"\xD83D" u"A") == replacement + "A",
+        "后面不是低代理项的高代理项替换为 U+FFFD，后续字符保留");
+  check(decodeUcs2(u"\xDE00\xD83D") == replacement + replacement,
+        "顺序颠倒的代理项各自替换为 U+FFFD");
+  check(decodeUcs2(u"你好") == "你好", "基本平面字符不受影响");
+
+  std::printf("%s\n", gFailures == 0 ? "全部通过" : "存在失败项");
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,489 @@
+// 端到端基准测试：模拟 WMS 设备 -> QmiSmsReader -> Forwarder -> 本地桥接服务器替身。
+//
+// 第一阶段在 SIM 中预置 --sim-size 个分段（含分段短信与重复分段），测量清空
+// 整张 SIM 并全部得到服务器确认所需的时间；第二阶段以固定间隔注入新短信，
+// 测量从到达设备到服务器确认的 p50/p99 延迟。--wedge-at 使设备在注入第 N 条
+// 短信时卡死，用于测量看门狗重新打开设备所需的时间。--nv-share 将这一比例的
+// 短信放入调制解调器自身的 NV 存储，其余放在 SIM 中。以 --mark-read 或
+// --no-delete 运行并以 --capacity 设置较小的存储容量时，到达的短信会逐渐
+// 占满存储，用于验证清空模式能否避免丢弃新短信；--no-drain 作为对照。
+// --sends N 在第二阶段开始时一次排入 N 条待发送短信（其中 --multipart-rate
+// 比例为两段的长短信），测量发送吞吐量与提交延迟，同时观察到达短信的延迟
+// 是否受发送影响。
+
+#include "Forwarder.hpp"
+#include "IoContext.hpp"
+#include "PduBuilder.hpp"
+#include "SimulatedTransport.hpp"
+#include "SmsReader.hpp"
+#include "StandInServer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glog/logging.h>
+#include <ixwebsocket/IXNetSystem.h>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  int simSize = 50;
+  double multipartRate = 0.2;
+  double duplicateRate = 0.05;
+  int arrivals = 200;
+  int arrivalIntervalMs = 20;
+  int rttUs = 8000;
+  int serviceUs = 1500;
+  double timeoutRate = 0.0;
+  int readWindow = 4;
+  int serverServiceUs = 200;
+  int port = 18100;
+  bool deleteAfterRead = true;
+  bool markRead = false; // 不删除时将已转发的短信标记为已读
+  bool oneshot = false;  // 监听之前先测量一次性读取整张 SIM 的耗时
+  ListenMode mode = ListenMode::Indication;
+  int pollInterval = 1;
+  int wedgeAt = -1; // 注入第 N 条新短信时模拟设备卡死
+  double nvShare = 0.0; // 存放在 NV 存储中的短信比例
+  int capacity = 0;     // 每个存储的容量，0 表示与 sim-size 相同
+  bool drain = true;    // 存储接近占满时是否进入清空模式
+  int sends = 0;          // 第二阶段开始时排入的待发送短信数
+  double sendRate = 0.0;  // 每秒提交的发送分段数，0 表示不限速
+  int sendWindow = 2;     // 同时在途的发送请求数
+  int sendTimeUs = 20000; // 设备经网络提交一个分段的耗时
+};
+
+// 生成第 n 条短信的 PDU：单条或 3 段分段短信，重复分段追加在末尾
+std::vector<std::vector<uint8_t>> messagePdus(int n, bool multipart,
+                                              bool duplicate) {
+  std::string sender = "+86138" + std::to_string(10000000 + n % 1000);
+  std::string timestamp = "20250102030405";
+  std::string head = "#" + std::to_string(n) + " ";
+  if (!multipart) {
+    return {pdubuilder::deliverGsm7(
+        sender, timestamp, head + "Your verification code is 123456.")};
+  }
+  std::vector<std::vector<uint8_t>> pdus;
+  for (int part = 1; part <= 3; ++part) {
+    std::string text = part == 1 ? head : std::string();
+    text.resize(150, static_cast<char>('a' + part));
+    pdus.push_back(pdubuilder::deliverGsm7(sender, timestamp, text,
+                                           {n & 0xFF, 3, part}));
+  }
+  if (duplicate) {
+    pdus.push_back(pdus[1]);
+  }
+  return pdus;
+}
+
+int messageNumber(const CompleteSMS &sms) {
+  if (sms.fullText.size() < 2 || sms.fullText[0] != '#')
+    return -1;
+  return std::atoi(sms.fullText.c_str() + 1);
+}
+
+double percentile(std::vector<double> samples, double p) {
+  if (samples.empty())
+    return 0.0;
+  size_t k = static_cast<size_t>(p * (samples.size() - 1));
+  std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+  return samples[k];
+}
+
+void usage(const char *argv0) {
+  std::fprintf(
+      stderr,
+      "用法: %s [--sim-size N] [--multipart-rate P] [--duplicate-rate P]\n"
+      "          [--arrivals N] [--arrival-interval-ms N] [--rtt-us N]\n"
+      "          [--service-us N] [--timeout-rate P] [--read-window N]\n"
+      "          [--server-service-us N] [--port N] [--no-delete | --mark-read]\n"
+      "          [--polling SECONDS] [--oneshot] [--wedge-at N]\n"
+      "          [--nv-share P] [--capacity N] [--no-drain]\n"
+      "          [--sends N] [--send-rate P] [--send-window N]\n"
+      "          [--send-time-us N]\n",
+      argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  BenchOptions opts;
+  for (int i = 1; i < argc; ++i) {
+    if (!std::strcmp(argv[i], "--no-delete")) {
+      opts.deleteAfterRead = false;
+      continue;
+    }
+    if (!std::strcmp(argv[i], "--no-drain")) {
+      opts.drain = false;
+      continue;
+    }
+    if (!std::strcmp(argv[i], "--oneshot")) {
+      opts.oneshot = true;
+      continue;
+    }
+    if (!std::strcmp(argv[i], "--mark-read")) {
+      opts.deleteAfterRead = false;
+      opts.markRead = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    const char *flag = argv[i];
+    const char *value = argv[++i];
+    if (!std::strcmp(flag, "--sim-size")) {
+      opts.simSize = std::atoi(value);
+    } else if (!std::strcmp(flag, "--wedge-at")) {
+      opts.wedgeAt = std::atoi(value);
+    } else if (!std::strcmp(flag, "--capacity")) {
+      opts.capacity = std::atoi(value);
+    } else if (!std::strcmp(flag, "--nv-share")) {
+      opts.nvShare = std::atof(value);
+    } else if (!std::strcmp(flag, "--multipart-rate")) {
+      opts.multipartRate = std::atof(value);
+    } else if (!std::strcmp(flag, "--duplicate-rate")) {
+      opts.duplicateRate = std::atof(value);
+    } else if (!std::strcmp(flag, "--arrivals")) {
+      opts.arrivals = std::atoi(value);
+    } else if (!std::strcmp(flag, "--arrival-interval-ms")) {
+      opts.arrivalIntervalMs = std::atoi(value);
+    } else if (!std::strcmp(flag, "--rtt-us")) {
+      opts.rttUs = std::atoi(value);
+    } else if (!std::strcmp(flag, "--service-us")) {
+      opts.serviceUs = std::atoi(value);
+    } else if (!std::strcmp(flag, "--timeout-rate")) {
+      opts.timeoutRate = std::atof(value);
+    } else if (!std::strcmp(flag, "--read-window")) {
+      opts.readWindow = std::atoi(value);
+    } else if (!std::strcmp(flag, "--server-service-us")) {
+      opts.serverServiceUs = std::atoi(value);
+    } else if (!std::strcmp(flag, "--port")) {
+      opts.port = std::atoi(value);
+    } else if (!std::strcmp(flag, "--sends")) {
+      opts.sends = std::atoi(value);
+    } else if (!std::strcmp(flag, "--send-rate")) {
+      opts.sendRate = std::atof(value);
+    } else if (!std::strcmp(flag, "--send-window")) {
+      opts.sendWindow = std::atoi(value);
+    } else if (!std::strcmp(flag, "--send-time-us")) {
+      opts.sendTimeUs = std::atoi(value);
+    } else if (!std::strcmp(flag, "--polling")) {
+      opts.mode = ListenMode::Polling;
+      opts.pollInterval = std::atoi(value);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  ix::initNetSystem();
+  FLAGS_logtostderr = 1;
+  FLAGS_minloglevel = 1;
+  google::InitGoogleLogging("QmiSmsBench");
+
+  // 生成预置内容，直到占满 sim-size 个分段
+  std::mt19937 rng(42);
+  std::bernoulli_distribution isMultipart(opts.multipartRate);
+  std::bernoulli_distribution isDuplicate(opts.duplicateRate);
+  // 存储的选择使用单独的随机数序列，不影响短信内容的生成
+  std::mt19937 storageRng(7);
+  std::bernoulli_distribution inNv(opts.nvShare);
+  std::vector<std::vector<uint8_t>> preload;
+  std::vector<std::vector<uint8_t>> preloadNv;
+  int preloaded = 0;
+  while (true) {
+    auto pdus = messagePdus(preloaded, isMultipart(rng), isDuplicate(rng));
+    if (preload.size() + preloadNv.size() + pdus.size() >
+        static_cast<size_t>(opts.simSize))
+      break;
+    auto &target = inNv(storageRng) ? preloadNv : preload;
+    target.insert(target.end(), pdus.begin(), pdus.end());
+    ++preloaded;
+  }
+  int totalMessages = preloaded + opts.arrivals;
+
+  // 到达时间与确认时间，按短信编号索引
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::vector<Clock::time_point> arrivedAt(totalMessages);
+  std::vector<double> latenciesUs;
+  int acked = 0;
+  Clock::time_point firstAck;
+  Clock::time_point lastAck;
+  // 发送结果，在 I/O 线程上回调；读取器析构时仍可能回调，先于读取器声明
+  std::vector<double> submitUs;
+  std::vector<double> sendTotalUs;
+  int sendsDone = 0;
+  int sendsFailed = 0;
+  size_t partsSent = 0;
+  Clock::time_point lastSent;
+
+  StandInServer::Options serverOptions;
+  serverOptions.port = opts.port;
+  serverOptions.serviceUs = opts.serverServiceUs;
+  StandInServer server(serverOptions);
+  if (!server.start()) {
+    std::fprintf(stderr, "无法监听端口 %d\n", opts.port);
+    return 1;
+  }
+
+  Forwarder::Options forwardOptions;
+  forwardOptions.url = "ws://127.0.0.1:" + std::to_string(opts.port);
+  forwardOptions.secret = "bench";
+  Forwarder forwarder(forwardOptions);
+  forwarder.setOnAcked([&](uint64_t id, bool) {
+    auto now = Clock::now();
+    std::lock_guard lock(mutex);
+    int n = static_cast<int>(id) - 1;
+    if (n >= preloaded) {
+      latenciesUs.push_back(
+          std::chrono::duration<double, std::micro>(now - arrivedAt[n])
+              .count());
+    }
+    if (acked++ == 0)
+      firstAck = now;
+    lastAck = now;
+    cv.notify_all();
+  });
+  forwarder.start();
+  while (!forwarder.connected()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  IoContext io;
+  SimulatedTransport::Options deviceOptions;
+  deviceOptions.capacity =
+      std::max(opts.capacity > 0 ? opts.capacity : opts.simSize, 1);
+  deviceOptions.rtt = std::chrono::microseconds(opts.rttUs);
+  deviceOptions.serviceTime = std::chrono::microseconds(opts.serviceUs);
+  deviceOptions.listServiceTime = std::chrono::microseconds(opts.serviceUs * 2);
+  deviceOptions.timeoutRate = opts.timeoutRate;
+  deviceOptions.sendTime = std::chrono::microseconds(opts.sendTimeUs);
+  auto transport = std::make_unique<SimulatedTransport>(io, deviceOptions);
+  SimulatedTransport *device = transport.get();
+  device->preload(preload, SmsStorage::Uim);
+  device->preload(preloadNv, SmsStorage::Nv);
+
+  QmiSmsReader reader(std::move(transport), "sim0", &io);
+  reader.setReadWindow(opts.readWindow);
+  if (opts.wedgeAt >= 0) {
+    // 模拟设备的一轮读取只需几十毫秒，缩短判定时间
+    WatchdogOptions watchdog;
+    watchdog.checkInterval = std::chrono::milliseconds(100);
+    watchdog.stuckCycle = std::chrono::milliseconds(500);
+    reader.setWatchdogOptions(watchdog);
+  }
+  CapacityOptions capacity;
+  capacity.checkInterval = std::chrono::milliseconds(200);
+  capacity.drainPollInterval = std::chrono::seconds(1);
+  if (!opts.drain)
+    capacity.highWater = 2.0; // 永远达不到
+  reader.setCapacityOptions(capacity);
+  SendOptions send;
+  send.partsPerSecond = opts.sendRate;
+  send.maxInFlight = opts.sendWindow;
+  send.maxQueued = std::max<size_t>(opts.sends, 1);
+  reader.setSendOptions(send);
+
+  std::printf("sim=%zu 个分段/%d 条短信 (nv %zu 个分段) arrivals=%d "
+              "interval=%dms rtt=%dus service=%dus window=%d "
+              "timeout_rate=%.3f delete=%d mark_read=%d\n",
+              preload.size() + preloadNv.size(), preloaded, preloadNv.size(),
+              opts.arrivals, opts.arrivalIntervalMs, opts.rttUs,
+              opts.serviceUs, opts.readWindow, opts.timeoutRate,
+              opts.deleteAfterRead, opts.markRead);
+
+  if (opts.oneshot) {
+    auto start = Clock::now();
+    size_t count = reader.readAllMessages().size();
+    std::printf("oneshot: %zu 条, %.1f ms\n", count,
+                std::chrono::duration<double, std::milli>(Clock::now() - start)
+                    .count());
+  }
+
+  // 第一阶段：清空预置的 SIM
+  auto drainStart = Clock::now();
+  for (int n = 0; n < preloaded; ++n)
+    arrivedAt[n] = drainStart;
+  reader.startListening(
+      std::chrono::seconds(opts.pollInterval),
+      [&](const CompleteSMS &sms) {
+        int n = messageNumber(sms);
+        if (n < 0 || n >= totalMessages) {
+          std::fprintf(stderr, "无法识别的短信: %s\n", sms.fullText.c_str());
+          return;
+        }
+        forwarder.submit(static_cast<uint64_t>(n) + 1, sms);
+        if (opts.deleteAfterRead || reader.draining()) {
+          for (const auto &part : sms.parts)
+            reader.deleteMessageAsync(part.slot);
+        } else if (opts.markRead) {
+          for (const auto &part : sms.parts)
+            reader.markMessageRead(part.slot);
+        }
+      },
+      opts.mode);
+
+  bool drained = false;
+  double drainMs = 0;
+  double firstAckMs = 0;
+  {
+    std::unique_lock lock(mutex);
+    drained = cv.wait_for(lock, std::chrono::seconds(60),
+                          [&] { return acked >= preloaded; });
+    drainMs =
+        std::chrono::duration<double, std::milli>(lastAck - drainStart).count();
+    firstAckMs = std::chrono::duration<double, std::milli>(firstAck - drainStart)
+                     .count();
+  }
+  if (!drained) {
+    std::printf("清空超时：仅确认 %d/%d 条\n", acked, preloaded);
+  } else if (preloaded > 0) {
+    std::printf("drain: %.1f ms, %.1f msgs/s, first ack %.1f ms\n", drainMs,
+                preloaded * 1000.0 / drainMs, firstAckMs);
+  }
+
+  // 第二阶段：排入待发送的短信，之后按固定间隔注入新短信
+  auto sendStart = Clock::now();
+  for (int i = 0; i < opts.sends; ++i) {
+    std::string text = "Outbound #" + std::to_string(i) + " ";
+    text.resize(isMultipart(rng) ? 200 : 60, 'o');
+    reader.sendMessage("+8613900000000", text, [&](SendResult result) {
+      auto now = Clock::now();
+      std::lock_guard lock(mutex);
+      if (result.success) {
+        submitUs.push_back(static_cast<double>(result.submitTime.count()));
+        sendTotalUs.push_back(
+            static_cast<double>((result.queueTime + result.submitTime).count()));
+      } else {
+        ++sendsFailed;
+      }
+      partsSent += result.partsSent;
+      ++sendsDone;
+      lastSent = now;
+      cv.notify_all();
+    });
+  }
+  auto arrivalStart = Clock::now();
+  for (int i = 0; i < opts.arrivals; ++i) {
+    int n = preloaded + i;
+    auto pdus = messagePdus(n, isMultipart(rng), false);
+    {
+      std::lock_guard lock(mutex);
+      arrivedAt[n] = Clock::now();
+    }
+    if (i == opts.wedgeAt)
+      device->wedge();
+    SmsStorage storage = inNv(storageRng) ? SmsStorage::Nv : SmsStorage::Uim;
+    for (auto &pdu : pdus)
+      device->inject(std::move(pdu), storage);
+    std::this_thread::sleep_for(
+        std::chrono::milliseconds(opts.arrivalIntervalMs));
+  }
+  {
+    std::unique_lock lock(mutex);
+    bool done = cv.wait_for(lock, std::chrono::seconds(60),
+                            [&] { return acked >= totalMessages; });
+    if (!done) {
+      std::printf("到达阶段超时：仅确认 %d/%d 条\n", acked - preloaded,
+                  opts.arrivals);
+    }
+    double spanMs =
+        std::chrono::duration<double, std::milli>(lastAck - arrivalStart)
+            .count();
+    std::printf("arrivals: %zu 条, %.1f msgs/s, arrival->ack p50 %.0f us, "
+                "p99 %.0f us\n",
+                latenciesUs.size(), latenciesUs.size() * 1000.0 / spanMs,
+                percentile(latenciesUs, 0.50), percentile(latenciesUs, 0.99));
+  }
+  if (opts.sends > 0) {
+    std::unique_lock lock(mutex);
+    bool done = cv.wait_for(lock, std::chrono::seconds(600),
+                            [&] { return sendsDone >= opts.sends; });
+    if (!done) {
+      std::printf("发送超时：仅完成 %d/%d 条\n", sendsDone, opts.sends);
+    }
+    double spanS =
+        std::chrono::duration<double>(lastSent - sendStart).count();
+    std::printf("sends: %d 条 (失败 %d), %zu 个分段, %.1f msgs/s, "
+                "%.1f parts/s, submit p50 %.0f us p99 %.0f us, "
+                "queue+submit p99 %.0f ms\n",
+                sendsDone, sendsFailed, partsSent, sendsDone / spanS,
+                partsSent / spanS, percentile(submitUs, 0.50),
+                percentile(submitUs, 0.99),
+                percentile(sendTotalUs, 0.99) / 1000.0);
+  }
+
+  reader.stopListening();
+  forwarder.stop();
+  server.stop();
+
+  PipelineStats pipeline = reader.pipelineStats();
+  std::printf("pipeline: cycles=%llu delivered=%llu fetch_stalls=%llu "
+              "delivery_stalls=%llu\n",
+              static_cast<unsigned long long>(pipeline.cycles),
+              static_cast<unsigned long long>(pipeline.delivered),
+              static_cast<unsigned long long>(pipeline.fetchStalls),
+              static_cast<unsigned long long>(pipeline.deliveryStalls));
+  WatchdogStats watchdog = reader.watchdogStats();
+  std::printf("watchdog: recoveries=%llu failed=%llu last_recovery=%.1fms\n",
+              static_cast<unsigned long long>(watchdog.recoveries),
+              static_cast<unsigned long long>(watchdog.failedRecoveries),
+              watchdog.lastRecoveryTime.count() / 1000.0);
+  StartupStats startup = reader.startupStats();
+  auto sinceCreated = [&](Clock::time_point at) {
+    return std::chrono::duration<double, std::milli>(at - startup.created)
+        .count();
+  };
+  std::printf("startup: open=%.1fms clients=%.1fms listening=%.1fms "
+              "first_delivered=%.1fms backlog_read=%.1fms\n",
+              sinceCreated(startup.deviceOpened),
+              sinceCreated(startup.clientReady),
+              sinceCreated(startup.listening),
+              sinceCreated(startup.firstDelivered),
+              sinceCreated(startup.backlogRead));
+  CapacityStats capacityStats = reader.capacityStats();
+  std::printf("capacity: capacity=%d peak=%zu drain_entries=%llu "
+              "dropped=%llu\n",
+              deviceOptions.capacity, device->stats().peakOccupancy.load(),
+              static_cast<unsigned long long>(capacityStats.drainEntries),
+              static_cast<unsigned long long>(device->stats().dropped.load()));
+  RetryPolicy::Stats retry = reader.retryStats();
+  for (size_t i = 0; i < kWmsOperationCount; ++i) {
+    std::printf("retry[%s]: timeouts=%llu retries=%llu give_ups=%llu "
+                "timeout=%lldms\n",
+                wmsOperationName(static_cast<WmsOperation>(i)),
+                static_cast<unsigned long long>(retry.timeouts[i]),
+                static_cast<unsigned long long>(retry.retries[i]),
+                static_cast<unsigned long long>(retry.giveUps[i]),
+                static_cast<long long>(retry.currentTimeouts[i].count()));
+  }
+
+  const auto &stats = device->stats();
+  std::printf("device: lists=%llu reads=%llu deletes=%llu tag_updates=%llu "
+              "timeouts=%llu allocations=%llu sends=%llu submitted=%llu "
+              "dropped=%llu\n",
+              static_cast<unsigned long long>(stats.lists.load()),
+              static_cast<unsigned long long>(stats.reads.load()),
+              static_cast<unsigned long long>(stats.deletes.load()),
+              static_cast<unsigned long long>(stats.tagUpdates.load()),
+              static_cast<unsigned long long>(stats.timeouts.load()),
+              static_cast<unsigned long long>(stats.allocations.load()),
+              static_cast<unsigned long long>(stats.sends.load()),
+              static_cast<unsigned long long>(stats.submitted.load()),
+              static_cast<unsigned long long>(stats.dropped.load()));
+  return 0;
+}
@@ -0,0 +1,191 @@
+// 原始读取在途窗口的基准测试：在模拟设备上测量不同窗口大小下清空整张 SIM
+// 所需的时间。
+//
+// 模拟设备按 FIFO 串行处理请求，每条耗时 service_us；请求与响应在链路上各
+// 需要 rtt_us / 2。窗口为 1 时等价于原先逐条串行读取。
+
+#include "ReadWindow.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct BenchOptions {
+  int messages = 60;
+  int rttUs = 8000;
+  int serviceUs = 1500;
+  int timeoutUs = 50000;
+  double timeoutRate = 0.0;
+  int maxAttempts = 3;
+};
+
+// 单线程事件调度器，模拟 GMainContext 上的回调分发
+class EventLoop {
+public:
+  void schedule(Clock::time_point when, std::function<void()> fn) {
+    std::lock_guard lock(mutex_);
+    events_.push(Event{when, seq_++, std::move(fn)});
+    cv_.notify_one();
+  }
+
+  void run(const std::function<bool()> &finished) {
+    std::unique_lock lock(mutex_);
+    while (!finished()) {
+      if (events_.empty()) {
+        cv_.wait(lock);
+        continue;
+      }
+      auto when = events_.top().when;
+      if (Clock::now() < when) {
+        cv_.wait_until(lock, when);
+        continue;
+      }
+      auto fn = events_.top().fn;
+      events_.pop();
+      lock.unlock();
+      fn();
+      lock.lock();
+    }
+  }
+
+private:
+  struct Event {
+    Clock::time_point when;
+    uint64_t seq;
+    std::function<void()> fn;
+    bool operator>(const Event &o) const {
+      return when != o.when ? when > o.when : seq > o.seq;
+    }
+  };
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::priority_queue<Event, std::vector<Event>, std::greater<>> events_;
+  uint64_t seq_ = 0;
+};
+
+// 串行处理请求的模拟设备
+class SimulatedModem {
+public:
+  SimulatedModem(EventLoop &loop, const BenchOptions &opts)
+      : loop_(loop), opts_(opts), rng_(42) {}
+
+  // 发出一次读取；done(timedOut) 在响应到达或超时时被调用
+  void rawRead(std::function<void(bool)> done) {
+    auto now = Clock::now();
+    if (dist_(rng_) < opts_.timeoutRate) {
+      loop_.schedule(now + std::chrono::microseconds(opts_.timeoutUs),
+                     [done] { done(true); });
+      return;
+    }
+    auto arrive = now + std::chrono::microseconds(opts_.rttUs / 2);
+    auto start = arrive > busyUntil_ ? arrive : busyUntil_;
+    busyUntil_ = start + std::chrono::microseconds(opts_.serviceUs);
+    loop_.schedule(busyUntil_ + std::chrono::microseconds(opts_.rttUs / 2),
+                   [done] { done(false); });
+  }
+
+private:
+  EventLoop &loop_;
+  const BenchOptions &opts_;
+  Clock::time_point busyUntil_{};
+  std::mt19937 rng_;
+  std::uniform_real_distribution<double> dist_{0.0, 1.0};
+};
+
+struct RunResult {
+  double drainMs;
+  int retries;
+  int failures;
+};
+
+RunResult runOnce(const BenchOptions &opts, int windowSize) {
+  EventLoop loop;
+  SimulatedModem modem(loop, opts);
+  ReadWindow window(windowSize);
+  std::vector<MessageSlot> slots(opts.messages);
+  for (int i = 0; i < opts.messages; ++i)
+    slots[i].index = i;
+  window.reset(slots);
+
+  int retries = 0;
+  int failures = 0;
+  std::function<void()> pump;
+  std::function<void(int, int)> issue = [&](int index, int attempt) {
+    modem.rawRead([&, index, attempt](bool timedOut) {
+      if (timedOut && attempt < opts.maxAttempts) {
+        ++retries;
+        issue(index, attempt + 1);
+        return;
+      }
+      if (timedOut)
+        ++failures;
+      window.release();
+      pump();
+    });
+  };
+  pump = [&] {
+    MessageSlot slot;
+    while (window.acquire(slot))
+      issue(slot.index, 1);
+  };
+
+  auto start = Clock::now();
+  loop.schedule(start, pump);
+  loop.run([&] { return window.done(); });
+  auto elapsed = std::chrono::duration<double, std::milli>(Clock::now() - start);
+  return RunResult{elapsed.count(), retries, failures};
+}
+
+void usage(const char *argv0) {
+  std::fprintf(stderr,
+               "用法: %s [--messages N] [--rtt-us N] [--service-us N] "
+               "[--timeout-rate P]\n",
+               argv0);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  BenchOptions opts;
+  for (int i = 1; i < argc; ++i) {
+    if (i + 1 >= argc) {
+      usage(argv[0]);
+      return 1;
+    }
+    if (!std::strcmp(argv[i], "--messages")) {
+      opts.messages = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--rtt-us")) {
+      opts.rttUs = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--service-us")) {
+      opts.serviceUs = std::atoi(argv[++i]);
+    } else if (!std::strcmp(argv[i], "--timeout-rate")) {
+      opts.timeoutRate = std::atof(argv[++i]);
+    } else {
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  std::printf("messages=%d rtt=%dus service=%dus timeout_rate=%.3f\n",
+              opts.messages, opts.rttUs, opts.serviceUs, opts.timeoutRate);
+  std::printf("%8s %12s %12s %9s %9s\n", "window", "drain_ms", "msgs/s",
+              "retries", "failed");
+  for (int windowSize : {1, 2, 4, 8, 16, 32}) {
+    RunResult r = runOnce(opts, windowSize);
+    std::printf("%8d %12.1f %12.1f %9d %9d\n", windowSize, r.drainMs,
+                opts.messages * 1000.0 / r.drainMs, r.retries, r.failures);
+  }
+  return 0;
+}
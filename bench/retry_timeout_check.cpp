@@ -0,0 +1,123 @@
+// 自适应超时检查：以大量快速样本把超时时间压到下限后，设备延迟跳升到超过
+// 该超时时间，验证超时时间能随超时重新放宽到新的延迟之上（此前只有成功
+// 调用的样本参与计算，调用全部超时后超时时间再也不会变大），延迟回落后
+// 又能重新收紧。全部通过时返回 0。
+
+#include "RetryPolicy.hpp"
+
+#include <cstdio>
+
+namespace {
+
+int gFailures = 0;
+
+void check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "[通过]" : "[失败]", what);
+  if (!ok)
+    ++gFailures;
+}
+
+// 只记录超时设置的传输层，不访问设备
+class NullTransport : public WmsTransport {
+public:
+  void open(const std::string &, std::function<void(bool)> done) override {
+    done(true);
+  }
+  void close(std::function<void()> done) override { done(); }
+  void allocateClient(
+      std::function<void(WmsClient *, WmsStatus)> done) override {
+    done(nullptr, WmsStatus::Error);
+  }
+  void releaseClient(WmsClient *, std::function<void()> done) override {
+    done();
+  }
+  void listMessages(
+      WmsClient *, SmsStorage, WmsMessageTag,
+      std::function<void(WmsStatus, std::vector<int>)> done) override {
+    done(WmsStatus::Error, {});
+  }
+  void rawRead(
+      WmsClient *, MessageSlot,
+      std::function<void(WmsStatus, std::vector<uint8_t>)> done) override {
+    done(WmsStatus::Error, {});
+  }
+  void deleteMessage(WmsClient *, MessageSlot,
+                     std::function<void(WmsStatus)> done) override {
+    done(WmsStatus::Error);
+  }
+  void deleteByTag(WmsClient *, SmsStorage, WmsMessageTag,
+                   std::function<void(bool)> done) override {
+    done(false);
+  }
+  void markRead(WmsClient *, MessageSlot,
+                std::function<void(bool)> done) override {
+    done(false);
+  }
+  void rawSend(WmsClient *, const std::vector<uint8_t> &,
+               std::function<void(WmsStatus, uint16_t)> done) override {
+    done(WmsStatus::Error, 0);
+  }
+  void getStoreMaxSize(
+      WmsClient *, SmsStorage,
+      std::function<void(WmsStatus, uint32_t)> done) override {
+    done(WmsStatus::Error, 0);
+  }
+  void registerNewMessageIndications(
+      WmsClient *, std::function<void(MessageSlot)>,
+      std::function<void(bool)> done) override {
+    done(false);
+  }
+  void unregisterNewMessageIndications(WmsClient *) override {}
+};
+
+// 以固定延迟调用一次：延迟不超过当前超时时间时记为成功，否则记为超时。
+// 返回是否成功
+bool call(RetryPolicy &policy, std::chrono::milliseconds latency) {
+  constexpr WmsOperation op = WmsOperation::RawRead;
+  if (latency > policy.timeout(op)) {
+    policy.recordTimeout(op);
+    return false;
+  }
+  policy.recordLatency(op, latency);
+  return true;
+}
+
+} // namespace
+
+int main() {
+  using std::chrono::milliseconds;
+  constexpr WmsOperation op = WmsOperation::RawRead;
+  NullTransport transport;
+  RetryPolicy policy(transport);
+
+  // 快速的设备：超时时间收紧到下限
+  for (size_t i = 0; i < RetryPolicy::kLatencySamples; ++i)
+    call(policy, milliseconds(50));
+  check(policy.timeout(op) == milliseconds(1000), "快速调用把超时收紧到下限");
+  check(transport.timeout(op) == milliseconds(1000), "超时时间写入传输层");
+
+  // 延迟跳升到 3 秒：连续超时几次后超时时间超过新的延迟
+  int timeouts = 0;
+  while (!call(policy, milliseconds(3000)) && timeouts < 10)
+    ++timeouts;
+  check(timeouts > 0 && timeouts <= 2, "延迟跳升后两次超时内放宽到新延迟之上");
+
+  // 之后的调用都能成功，超时时间不会被旧样本重新压回
+  bool allSucceeded = true;
+  for (size_t i = 0; i < RetryPolicy::kLatencySamples; ++i)
+    allSucceeded = call(policy, milliseconds(3000)) && allSucceeded;
+  check(allSucceeded, "新延迟下的调用持续成功");
+  check(policy.timeout(op) == milliseconds(10000), "超时时间按新延迟放宽到上限");
+
+  // 延迟回落后重新收紧
+  for (size_t i = 0; i < RetryPolicy::kLatencySamples; ++i)
+    call(policy, milliseconds(50));
+  check(policy.timeout(op) == milliseconds(1000), "延迟回落后超时重新收紧");
+
+  check(policy.stats().timeouts[static_cast<size_t>(op)] ==
+            static_cast<uint64_t>(timeouts),
+        "超时次数计入统计");
+
+  std::printf("%s\n", gFailures == 0 ? "全部通过" : "存在失败项");
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,82 @@
+// 出站日志重启检查：在临时目录中多次打开、关闭日志，验证序号跨重启单调递增
+// （服务器以 id 作为幂等键，序号回退会使新短信被当作重复丢弃），且未确认的
+// 短信在重启后全部回放。全部通过时返回 0。
+
+#include "OutboundSpool.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+int gFailures = 0;
+
+void check(bool ok, const char *what) {
+  std::printf("%s %s\n", ok ? "[通过]" : "[失败]", what);
+  if (!ok)
+    ++gFailures;
+}
+
+CompleteSMS makeSms(int n) {
+  CompleteSMS sms;
+  sms.sender = "+8613800138000";
+  sms.timestamp = "20250101120000";
+  sms.fullText = "restart check #" + std::to_string(n);
+  sms.complete = true;
+  return sms;
+}
+
+} // namespace
+
+int main() {
+  auto dir = std::filesystem::temp_directory_path() / "qmi_sms_spool_check";
+  std::filesystem::remove_all(dir);
+  OutboundSpool::Options options;
+  options.directory = dir.string();
+
+  // 第 0 次运行：追加并全部确认
+  uint64_t last = 0;
+  {
+    OutboundSpool spool(options);
+    for (int i = 0; i < 3; ++i) {
+      last = spool.append(makeSms(i));
+      spool.waitDurable(last);
+    }
+    for (uint64_t seq = 1; seq <= last; ++seq)
+      spool.retire(seq);
+  }
+
+  // 两次空闲运行：旧段被删除，只剩空的当前段
+  for (int run = 0; run < 2; ++run) {
+    OutboundSpool spool(options);
+    check(spool.pendingCount() == 0, "空闲重启后没有待重发的短信");
+  }
+
+  // 再次追加：序号必须接着上次的最大值
+  uint64_t resumed = 0;
+  {
+    OutboundSpool spool(options);
+    resumed = spool.append(makeSms(3));
+    spool.waitDurable(resumed);
+    spool.append(makeSms(4));
+    spool.waitDurable(resumed + 1);
+    spool.retire(resumed);
+  }
+  check(resumed > last, "全部确认并空闲重启后序号不回退");
+
+  // 未确认的短信在重启后回放，且新序号大于回放的序号
+  {
+    OutboundSpool spool(options);
+    auto pending = spool.pending();
+    check(pending.size() == 1 && pending[0].first == resumed + 1 &&
+              pending[0].second.fullText == "restart check #4",
+          "未确认的短信在重启后回放");
+    check(spool.append(makeSms(5)) > resumed + 1, "回放后的新序号继续递增");
+  }
+
+  std::filesystem::remove_all(dir);
+  std::printf("%s\n", gFailures == 0 ? "全部通过" : "存在失败项");
+  return gFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,692 @@
+#include "MessageArchive.hpp"
+#include "Crc32.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 记录格式（小端）：magic u32 | 负载长度 u32 | CRC32 u32 | 负载
+// 负载：接收时间 i64 | 设备 | 发件人 | 时间戳 | 正文 | 是否完整 u8 | 分段数 |
+// 每个分段依次为位置、分段号、总分段数、参考号与 PDU。整数与长度为 LEB128
+// 变长编码，字符串与 PDU 为长度加字节
+constexpr uint32_t kRecordMagic = 0x43524151; // "QARC"
+constexpr size_t kHeaderSize = 12;
+
+void putU32(std::string &out, uint32_t v) {
+  for (int i = 0; i < 4; ++i)
+    out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void putU64(std::string &out, uint64_t v) {
+  for (int i = 0; i < 8; ++i)
+    out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void putVarint(std::string &out, uint64_t v) {
+  while (v >= 0x80) {
+    out.push_back(static_cast<char>(v | 0x80));
+    v >>= 7;
+  }
+  out.push_back(static_cast<char>(v));
+}
+
+void putBytes(std::string &out, const void *data, size_t len) {
+  putVarint(out, len);
+  out.append(static_cast<const char *>(data), len);
+}
+
+uint64_t getLE(const uint8_t *p, int bytes) {
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; ++i)
+    v |= static_cast<uint64_t>(p[i]) << (8 * i);
+  return v;
+}
+
+// 顺序读取负载字段，越界时 ok 置为 false
+struct Reader {
+  const uint8_t *p;
+  size_t left;
+  bool ok = true;
+
+  uint8_t u8() {
+    if (left < 1) {
+      ok = false;
+      return 0;
+    }
+    --left;
+    return *p++;
+  }
+
+  uint64_t u64() {
+    if (left < 8) {
+      ok = false;
+      return 0;
+    }
+    uint64_t v = getLE(p, 8);
+    p += 8;
+    left -= 8;
+    return v;
+  }
+
+  uint64_t varint() {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      uint8_t byte = u8();
+      if (!ok)
+        return 0;
+      v |= static_cast<uint64_t>(byte & 0x7F) << shift;
+      if (!(byte & 0x80))
+        return v;
+    }
+    ok = false;
+    return 0;
+  }
+
+  // 返回长度加字节字段的起始位置与长度
+  const uint8_t *bytes(size_t &len) {
+    uint64_t n = varint();
+    if (!ok || left < n) {
+      ok = false;
+      len = 0;
+      return nullptr;
+    }
+    const uint8_t *start = p;
+    len = static_cast<size_t>(n);
+    p += len;
+    left -= len;
+    return start;
+  }
+
+  std::string str() {
+    size_t len = 0;
+    const uint8_t *start = bytes(len);
+    return start ? std::string(reinterpret_cast<const char *>(start), len)
+                 : std::string();
+  }
+};
+
+std::string encodeRecord(const CompleteSMS &sms, int64_t receivedAtMs) {
+  std::string payload;
+  putU64(payload, static_cast<uint64_t>(receivedAtMs));
+  putBytes(payload, sms.deviceId.data(), sms.deviceId.size());
+  putBytes(payload, sms.sender.data(), sms.sender.size());
+  putBytes(payload, sms.timestamp.data(), sms.timestamp.size());
+  putBytes(payload, sms.fullText.data(), sms.fullText.size());
+  payload.push_back(sms.complete ? 1 : 0);
+  putVarint(payload, sms.parts.size());
+  for (const auto &part : sms.parts) {
+    // 与出站日志相同：高 8 位为存储类型，低 24 位为索引
+    putVarint(payload, (static_cast<uint32_t>(part.slot.index) & 0xFFFFFF) |
+                           (static_cast<uint32_t>(part.slot.storage) << 24));
+    putVarint(payload, static_cast<uint32_t>(part.partNumber));
+    putVarint(payload, static_cast<uint32_t>(part.totalParts));
+    putVarint(payload, static_cast<uint32_t>(part.reference));
+    putBytes(payload, part.rawData.data(), part.rawData.size());
+  }
+
+  std::string record;
+  record.reserve(kHeaderSize + payload.size());
+  putU32(record, kRecordMagic);
+  putU32(record, static_cast<uint32_t>(payload.size()));
+  putU32(record, crc32(reinterpret_cast<const uint8_t *>(payload.data()),
+                       payload.size()));
+  record += payload;
+  return record;
+}
+
+bool decodePayload(const uint8_t *data, size_t len,
+                   MessageArchive::Entry &entry) {
+  Reader r{data, len};
+  entry.receivedAtMs = static_cast<int64_t>(r.u64());
+  CompleteSMS &sms = entry.sms;
+  sms.deviceId = r.str();
+  sms.sender = r.str();
+  sms.timestamp = r.str();
+  sms.fullText = r.str();
+  sms.complete = r.u8() != 0;
+  uint64_t partCount = r.varint();
+  for (uint64_t i = 0; r.ok && i < partCount; ++i) {
+    SMSPart part;
+    auto slot = static_cast<uint32_t>(r.varint());
+    part.slot.index = static_cast<int>(slot & 0xFFFFFF);
+    part.slot.storage = static_cast<SmsStorage>(slot >> 24);
+    part.partNumber = static_cast<int>(r.varint());
+    part.totalParts = static_cast<int>(r.varint());
+    part.reference = static_cast<int>(r.varint());
+    size_t pduLen = 0;
+    const uint8_t *pdu = r.bytes(pduLen);
+    if (pdu) {
+      part.rawData.assign(pdu, pdu + pduLen);
+    }
+    sms.parts.push_back(std::move(part));
+  }
+  return r.ok;
+}
+
+// 按偏移读取并校验一条记录
+bool readRecord(int fd, uint64_t offset, MessageArchive::Entry &entry) {
+  uint8_t header[kHeaderSize];
+  if (::pread(fd, header, kHeaderSize, static_cast<off_t>(offset)) !=
+          static_cast<ssize_t>(kHeaderSize) ||
+      getLE(header, 4) != kRecordMagic) {
+    return false;
+  }
+  auto len = static_cast<size_t>(getLE(header + 4, 4));
+  std::string payload(len, '\0');
+  if (::pread(fd, payload.data(), len,
+              static_cast<off_t>(offset + kHeaderSize)) !=
+      static_cast<ssize_t>(len)) {
+    return false;
+  }
+  const auto *data = reinterpret_cast<const uint8_t *>(payload.data());
+  if (crc32(data, len) != static_cast<uint32_t>(getLE(header + 8, 4))) {
+    return false;
+  }
+  return decodePayload(data, len, entry);
+}
+
+// 发件人的 64 位 FNV-1a 散列；不同发件人可能冲突，读出记录后再比较
+uint64_t senderKey(const std::string &sender) {
+  uint64_t hash = 0xCBF29CE484222325ULL;
+  for (char c : sender) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 0x100000001B3ULL;
+  }
+  return hash;
+}
+
+// 正文前 8 个字节按大端组成的键，不足补 0。键的大小顺序与字节序一致，
+// 同一前缀的正文落在一段连续的键区间内
+uint64_t prefixKey(const std::string &text) {
+  uint64_t key = 0;
+  for (size_t i = 0; i < 8; ++i) {
+    key = (key << 8) | (i < text.size() ? static_cast<uint8_t>(text[i]) : 0);
+  }
+  return key;
+}
+
+// 前缀对应的键区间（闭区间）；前缀超过 8 字节时只用前 8 字节定位
+std::pair<uint64_t, uint64_t> prefixRange(const std::string &prefix) {
+  uint64_t lo = prefixKey(prefix);
+  if (prefix.size() >= 8) {
+    return {lo, lo};
+  }
+  return {lo, lo | ((1ULL << (8 * (8 - prefix.size()))) - 1)};
+}
+
+bool byTime(const auto &a, const auto &b) {
+  return std::tie(a.timeMs, a.offset) < std::tie(b.timeMs, b.offset);
+}
+
+bool byKey(const auto &a, const auto &b) {
+  return std::tie(a.key, a.timeMs, a.offset) <
+         std::tie(b.key, b.timeMs, b.offset);
+}
+
+// 先写临时文件再改名，避免留下写了一半的索引
+bool writeIndex(const std::string &path, const void *data, size_t bytes) {
+  std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  const char *p = static_cast<const char *>(data);
+  size_t left = bytes;
+  while (left > 0) {
+    ssize_t n = ::write(fd, p, left);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      ::close(fd);
+      ::unlink(tmp.c_str());
+      return false;
+    }
+    p += n;
+    left -= static_cast<size_t>(n);
+  }
+  bool ok = ::fdatasync(fd) == 0;
+  ::close(fd);
+  if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0) {
+    ::unlink(tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+int64_t nowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+MessageArchive::MappedIndex::~MappedIndex() {
+  if (data_) {
+    ::munmap(data_, bytes_);
+  }
+}
+
+MessageArchive::MappedIndex::MappedIndex(MappedIndex &&other) noexcept
+    : data_(std::exchange(other.data_, nullptr)),
+      bytes_(std::exchange(other.bytes_, 0)),
+      count_(std::exchange(other.count_, 0)) {}
+
+MessageArchive::MappedIndex &
+MessageArchive::MappedIndex::operator=(MappedIndex &&other) noexcept {
+  if (this != &other) {
+    if (data_) {
+      ::munmap(data_, bytes_);
+    }
+    data_ = std::exchange(other.data_, nullptr);
+    bytes_ = std::exchange(other.bytes_, 0);
+    count_ = std::exchange(other.count_, 0);
+  }
+  return *this;
+}
+
+bool MessageArchive::MappedIndex::map(const std::string &path,
+                                      size_t entrySize) {
+  *this = MappedIndex();
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st {};
+  if (::fstat(fd, &st) != 0 || st.st_size % entrySize != 0) {
+    ::close(fd);
+    return false;
+  }
+  // 空索引无需映射
+  if (st.st_size > 0) {
+    void *data = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                        MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(fd);
+      return false;
+    }
+    data_ = data;
+    bytes_ = static_cast<size_t>(st.st_size);
+    count_ = bytes_ / entrySize;
+  }
+  ::close(fd);
+  return true;
+}
+
+MessageArchive::MessageArchive(Options options) : options_(std::move(options)) {
+  std::error_code ec;
+  fs::create_directories(options_.directory, ec);
+  if (ec) {
+    throw std::runtime_error("无法创建归档目录 " + options_.directory + ": " +
+                             ec.message());
+  }
+  load();
+  if (segments_.empty() || segments_.rbegin()->second.sealed) {
+    throw std::runtime_error("无法打开归档段文件");
+  }
+  enforceRetention(nowMs());
+}
+
+MessageArchive::~MessageArchive() {
+  for (auto &[number, segment] : segments_) {
+    if (segment.fd >= 0) {
+      ::close(segment.fd);
+    }
+  }
+}
+
+std::string MessageArchive::segmentPath(uint64_t number,
+                                        const char *suffix) const {
+  char name[48];
+  snprintf(name, sizeof(name), "archive-%010llu%s",
+           static_cast<unsigned long long>(number), suffix);
+  return (fs::path(options_.directory) / name).string();
+}
+
+void MessageArchive::load() {
+  std::map<uint64_t, std::string> files;
+  for (const auto &entry : fs::directory_iterator(options_.directory)) {
+    std::string name = entry.path().filename().string();
+    unsigned long long number = 0;
+    if (name.ends_with(".dat") &&
+        sscanf(name.c_str(), "archive-%10llu", &number) == 1) {
+      files[number] = entry.path().string();
+    }
+  }
+  uint64_t activeNumber = files.empty() ? 1 : files.rbegin()->first;
+
+  for (const auto &[number, path] : files) {
+    if (number == activeNumber)
+      break;
+    Segment segment;
+    segment.path = path;
+    segment.fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (segment.fd < 0) {
+      std::cerr << "无法打开归档段 " << path << ": " << strerror(errno)
+                << std::endl;
+      continue;
+    }
+    bool mapped =
+        segment.timeIndex.map(segmentPath(number, ".tix"), sizeof(TimeEntry)) &&
+        segment.senderIndex.map(segmentPath(number, ".six"),
+                                sizeof(KeyEntry)) &&
+        segment.prefixIndex.map(segmentPath(number, ".pix"),
+                                sizeof(KeyEntry)) &&
+        segment.senderIndex.count() == segment.timeIndex.count() &&
+        segment.prefixIndex.count() == segment.timeIndex.count();
+    if (mapped) {
+      segment.sealed = true;
+      segment.messages = segment.timeIndex.count();
+      if (segment.messages > 0) {
+        segment.firstMs = segment.timeIndex.begin<TimeEntry>()->timeMs;
+        segment.lastMs = (segment.timeIndex.end<TimeEntry>() - 1)->timeMs;
+      }
+      segment.bytes = static_cast<uint64_t>(::lseek(segment.fd, 0, SEEK_END));
+    } else {
+      // 封存时中断或索引损坏，从数据文件重建
+      ActiveIndex index;
+      replay(segment, index);
+      if (!seal(number, segment, index)) {
+        std::cerr << "无法重建归档段 " << path << " 的索引" << std::endl;
+        ::close(segment.fd);
+        continue;
+      }
+    }
+    totalBytes_ += segment.bytes;
+    totalMessages_ += segment.messages;
+    segments_.emplace(number, std::move(segment));
+  }
+  openActive(activeNumber);
+}
+
+void MessageArchive::indexRecord(Segment &segment, ActiveIndex &index,
+                                 const CompleteSMS &sms, int64_t timeMs,
+                                 uint64_t offset) {
+  index.time.push_back({timeMs, offset});
+  index.sender.push_back({senderKey(sms.sender), timeMs, offset});
+  index.prefix.push_back({prefixKey(sms.fullText), timeMs, offset});
+  segment.firstMs = std::min(segment.firstMs, timeMs);
+  segment.lastMs = std::max(segment.lastMs, timeMs);
+  ++segment.messages;
+}
+
+uint64_t MessageArchive::replay(Segment &segment, ActiveIndex &index) {
+  std::ifstream in(segment.path, std::ios::binary);
+  std::string buf((std::istreambuf_iterator<char>(in)),
+                  std::istreambuf_iterator<char>());
+  const auto *data = reinterpret_cast<const uint8_t *>(buf.data());
+  size_t pos = 0;
+  while (buf.size() - pos >= kHeaderSize &&
+         getLE(data + pos, 4) == kRecordMagic) {
+    auto len = static_cast<size_t>(getLE(data + pos + 4, 4));
+    if (buf.size() - pos - kHeaderSize < len ||
+        crc32(data + pos + kHeaderSize, len) !=
+            static_cast<uint32_t>(getLE(data + pos + 8, 4))) {
+      break;
+    }
+    Entry entry;
+    if (!decodePayload(data + pos + kHeaderSize, len, entry)) {
+      break;
+    }
+    indexRecord(segment, index, entry.sms, entry.receivedAtMs, pos);
+    pos += kHeaderSize + len;
+  }
+  if (pos < buf.size()) {
+    std::cerr << "归档段 " << segment.path << " 尾部不完整，已忽略损坏部分"
+              << std::endl;
+  }
+  segment.bytes = pos;
+  return pos;
+}
+
+bool MessageArchive::openActive(uint64_t number) {
+  Segment segment;
+  segment.path = segmentPath(number, ".dat");
+  segment.fd = ::open(segment.path.c_str(),
+                      O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (segment.fd < 0) {
+    std::cerr << "无法打开归档段 " << segment.path << ": " << strerror(errno)
+              << std::endl;
+    return false;
+  }
+  active_ = ActiveIndex();
+  uint64_t valid = replay(segment, active_);
+  // 截掉损坏的尾部，否则之后追加的记录在重新加载时不可达
+  if (::lseek(segment.fd, 0, SEEK_END) > static_cast<off_t>(valid) &&
+      ::ftruncate(segment.fd, static_cast<off_t>(valid)) != 0) {
+    std::cerr << "截断归档段 " << segment.path
+              << " 失败: " << strerror(errno) << std::endl;
+  }
+  totalBytes_ += segment.bytes;
+  totalMessages_ += segment.messages;
+  segments_.emplace(number, std::move(segment));
+  return true;
+}
+
+bool MessageArchive::seal(uint64_t number, Segment &segment,
+                          ActiveIndex &index) {
+  std::sort(index.time.begin(), index.time.end(),
+            [](const TimeEntry &a, const TimeEntry &b) { return byTime(a, b); });
+  auto keyLess = [](const KeyEntry &a, const KeyEntry &b) {
+    return byKey(a, b);
+  };
+  std::sort(index.sender.begin(), index.sender.end(), keyLess);
+  std::sort(index.prefix.begin(), index.prefix.end(), keyLess);
+
+  if (!writeIndex(segmentPath(number, ".tix"), index.time.data(),
+                  index.time.size() * sizeof(TimeEntry)) ||
+      !writeIndex(segmentPath(number, ".six"), index.sender.data(),
+                  index.sender.size() * sizeof(KeyEntry)) ||
+      !writeIndex(segmentPath(number, ".pix"), index.prefix.data(),
+                  index.prefix.size() * sizeof(KeyEntry))) {
+    return false;
+  }
+  if (!segment.timeIndex.map(segmentPath(number, ".tix"), sizeof(TimeEntry)) ||
+      !segment.senderIndex.map(segmentPath(number, ".six"),
+                               sizeof(KeyEntry)) ||
+      !segment.prefixIndex.map(segmentPath(number, ".pix"),
+                               sizeof(KeyEntry))) {
+    return false;
+  }
+  // 封存后不再写入，数据一并落盘
+  ::fdatasync(segment.fd);
+  segment.sealed = true;
+  index = ActiveIndex();
+  return true;
+}
+
+bool MessageArchive::append(const CompleteSMS &sms, int64_t receivedAtMs) {
+  int64_t now = nowMs();
+  if (receivedAtMs == 0) {
+    receivedAtMs = now;
+  }
+  std::string record = encodeRecord(sms, receivedAtMs);
+
+  std::unique_lock lock(mutex_);
+  auto it = std::prev(segments_.end());
+  if (it->second.bytes >= options_.segmentBytes && !it->second.sealed) {
+    if (seal(it->first, it->second, active_)) {
+      enforceRetention(now);
+    } else {
+      // 索引写入失败时继续使用当前段，下次追加时再尝试封存
+      std::cerr << "封存归档段 " << it->second.path << " 失败" << std::endl;
+    }
+  }
+  it = std::prev(segments_.end());
+  if (it->second.sealed) {
+    if (!openActive(it->first + 1)) {
+      return false;
+    }
+    it = std::prev(segments_.end());
+  }
+
+  Segment &segment = it->second;
+  const char *p = record.data();
+  size_t left = record.size();
+  while (left > 0) {
+    ssize_t n = ::write(segment.fd, p, left);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "写入归档失败: " << strerror(errno) << std::endl;
+      // 去掉写了一半的记录
+      if (::ftruncate(segment.fd, static_cast<off_t>(segment.bytes)) != 0) {
+        std::cerr << "截断归档段 " << segment.path
+                  << " 失败: " << strerror(errno) << std::endl;
+      }
+      return false;
+    }
+    p += n;
+    left -= static_cast<size_t>(n);
+  }
+  indexRecord(segment, active_, sms, receivedAtMs, segment.bytes);
+  segment.bytes += record.size();
+  totalBytes_ += record.size();
+  ++totalMessages_;
+  return true;
+}
+
+void MessageArchive::enforceRetention(int64_t nowMs) {
+  int64_t maxAgeMs =
+      std::chrono::duration_cast<std::chrono::milliseconds>(options_.maxAge)
+          .count();
+  // 当前段不参与清理
+  while (segments_.size() > 1) {
+    auto it = segments_.begin();
+    bool tooBig = options_.maxBytes > 0 && totalBytes_ > options_.maxBytes;
+    bool tooOld = maxAgeMs > 0 && it->second.lastMs < nowMs - maxAgeMs;
+    if (!tooBig && !tooOld)
+      break;
+    removeSegment(it);
+  }
+}
+
+void MessageArchive::removeSegment(std::map<uint64_t, Segment>::iterator it) {
+  Segment &segment = it->second;
+  if (segment.fd >= 0) {
+    ::close(segment.fd);
+  }
+  for (const char *suffix : {".tix", ".six", ".pix", ".dat"}) {
+    ::unlink(segmentPath(it->first, suffix).c_str());
+  }
+  totalBytes_ -= segment.bytes;
+  totalMessages_ -= segment.messages;
+  segments_.erase(it);
+}
+
+void MessageArchive::collect(const Segment &segment, const ActiveIndex *active,
+                             const Query &query,
+                             std::vector<TimeEntry> &candidates) const {
+  auto inRange = [&](int64_t timeMs) {
+    return timeMs >= query.fromMs && timeMs < query.toMs;
+  };
+
+  // 优先使用发件人索引，其次正文前缀索引，最后时间索引
+  if (!query.sender.empty() || !query.textPrefix.empty()) {
+    bool bySender = !query.sender.empty();
+    auto [lo, hi] = bySender
+                        ? std::pair(senderKey(query.sender),
+                                    senderKey(query.sender))
+                        : prefixRange(query.textPrefix);
+    if (active) {
+      for (const auto &entry : bySender ? active->sender : active->prefix) {
+        if (entry.key >= lo && entry.key <= hi && inRange(entry.timeMs)) {
+          candidates.push_back({entry.timeMs, entry.offset});
+        }
+      }
+      return;
+    }
+    const MappedIndex &index =
+        bySender ? segment.senderIndex : segment.prefixIndex;
+    auto it = std::lower_bound(
+        index.begin<KeyEntry>(), index.end<KeyEntry>(),
+        KeyEntry{lo, query.fromMs, 0},
+        [](const KeyEntry &a, const KeyEntry &b) { return byKey(a, b); });
+    for (; it != index.end<KeyEntry>() && it->key <= hi; ++it) {
+      if (inRange(it->timeMs)) {
+        candidates.push_back({it->timeMs, it->offset});
+      }
+    }
+    return;
+  }
+
+  if (active) {
+    for (const auto &entry : active->time) {
+      if (inRange(entry.timeMs)) {
+        candidates.push_back(entry);
+      }
+    }
+    return;
+  }
+  auto it = std::lower_bound(
+      segment.timeIndex.begin<TimeEntry>(), segment.timeIndex.end<TimeEntry>(),
+      query.fromMs,
+      [](const TimeEntry &entry, int64_t timeMs) {
+        return entry.timeMs < timeMs;
+      });
+  for (; it != segment.timeIndex.end<TimeEntry>() && it->timeMs < query.toMs;
+       ++it) {
+    candidates.push_back(*it);
+  }
+}
+
+std::vector<MessageArchive::Entry>
+MessageArchive::query(const Query &query) const {
+  std::vector<Entry> result;
+  if (query.limit == 0 || query.fromMs >= query.toMs) {
+    return result;
+  }
+  std::unique_lock lock(mutex_);
+  std::vector<TimeEntry> candidates;
+  for (const auto &[number, segment] : segments_) {
+    if (segment.firstMs >= query.toMs || segment.lastMs < query.fromMs)
+      continue;
+    candidates.clear();
+    collect(segment, segment.sealed ? nullptr : &active_, query, candidates);
+    std::sort(candidates.begin(), candidates.end(),
+              [](const TimeEntry &a, const TimeEntry &b) {
+                return byTime(a, b);
+              });
+    for (const auto &candidate : candidates) {
+      Entry entry;
+      if (!readRecord(segment.fd, candidate.offset, entry)) {
+        std::cerr << "读取归档段 " << segment.path << " 偏移 "
+                  << candidate.offset << " 的记录失败" << std::endl;
+        continue;
+      }
+      // 索引键可能冲突，且只覆盖正文前 8 字节，这里逐项确认
+      if ((!query.sender.empty() && entry.sms.sender != query.sender) ||
+          (!query.textPrefix.empty() &&
+           !entry.sms.fullText.starts_with(query.textPrefix)) ||
+          (!query.deviceId.empty() && entry.sms.deviceId != query.deviceId)) {
+        continue;
+      }
+      result.push_back(std::move(entry));
+      if (result.size() >= query.limit) {
+        return result;
+      }
+    }
+  }
+  return result;
+}
+
+MessageArchive::Stats MessageArchive::stats() const {
+  std::unique_lock lock(mutex_);
+  return Stats{segments_.size(), totalBytes_, totalMessages_};
+}
@@ -0,0 +1,145 @@
+#ifndef MESSAGE_ARCHIVE_HPP
+#define MESSAGE_ARCHIVE_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "SmsTypes.hpp"
+
+// 本地短信归档。每条投递的短信（含各分段的原始 PDU）追加到段文件中，之后可
+// 按接收时间、发件人或正文前缀查询，不必向桥接服务器查询历史。
+//
+// 段文件只追加。当前段的索引保存在内存中；段写满后封存，按时间、发件人与
+// 正文前缀各写一个定长条目的有序索引文件，查询时映射到内存后二分查找。追加
+// 只写一条记录并在内存索引末尾添加条目；查询先按各段的时间范围跳过无关的段，
+// 再由索引定位候选记录，只读取候选记录。总大小超过上限或超过保留期限时，
+// 整段删除最旧的段。归档不是转发的持久化依据（出站日志才是），追加不等待落盘。
+class MessageArchive {
+public:
+  struct Options {
+    std::string directory = "archive";
+    size_t segmentBytes = 4 << 20;    // 单个段文件的滚动阈值
+    uint64_t maxBytes = 256ULL << 20; // 全部段的总大小上限，0 表示不限
+    std::chrono::hours maxAge{24 * 90}; // 保留期限，0 表示不限
+  };
+
+  // 查询条件，同时满足全部已设置的条件
+  struct Query {
+    int64_t fromMs = 0; // 接收时间下限（含），Unix 毫秒
+    int64_t toMs = std::numeric_limits<int64_t>::max(); // 上限（不含）
+    std::string sender;     // 发件人，完全匹配
+    std::string textPrefix; // 正文前缀，按字节比较
+    std::string deviceId;   // 设备标识，完全匹配
+    size_t limit = 100;
+  };
+
+  struct Entry {
+    int64_t receivedAtMs;
+    // 分段只含存储位置、分段号与原始 PDU，不含逐段解码的文本
+    CompleteSMS sms;
+  };
+
+  struct Stats {
+    size_t segments = 0;
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+  };
+
+  // 打开（必要时创建）归档目录并加载已有的段，失败抛出 std::runtime_error
+  explicit MessageArchive(Options options);
+  ~MessageArchive();
+
+  MessageArchive(const MessageArchive &) = delete;
+  MessageArchive &operator=(const MessageArchive &) = delete;
+
+  // 追加一条短信，receivedAtMs 为 0 时取当前时间；写入失败返回 false
+  bool append(const CompleteSMS &sms, int64_t receivedAtMs = 0);
+
+  // 按接收时间升序返回满足条件的短信，最多 limit 条
+  std::vector<Entry> query(const Query &query) const;
+
+  Stats stats() const;
+
+private:
+  // 时间索引条目；封存的段按时间排列。索引文件按本机字节序直接写入条目
+  struct TimeEntry {
+    int64_t timeMs;
+    uint64_t offset;
+  };
+  static_assert(sizeof(TimeEntry) == 16);
+  // 发件人与前缀索引条目；封存的段按 (key, timeMs) 排列
+  struct KeyEntry {
+    uint64_t key;
+    int64_t timeMs;
+    uint64_t offset;
+  };
+  static_assert(sizeof(KeyEntry) == 24);
+
+  // 只读映射的索引文件
+  class MappedIndex {
+  public:
+    MappedIndex() = default;
+    ~MappedIndex();
+    MappedIndex(MappedIndex &&other) noexcept;
+    MappedIndex &operator=(MappedIndex &&other) noexcept;
+    bool map(const std::string &path, size_t entrySize);
+    template <typename T> const T *begin() const {
+      return static_cast<const T *>(data_);
+    }
+    template <typename T> const T *end() const { return begin<T>() + count_; }
+    size_t count() const { return count_; }
+
+  private:
+    void *data_ = nullptr;
+    size_t bytes_ = 0;
+    size_t count_ = 0;
+  };
+
+  struct Segment {
+    std::string path; // 数据文件
+    int fd = -1;      // 当前段可读写，封存的段只读
+    uint64_t bytes = 0;
+    uint64_t messages = 0;
+    int64_t firstMs = std::numeric_limits<int64_t>::max();
+    int64_t lastMs = std::numeric_limits<int64_t>::min();
+    bool sealed = false;
+    MappedIndex timeIndex;
+    MappedIndex senderIndex;
+    MappedIndex prefixIndex;
+  };
+
+  // 当前段的内存索引，按追加顺序排列
+  struct ActiveIndex {
+    std::vector<TimeEntry> time;
+    std::vector<KeyEntry> sender;
+    std::vector<KeyEntry> prefix;
+  };
+
+  void load();
+  // 从数据文件重建索引，返回有效记录的总长度
+  uint64_t replay(Segment &segment, ActiveIndex &index);
+  static void indexRecord(Segment &segment, ActiveIndex &index,
+                          const CompleteSMS &sms, int64_t timeMs,
+                          uint64_t offset);
+  bool openActive(uint64_t number);
+  bool seal(uint64_t number, Segment &segment, ActiveIndex &index);
+  void enforceRetention(int64_t nowMs);
+  void removeSegment(std::map<uint64_t, Segment>::iterator it);
+  std::string segmentPath(uint64_t number, const char *suffix) const;
+  void collect(const Segment &segment, const ActiveIndex *active,
+               const Query &query, std::vector<TimeEntry> &candidates) const;
+
+  Options options_;
+  mutable std::mutex mutex_;
+  std::map<uint64_t, Segment> segments_; // 段号 -> 段，最后一个为当前段
+  ActiveIndex active_;
+  uint64_t totalBytes_ = 0;
+  uint64_t totalMessages_ = 0;
+};
+
+#endif // MESSAGE_ARCHIVE_HPP
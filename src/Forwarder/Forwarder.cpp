@@ -0,0 +1,370 @@
+#include "Forwarder.hpp"
+#include "SignUtils.hpp"
+
+#include <algorithm>
+#include <limits>
+
+#include <glog/logging.h>
+
+using json = nlohmann::json;
+
+Forwarder::Forwarder(Options options)
+    : options_(std::move(options)), signKey_(options_.secret),
+      credit_(options_.creditWindow) {
+  webSocket_.setUrl(options_.url);
+  if (options_.url.find("wss://") == 0) {
+    ix::SocketTLSOptions tlsOptions;
+    tlsOptions.tls = true;
+    tlsOptions.caFile = options_.caCertPath;
+    webSocket_.setTLSOptions(tlsOptions);
+  }
+  webSocket_.setOnMessageCallback(
+      [this](const ix::WebSocketMessagePtr &msg) { handleMessage(msg); });
+}
+
+Forwarder::~Forwarder() { stop(); }
+
+void Forwarder::setOnAcked(
+    std::function<void(uint64_t id, bool accepted)> onAcked) {
+  onAcked_ = std::move(onAcked);
+}
+
+void Forwarder::setOnFrame(
+    std::function<void(const nlohmann::json &)> onFrame) {
+  onFrame_ = std::move(onFrame);
+}
+
+void Forwarder::start() {
+  {
+    std::unique_lock lock(mutex_);
+    stopping_ = false;
+  }
+  sender_ = std::thread(&Forwarder::sendLoop, this);
+  webSocket_.start();
+}
+
+void Forwarder::stop() {
+  {
+    std::unique_lock lock(mutex_);
+    if (stopping_ && !sender_.joinable())
+      return;
+    stopping_ = true;
+  }
+  cv_.notify_all();
+  if (sender_.joinable())
+    sender_.join();
+  webSocket_.stop();
+}
+
+void Forwarder::submit(uint64_t id, const CompleteSMS &sms) {
+  {
+    std::unique_lock lock(mutex_);
+    queue_.push_back(Pending{id, sms, {}, 0});
+  }
+  cv_.notify_one();
+}
+
+bool Forwarder::sendFrame(const std::string &frame) {
+  if (!connected_) {
+    return false;
+  }
+  return webSocket_.send(frame).success;
+}
+
+std::optional<std::chrono::steady_clock::time_point>
+Forwarder::firstConnectedAt() const {
+  std::unique_lock lock(mutex_);
+  return firstConnectedAt_;
+}
+
+Forwarder::Stats Forwarder::stats() const {
+  std::unique_lock lock(mutex_);
+  Stats stats = stats_;
+  stats.queued = queue_.size();
+  stats.inFlight = inFlight_.size();
+  stats.credit = credit_;
+  return stats;
+}
+
+void Forwarder::writePayload(JsonWriter &writer, const CompleteSMS &sms,
+                             const SignKey &signKey) {
+  // 键按字母顺序写出；文本为合法 UTF-8 时与此前 nlohmann::json 生成的帧一致
+  writer.beginObject();
+  if (!sms.deviceId.empty()) {
+    writer.key("device");
+    writer.value(sms.deviceId);
+  }
+  if (!sms.complete) {
+    writer.key("partial");
+    writer.value(true);
+  }
+  writer.key("sender");
+  writer.value(sms.sender);
+  // 签名直接写入帧缓冲区
+  writer.key("sign");
+  writer.beginString();
+  signKey.appendSign(writer.buffer(), sms.timestamp);
+  writer.endString();
+  writer.key("text");
+  writer.value(sms.fullText);
+  writer.key("timestamp");
+  writer.value(sms.timestamp);
+  writer.endObject();
+}
+
+void Forwarder::encodeFrame(const std::vector<Pending> &batch) {
+  frame_.clear();
+  JsonWriter writer(frame_);
+  writer.beginObject();
+  writer.key("action");
+  if (batch.size() == 1) {
+    writer.value("send_message");
+    if (batch[0].id != 0) {
+      writer.key("id");
+      writer.value(batch[0].id);
+    }
+    writer.key("payload");
+    writePayload(writer, batch[0].sms, signKey_);
+  } else {
+    writer.value("send_batch");
+    writer.key("messages");
+    writer.beginArray();
+    for (const auto &p : batch) {
+      writer.beginObject();
+      if (p.id != 0) {
+        writer.key("id");
+        writer.value(p.id);
+      }
+      writer.key("payload");
+      writePayload(writer, p.sms, signKey_);
+      writer.endObject();
+    }
+    writer.endArray();
+  }
+  writer.endObject();
+}
+
+void Forwarder::handleMessage(const ix::WebSocketMessagePtr &msg) {
+  switch (msg->type) {
+  case ix::WebSocketMessageType::Open: {
+    LOG(INFO) << "[WebSocket] 连接已建立";
+    std::unique_lock lock(mutex_);
+    connected_ = true;
+    if (!firstConnectedAt_)
+      firstConnectedAt_ = std::chrono::steady_clock::now();
+    credit_ = options_.creditWindow;
+    cv_.notify_all();
+    break;
+  }
+  case ix::WebSocketMessageType::Message: {
+    json frame = json::parse(msg->str, nullptr, false);
+    if (frame.is_discarded() || !frame.is_object()) {
+      LOG(WARNING) << "[WebSocket] 无法解析的消息: " << msg->str;
+      break;
+    }
+    // 在 ixwebsocket 的回调线程上执行，格式错误的帧不能让异常逃出
+    try {
+      handleFrame(frame);
+    } catch (const json::exception &e) {
+      LOG(WARNING) << "[WebSocket] 消息格式错误: " << e.what() << ": "
+                   << msg->str;
+    }
+    break;
+  }
+  case ix::WebSocketMessageType::Error: {
+    LOG(WARNING) << "[WebSocket] 连接错误: " << msg->errorInfo.reason;
+    // 以 json 形式打印 errorInfo
+    json errorInfoJson;
+    errorInfoJson["reason"] = msg->errorInfo.reason;
+    errorInfoJson["retries"] = msg->errorInfo.retries;
+    errorInfoJson["wait_time"] = msg->errorInfo.wait_time;
+    errorInfoJson["http_status"] = msg->errorInfo.http_status;
+    errorInfoJson["decompressionError"] = msg->errorInfo.decompressionError;
+    VLOG(1) << "errorInfo: " << errorInfoJson.dump();
+    std::unique_lock lock(mutex_);
+    connected_ = false;
+    requeueInFlightLocked();
+    break;
+  }
+  case ix::WebSocketMessageType::Close: {
+    LOG(INFO) << "[WebSocket] 连接关闭";
+    std::unique_lock lock(mutex_);
+    connected_ = false;
+    requeueInFlightLocked();
+    break;
+  }
+  default:
+    break;
+  }
+}
+
+void Forwarder::handleFrame(const json &frame) {
+  std::string action = frame.value("action", "");
+  // 短信 id 只接受非负整数，其他类型的值忽略
+  auto validId = [](const json &id) { return id.is_number_unsigned(); };
+  if (action == "ack") {
+    if (frame.contains("id")) {
+      if (validId(frame["id"]))
+        acknowledge(frame["id"].get<uint64_t>(), true);
+      else
+        LOG(WARNING) << "[WebSocket] 无效的确认 id: " << frame["id"].dump();
+    }
+    if (frame.contains("ids") && frame["ids"].is_array()) {
+      for (const auto &id : frame["ids"]) {
+        if (validId(id))
+          acknowledge(id.get<uint64_t>(), true);
+        else
+          LOG(WARNING) << "[WebSocket] 无效的确认 id: " << id.dump();
+      }
+    }
+  } else if (action == "nack" && frame.contains("id")) {
+    if (!validId(frame["id"])) {
+      LOG(WARNING) << "[WebSocket] 无效的拒绝 id: " << frame["id"].dump();
+      return;
+    }
+    nacknowledge(frame["id"].get<uint64_t>(), frame.value("retry", true),
+                 frame.value("reason", ""));
+  } else if (action == "credit" && frame.contains("credit")) {
+    if (!frame["credit"].is_number_integer()) {
+      LOG(WARNING) << "[WebSocket] 无效的信用窗口: "
+                   << frame["credit"].dump();
+      return;
+    }
+    // 先按 64 位取值，超出 int 范围的窗口截断而不是溢出
+    int64_t credit = frame["credit"].get<int64_t>();
+    std::unique_lock lock(mutex_);
+    credit_ = static_cast<int>(
+        std::clamp<int64_t>(credit, 0, std::numeric_limits<int>::max()));
+    VLOG(1) << "[WebSocket] 服务器授予信用窗口: " << credit_;
+    cv_.notify_all();
+  } else if (onFrame_) {
+    onFrame_(frame);
+  } else {
+    VLOG(1) << "[WebSocket] 未处理的消息: " << frame.dump();
+  }
+}
+
+void Forwarder::acknowledge(uint64_t id, bool accepted) {
+  {
+    std::unique_lock lock(mutex_);
+    if (!inFlight_.erase(id)) {
+      // 重复确认或确认已超时重发的旧副本
+      return;
+    }
+    ++stats_.acked;
+  }
+  cv_.notify_one();
+  if (onAcked_)
+    onAcked_(id, accepted);
+}
+
+void Forwarder::nacknowledge(uint64_t id, bool retry, const std::string &reason) {
+  LOG(WARNING) << "[WebSocket] 服务器拒绝短信 " << id << ": " << reason
+               << (retry ? "，稍后重发" : "，不再重发");
+  if (!retry) {
+    {
+      std::unique_lock lock(mutex_);
+      ++stats_.nacked;
+    }
+    acknowledge(id, false);
+    return;
+  }
+  std::unique_lock lock(mutex_);
+  auto it = inFlight_.find(id);
+  if (it == inFlight_.end()) {
+    return;
+  }
+  ++stats_.nacked;
+  queue_.push_back(std::move(it->second));
+  inFlight_.erase(it);
+  cv_.notify_one();
+}
+
+void Forwarder::requeueInFlightLocked() {
+  // 按 id 逆序放回队首，保持原有顺序
+  for (auto it = inFlight_.rbegin(); it != inFlight_.rend(); ++it) {
+    queue_.push_front(std::move(it->second));
+  }
+  inFlight_.clear();
+}
+
+void Forwarder::requeueExpiredLocked(std::chrono::steady_clock::time_point now) {
+  for (auto it = inFlight_.begin(); it != inFlight_.end();) {
+    if (now - it->second.sentAt >= options_.ackTimeout) {
+      LOG(WARNING) << "[WebSocket] 短信 " << it->first << " 确认超时，重发";
+      queue_.push_back(std::move(it->second));
+      it = inFlight_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+void Forwarder::sendLoop() {
+  // 各轮复用，避免每帧重新分配
+  std::vector<Pending> batch;
+  std::vector<uint64_t> ids; // 与 batch 对应；有 id 的短信已移入在途表
+  std::unique_lock lock(mutex_);
+  while (!stopping_) {
+    auto now = std::chrono::steady_clock::now();
+    requeueExpiredLocked(now);
+
+    int available = credit_ - static_cast<int>(inFlight_.size());
+    if (!connected_ || queue_.empty() || available <= 0) {
+      cv_.wait_for(lock, std::chrono::seconds(1));
+      continue;
+    }
+
+    // 取出窗口与批大小允许的短信；空闲时单条立即发出，繁忙时积压的短信自然成批
+    size_t count = std::min({queue_.size(), static_cast<size_t>(available),
+                             std::max<size_t>(options_.maxBatch, 1)});
+    batch.clear();
+    for (size_t i = 0; i < count; ++i) {
+      batch.push_back(std::move(queue_.front()));
+      queue_.pop_front();
+    }
+    // 在释放锁之前编码并登记为在途：确认可能在 send 返回之前到达，连接
+    // 关闭时也要能把这一批放回队列
+    encodeFrame(batch);
+    now = std::chrono::steady_clock::now();
+    uint64_t resent = 0;
+    ids.clear();
+    for (auto &p : batch) {
+      if (p.attempts++ > 0)
+        ++resent;
+      ids.push_back(p.id);
+      if (p.id == 0)
+        continue;
+      p.sentAt = now;
+      uint64_t id = p.id;
+      inFlight_[id] = std::move(p);
+    }
+    lock.unlock();
+
+    bool sent = webSocket_.send(frame_).success;
+
+    lock.lock();
+    if (!sent) {
+      // 连接不可用，放回队首等待重连。已被确认、拒绝或随连接关闭放回队列
+      // 的短信不在在途表中，跳过
+      for (size_t i = batch.size(); i-- > 0;) {
+        Pending *p = &batch[i];
+        if (ids[i] != 0) {
+          auto it = inFlight_.find(ids[i]);
+          if (it == inFlight_.end())
+            continue;
+          p = &it->second;
+        }
+        --p->attempts;
+        queue_.push_front(std::move(*p));
+        if (ids[i] != 0)
+          inFlight_.erase(ids[i]);
+      }
+      cv_.wait_for(lock, std::chrono::milliseconds(100));
+      continue;
+    }
+    ++stats_.frames;
+    stats_.sent += batch.size();
+    stats_.resent += resent;
+  }
+}
@@ -0,0 +1,126 @@
+#ifndef FORWARDER_HPP
+#define FORWARDER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <ixwebsocket/IXWebSocket.h>
+#include <nlohmann/json.hpp>
+
+#include "JsonWriter.hpp"
+#include "SignUtils.hpp"
+#include "SmsTypes.hpp"
+
+// 向桥接服务器转发短信。每条短信带有 id，服务器以 ack/nack 帧逐条确认；
+// 同时在途的短信数受服务器授予的信用窗口限制，突发到达的短信在窗口允许时
+// 合并为一个 send_batch 帧发送。连接断开或确认超时的短信会被重新发送。
+// 帧由发送线程直接写入复用的缓冲区，签名复用已载入密钥的 HMAC 上下文，
+// 稳态下构造帧只有 OpenSSL 重新初始化 HMAC 时的少量分配。
+//
+// 协议（JSON 文本帧）：
+//   -> {"action":"send_message","id":N,"payload":{...}}
+//   -> {"action":"send_batch","messages":[{"id":N,"payload":{...}},...]}
+//   <- {"action":"ack","id":N} 或 {"action":"ack","ids":[N,...]}
+//   <- {"action":"nack","id":N,"reason":"...","retry":true}
+//   <- {"action":"credit","credit":N}   授予新的信用窗口
+class Forwarder {
+public:
+  struct Options {
+    std::string url;
+    std::string caCertPath;
+    std::string secret;
+    int creditWindow = 32;                 // 服务器授予信用前的初始窗口
+    size_t maxBatch = 16;                  // 单个 send_batch 帧最多携带的短信数
+    std::chrono::seconds ackTimeout{30};   // 超过该时间未确认则重发
+  };
+
+  struct Stats {
+    uint64_t sent = 0;    // 发出的短信数（含重发）
+    uint64_t frames = 0;  // 发出的帧数
+    uint64_t acked = 0;
+    uint64_t nacked = 0;
+    uint64_t resent = 0;
+    size_t queued = 0;
+    size_t inFlight = 0;
+    int credit = 0;
+  };
+
+  explicit Forwarder(Options options);
+  ~Forwarder();
+
+  Forwarder(const Forwarder &) = delete;
+  Forwarder &operator=(const Forwarder &) = delete;
+
+  // 服务器确认（或不可重试地拒绝）某条短信后调用，用于退役出站日志
+  void setOnAcked(std::function<void(uint64_t id, bool accepted)> onAcked);
+  // 非 ack/nack/credit 的服务器帧交给上层处理
+  void setOnFrame(std::function<void(const nlohmann::json &)> onFrame);
+
+  void start();
+  void stop();
+  bool connected() const { return connected_; }
+  // 首次建立连接的时刻，尚未连接过时为空
+  std::optional<std::chrono::steady_clock::time_point> firstConnectedAt() const;
+
+  // 提交一条短信。id 为 0 时只尝试发送一次，不等待确认
+  void submit(uint64_t id, const CompleteSMS &sms);
+
+  // 直接发送一个文本帧（用于对服务器请求的应答）
+  bool sendFrame(const std::string &frame);
+
+  Stats stats() const;
+
+  // 写入单条短信的 payload 对象（含签名）
+  static void writePayload(JsonWriter &writer, const CompleteSMS &sms,
+                           const SignKey &signKey);
+
+private:
+  struct Pending {
+    uint64_t id;
+    CompleteSMS sms;
+    std::chrono::steady_clock::time_point sentAt;
+    int attempts = 0;
+  };
+
+  void handleMessage(const ix::WebSocketMessagePtr &msg);
+  void handleFrame(const nlohmann::json &frame);
+  void acknowledge(uint64_t id, bool accepted);
+  void nacknowledge(uint64_t id, bool retry, const std::string &reason);
+  void requeueInFlightLocked();
+  void requeueExpiredLocked(std::chrono::steady_clock::time_point now);
+  void sendLoop();
+  // 将一批短信编码为 frame_
+  void encodeFrame(const std::vector<Pending> &batch);
+
+  Options options_;
+  SignKey signKey_;
+  ix::WebSocket webSocket_;
+  std::function<void(uint64_t, bool)> onAcked_;
+  std::function<void(const nlohmann::json &)> onFrame_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Pending> queue_;
+  std::map<uint64_t, Pending> inFlight_;
+  int credit_;
+  std::atomic<bool> connected_{false};
+  std::optional<std::chrono::steady_clock::time_point> firstConnectedAt_;
+  bool stopping_ = false;
+  std::thread sender_;
+  // 仅在发送线程上使用，各帧之间复用容量
+  std::string frame_;
+
+  Stats stats_;
+};
+
+#endif // FORWARDER_HPP
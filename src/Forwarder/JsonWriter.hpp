@@ -0,0 +1,173 @@
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+
+#include <charconv>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// 直接向字符串追加 JSON 文本的写入器，用于转发路径上构造帧：不建立中间的
+// 对象树，缓冲区在各帧之间复用，容量稳定后不再分配内存。
+//
+// 调用方负责按 JSON 语法依次调用：对象中先 key 再写值，数组中直接写值。
+// 字符串的转义规则与 nlohmann::json::dump 相同（合法的 UTF-8 多字节序列
+// 原样写出），对合法 UTF-8 文本按相同顺序写入键时输出与 dump 逐字节一致。
+// 与 dump 不同的是，无效的 UTF-8 字节不抛出异常，逐字节替换为 U+FFFD，
+// 保证帧始终是合法的 JSON。
+class JsonWriter {
+public:
+  explicit JsonWriter(std::string &out) : out_(out) {}
+
+  void beginObject() {
+    separate();
+    out_.push_back('{');
+    needComma_ = false;
+  }
+  void endObject() {
+    out_.push_back('}');
+    needComma_ = true;
+  }
+  void beginArray() {
+    separate();
+    out_.push_back('[');
+    needComma_ = false;
+  }
+  void endArray() {
+    out_.push_back(']');
+    needComma_ = true;
+  }
+
+  void key(std::string_view name) {
+    separate();
+    appendQuoted(name);
+    out_.push_back(':');
+    needComma_ = false;
+  }
+
+  void value(std::string_view text) {
+    separate();
+    appendQuoted(text);
+    needComma_ = true;
+  }
+  void value(const char *text) { value(std::string_view(text)); }
+  void value(bool flag) {
+    separate();
+    out_.append(flag ? "true" : "false");
+    needComma_ = true;
+  }
+  void value(uint64_t number) {
+    separate();
+    char digits[20];
+    auto end = std::to_chars(digits, digits + sizeof(digits), number).ptr;
+    out_.append(digits, end);
+    needComma_ = true;
+  }
+
+  // 写一个内容由调用方直接追加到 buffer() 的字符串值，内容不经转义，
+  // 只能含无需转义的字符
+  void beginString() {
+    separate();
+    out_.push_back('"');
+  }
+  void endString() {
+    out_.push_back('"');
+    needComma_ = true;
+  }
+  std::string &buffer() { return out_; }
+
+private:
+  void separate() {
+    if (needComma_)
+      out_.push_back(',');
+  }
+
+  void appendQuoted(std::string_view text) {
+    static constexpr char kHexDigits[] = "0123456789abcdef";
+    out_.push_back('"');
+    size_t plain = 0; // 尚未写出的无需转义的字节从这里开始
+    for (size_t i = 0; i < text.size(); ++i) {
+      unsigned char c = static_cast<unsigned char>(text[i]);
+      if (c >= 0x80) {
+        size_t length = utf8Length(text, i);
+        if (length > 0) {
+          i += length - 1;
+          continue;
+        }
+        out_.append(text.data() + plain, i - plain);
+        plain = i + 1;
+        out_.append("\xEF\xBF\xBD"); // U+FFFD
+        continue;
+      }
+      if (c >= 0x20 && c != '"' && c != '\\')
+        continue;
+      out_.append(text.data() + plain, i - plain);
+      plain = i + 1;
+      out_.push_back('\\');
+      switch (c) {
+      case '"':
+        out_.push_back('"');
+        break;
+      case '\\':
+        out_.push_back('\\');
+        break;
+      case '\b':
+        out_.push_back('b');
+        break;
+      case '\f':
+        out_.push_back('f');
+        break;
+      case '\n':
+        out_.push_back('n');
+        break;
+      case '\r':
+        out_.push_back('r');
+        break;
+      case '\t':
+        out_.push_back('t');
+        break;
+      default: {
+        char escaped[5] = {'u', '0', '0', kHexDigits[c >> 4],
+                           kHexDigits[c & 0x0F]};
+        out_.append(escaped, 5);
+        break;
+      }
+      }
+    }
+    out_.append(text.data() + plain, text.size() - plain);
+    out_.push_back('"');
+  }
+
+  // text[pos] 开始的合法 UTF-8 多字节序列的长度（RFC 3629：不含超长编码、
+  // 代理项与超出 U+10FFFF 的码点），无效时为 0
+  static size_t utf8Length(std::string_view text, size_t pos) {
+    auto at = [&](size_t offset) -> unsigned {
+      return pos + offset < text.size()
+                 ? static_cast<unsigned char>(text[pos + offset])
+                 : 0;
+    };
+    auto continuation = [](unsigned c) { return (c & 0xC0) == 0x80; };
+    unsigned lead = at(0);
+    unsigned second = at(1);
+    if (lead >= 0xC2 && lead <= 0xDF)
+      return continuation(second) ? 2 : 0;
+    if (lead >= 0xE0 && lead <= 0xEF) {
+      unsigned low = lead == 0xE0 ? 0xA0 : 0x80;
+      unsigned high = lead == 0xED ? 0x9F : 0xBF;
+      return second >= low && second <= high && continuation(at(2)) ? 3 : 0;
+    }
+    if (lead >= 0xF0 && lead <= 0xF4) {
+      unsigned low = lead == 0xF0 ? 0x90 : 0x80;
+      unsigned high = lead == 0xF4 ? 0x8F : 0xBF;
+      return second >= low && second <= high && continuation(at(2)) &&
+                     continuation(at(3))
+                 ? 4
+                 : 0;
+    }
+    return 0;
+  }
+
+  std::string &out_;
+  bool needComma_ = false; // 下一个键或值之前需要逗号
+};
+
+#endif // JSON_WRITER_HPP
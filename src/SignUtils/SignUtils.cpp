@@ -1,45 +1,147 @@
 #include "SignUtils.hpp"
-#include <cctype>
-#include <cppcodec/base64_default_rfc4648.hpp>
-#include <iomanip>
+
+#include <atomic>
+#include <cstdint>
+#include <openssl/core_names.h>
 #include <openssl/evp.h>
-#include <openssl/hmac.h>
-#include <sstream>
+#include <stdexcept>
 
 namespace {
+
+constexpr char kHexDigits[] = "0123456789ABCDEF";
+constexpr char kBase64Alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+bool isUnreserved(unsigned char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') ||
+         (c >= '0' && c <= '9') || c == '-' || c == '_' || c == '.' ||
+         c == '~';
+}
+
+void appendEscaped(std::string &out, unsigned char c) {
+  if (isUnreserved(c)) {
+    out.push_back(static_cast<char>(c));
+  } else {
+    char escaped[3] = {'%', kHexDigits[c >> 4], kHexDigits[c & 0x0F]};
+    out.append(escaped, 3);
+  }
+}
+
+// base64 编码 data 并直接以 URL 编码形式追加到 out
+void appendBase64UrlEncoded(std::string &out, const unsigned char *data,
+                            size_t len) {
+  size_t i = 0;
+  for (; i + 3 <= len; i += 3) {
+    uint32_t v = (data[i] << 16) | (data[i + 1] << 8) | data[i + 2];
+    appendEscaped(out, kBase64Alphabet[(v >> 18) & 0x3F]);
+    appendEscaped(out, kBase64Alphabet[(v >> 12) & 0x3F]);
+    appendEscaped(out, kBase64Alphabet[(v >> 6) & 0x3F]);
+    appendEscaped(out, kBase64Alphabet[v & 0x3F]);
+  }
+  if (i < len) {
+    uint32_t v = data[i] << 16;
+    if (i + 1 < len)
+      v |= data[i + 1] << 8;
+    appendEscaped(out, kBase64Alphabet[(v >> 18) & 0x3F]);
+    appendEscaped(out, kBase64Alphabet[(v >> 12) & 0x3F]);
+    appendEscaped(out, i + 1 < len ? kBase64Alphabet[(v >> 6) & 0x3F] : '=');
+    appendEscaped(out, '=');
+  }
+}
+
+} // namespace
+
+struct SignKey::State {
+  EVP_MAC *mac = nullptr;
+  EVP_MAC_CTX *keyed = nullptr; // 已设置摘要与密钥，只作为各线程复制的模板
+  uint64_t id = 0;              // 区分线程缓存的上下文属于哪个密钥
+
+  ~State() {
+    EVP_MAC_CTX_free(keyed);
+    EVP_MAC_free(mac);
+  }
+};
+
+namespace {
+
+std::atomic<uint64_t> gNextKeyId{1};
+
+// 每个线程缓存一个已载入密钥的上下文。首次使用（或换用其他密钥）时从
+// 模板复制，之后每次签名只以已保存的密钥重新初始化
+struct ThreadMac {
+  uint64_t keyId = 0;
+  EVP_MAC_CTX *ctx = nullptr;
+
+  ~ThreadMac() { EVP_MAC_CTX_free(ctx); }
+};
+
+thread_local ThreadMac tThreadMac;
+
+} // namespace
+
+SignKey::SignKey(const std::string &secret)
+    : state_(std::make_unique<State>()), secret_(secret) {
+  state_->id = gNextKeyId.fetch_add(1, std::memory_order_relaxed);
+  state_->mac = EVP_MAC_fetch(nullptr, OSSL_MAC_NAME_HMAC, nullptr);
+  if (state_->mac)
+    state_->keyed = EVP_MAC_CTX_new(state_->mac);
+  char digest[] = "SHA256";
+  OSSL_PARAM params[] = {
+      OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+      OSSL_PARAM_construct_end()};
+  if (!state_->keyed ||
+      !EVP_MAC_init(state_->keyed,
+                    reinterpret_cast<const unsigned char *>(secret.data()),
+                    secret.size(), params)) {
+    throw std::runtime_error("无法初始化 HMAC-SHA256");
+  }
+}
+
+SignKey::~SignKey() = default;
+
+void SignKey::appendSign(std::string &out, std::string_view timestamp) const {
+  ThreadMac &local = tThreadMac;
+  if (local.keyId != state_->id) {
+    EVP_MAC_CTX_free(local.ctx);
+    local.ctx = EVP_MAC_CTX_dup(state_->keyed);
+    local.keyId = local.ctx ? state_->id : 0;
+  }
+  unsigned char digest[EVP_MAX_MD_SIZE];
+  size_t len = 0;
+  // 不传密钥时沿用上下文中已载入的密钥，只重置消息状态
+  if (!local.ctx || !EVP_MAC_init(local.ctx, nullptr, 0, nullptr) ||
+      !EVP_MAC_update(local.ctx,
+                      reinterpret_cast<const unsigned char *>(timestamp.data()),
+                      timestamp.size()) ||
+      !EVP_MAC_update(local.ctx,
+                      reinterpret_cast<const unsigned char *>("\n"), 1) ||
+      !EVP_MAC_update(local.ctx,
+                      reinterpret_cast<const unsigned char *>(secret_.data()),
+                      secret_.size()) ||
+      !EVP_MAC_final(local.ctx, digest, &len, sizeof(digest))) {
+    throw std::runtime_error("HMAC-SHA256 计算失败");
+  }
+  appendBase64UrlEncoded(out, digest, len);
+}
+
 std::string url_encode(const std::string &value) {
-  std::ostringstream escaped;
-  escaped.fill('0');
-  escaped << std::hex;
+  std::string escaped;
+  escaped.reserve(value.size() * 3);
   for (unsigned char c : value) {
-    if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-      escaped << c;
-    } else {
-      escaped << '%' << std::setw(2) << std::uppercase << int(c);
-    }
+    appendEscaped(escaped, c);
   }
-  return escaped.str();
+  return escaped;
 }
-} // namespace
 
 std::string generateSign(const std::string &timestamp,
                          const std::string &secret) {
-  std::string signStr = timestamp + "\n" + secret;
-
-  unsigned int len = 0;
-  unsigned char *hmac_result = HMAC(
-      EVP_sha256(), reinterpret_cast<const unsigned char *>(secret.data()),
-      secret.size(), reinterpret_cast<const unsigned char *>(signStr.data()),
-      signStr.size(), nullptr, &len);
-  if (!hmac_result)
-    return "";
-
-  std::string b64Sign = cppcodec::base64_rfc4648::encode(hmac_result, len);
-  return url_encode(b64Sign);
+  std::string sign;
+  SignKey(secret).appendSign(sign, timestamp);
+  return sign;
 }
 
 bool validateSign(const std::string &timestamp, const std::string &sign,
                   const std::string &secret) {
   std::string expected = generateSign(timestamp, secret);
   return (expected == sign);
-}
\ No newline at end of file
+}
@@ -1,9 +1,33 @@
 #ifndef SIGN_UTILS_HPP
 #define SIGN_UTILS_HPP
 
+#include <memory>
 #include <string>
+#include <string_view>
 
 bool validateSign(const std::string &timestamp, const std::string &sign, const std::string &secret);
 std::string generateSign(const std::string &timestamp, const std::string &secret);
+std::string url_encode(const std::string &value);
 
-#endif // SIGN_UTILS_HPP
\ No newline at end of file
+// 以固定密钥计算签名。构造时载入密钥得到 HMAC-SHA256 上下文，各线程复制
+// 一份后缓存，每次签名只以已载入的密钥重新初始化，不再重复获取算法、派生
+// 密钥。签名串与 generateSign 相同：对 "timestamp\nsecret" 计算 HMAC，
+// base64 编码后再 URL 编码。可在多个线程上同时调用 appendSign
+class SignKey {
+public:
+  explicit SignKey(const std::string &secret);
+  ~SignKey();
+
+  SignKey(const SignKey &) = delete;
+  SignKey &operator=(const SignKey &) = delete;
+
+  // 将 timestamp 的签名追加到 out 末尾，base64 与 URL 编码一次完成
+  void appendSign(std::string &out, std::string_view timestamp) const;
+
+private:
+  struct State;
+  std::unique_ptr<State> state_;
+  std::string secret_;
+};
+
+#endif // SIGN_UTILS_HPP
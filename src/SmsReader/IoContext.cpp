@@ -0,0 +1,72 @@
+#include "IoContext.hpp"
+
+IoContext::IoContext() {
+  context_ = g_main_context_new();
+  loop_ = g_main_loop_new(context_, FALSE);
+
+  // 等待 I/O 线程进入循环后再返回，之后投递的任务一定会被执行
+  std::promise<void> running;
+  auto runningFuture = running.get_future();
+  thread_ = std::thread([this, &running] {
+    g_main_context_push_thread_default(context_);
+    GSource *ready = g_idle_source_new();
+    g_source_set_callback(
+        ready,
+        [](gpointer user_data) -> gboolean {
+          static_cast<std::promise<void> *>(user_data)->set_value();
+          return G_SOURCE_REMOVE;
+        },
+        &running, nullptr);
+    g_source_attach(ready, context_);
+    g_source_unref(ready);
+    g_main_loop_run(loop_);
+    g_main_context_pop_thread_default(context_);
+  });
+  runningFuture.wait();
+}
+
+IoContext::~IoContext() {
+  // 已投递的任务先于退出执行
+  post([this] { g_main_loop_quit(loop_); });
+  if (thread_.joinable())
+    thread_.join();
+  g_main_loop_unref(loop_);
+  g_main_context_unref(context_);
+}
+
+void IoContext::post(std::function<void()> fn) {
+  // 总是挂到下一轮循环，即使在 I/O 线程上投递也不会重入当前回调
+  GSource *source = g_idle_source_new();
+  g_source_set_priority(source, G_PRIORITY_DEFAULT);
+  g_source_set_callback(source, dispatchTask,
+                        new std::function<void()>(std::move(fn)), destroyTask);
+  g_source_attach(source, context_);
+  g_source_unref(source);
+}
+
+void IoContext::postAfter(std::chrono::microseconds delay,
+                          std::function<void()> fn) {
+  // 以就绪时间驱动的自定义 source，无需 prepare/check
+  static GSourceFuncs delayedFuncs = {nullptr, nullptr, dispatchDelayed,
+                                      nullptr, nullptr, nullptr};
+  GSource *source = g_source_new(&delayedFuncs, sizeof(GSource));
+  g_source_set_ready_time(source, g_get_monotonic_time() + delay.count());
+  g_source_set_callback(source, dispatchTask,
+                        new std::function<void()>(std::move(fn)), destroyTask);
+  g_source_attach(source, context_);
+  g_source_unref(source);
+}
+
+gboolean IoContext::dispatchDelayed(GSource * /*source*/, GSourceFunc callback,
+                                    gpointer user_data) {
+  return callback(user_data);
+}
+
+gboolean IoContext::dispatchTask(gpointer user_data) {
+  (*static_cast<std::function<void()> *>(user_data))();
+  return G_SOURCE_REMOVE;
+}
+
+void IoContext::destroyTask(gpointer user_data) {
+  delete static_cast<std::function<void()> *>(user_data);
+}
@@ -0,0 +1,74 @@
+#ifndef IO_CONTEXT_HPP
+#define IO_CONTEXT_HPP
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+
+extern "C" {
+#include <glib.h>
+}
+
+// 独占的 GMainContext 及驱动它的 I/O 线程。
+//
+// I/O 线程启动时把该 context 设为线程默认 context，因此在其中发起的 libqmi
+// 异步调用（包括 QmiDevice 自身的读写）都只在这个线程上分发回调，不会与
+// 其他读取器或全局默认 context 相互抢占。其他线程通过 post/submit 把任务
+// 投递到 I/O 线程执行。
+class IoContext {
+public:
+  IoContext();
+  ~IoContext();
+
+  IoContext(const IoContext &) = delete;
+  IoContext &operator=(const IoContext &) = delete;
+
+  GMainContext *context() const { return context_; }
+
+  // 当前是否运行在 I/O 线程上；I/O 线程上不能阻塞等待自己投递的任务
+  bool inIoThread() const {
+    return std::this_thread::get_id() == thread_.get_id();
+  }
+
+  // 投递任务到 I/O 线程，按投递顺序在下一轮循环中执行
+  void post(std::function<void()> fn);
+
+  // 延迟 delay 后在 I/O 线程上执行 fn；精度为微秒，不受毫秒定时器取整影响
+  void postAfter(std::chrono::microseconds delay, std::function<void()> fn);
+
+  // 在 I/O 线程上执行 fn，返回其结果的 future
+  template <typename F>
+  auto submit(F &&fn) -> std::future<std::invoke_result_t<F>> {
+    using R = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(fn));
+    auto future = task->get_future();
+    post([task] { (*task)(); });
+    return future;
+  }
+
+  // 在 I/O 线程上启动一个异步操作：start 得到一个 promise，在操作的完成
+  // 回调中兑现；返回对应的 future
+  template <typename T>
+  std::future<T>
+  start(std::function<void(std::shared_ptr<std::promise<T>>)> start) {
+    auto promise = std::make_shared<std::promise<T>>();
+    auto future = promise->get_future();
+    post([start = std::move(start), promise] { start(promise); });
+    return future;
+  }
+
+private:
+  static gboolean dispatchTask(gpointer user_data);
+  static gboolean dispatchDelayed(GSource *source, GSourceFunc callback,
+                                  gpointer user_data);
+  static void destroyTask(gpointer user_data);
+
+  GMainContext *context_ = nullptr;
+  GMainLoop *loop_ = nullptr;
+  std::thread thread_;
+};
+
+#endif // IO_CONTEXT_HPP
@@ -0,0 +1,34 @@
+#ifndef IO_SCHEDULER_HPP
+#define IO_SCHEDULER_HPP
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "IoContext.hpp"
+
+// 多个读取器共享的一小组 I/O 线程。每个读取器绑定其中一个 IoContext，
+// 同一读取器的所有 libqmi 调用仍然只在一个线程上执行
+class IoScheduler {
+public:
+  explicit IoScheduler(size_t threads) {
+    if (threads < 1)
+      threads = 1;
+    for (size_t i = 0; i < threads; ++i)
+      contexts_.push_back(std::make_unique<IoContext>());
+  }
+
+  IoScheduler(const IoScheduler &) = delete;
+  IoScheduler &operator=(const IoScheduler &) = delete;
+
+  // 轮转分配一个 I/O 线程
+  IoContext &acquire() { return *contexts_[next_++ % contexts_.size()]; }
+
+  size_t size() const { return contexts_.size(); }
+
+private:
+  std::vector<std::unique_ptr<IoContext>> contexts_;
+  std::atomic<size_t> next_{0};
+};
+
+#endif // IO_SCHEDULER_HPP
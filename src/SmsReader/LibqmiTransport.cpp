@@ -0,0 +1,689 @@
+#include "LibqmiTransport.hpp"
+#include "SmsReader.hpp"
+#include "gio/gio.h"
+#include "glibconfig.h"
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <utility>
+
+// 使用 libqmi 设备的构造函数定义在这里，不依赖 libqmi 的目标（如基准测试）
+// 只需链接 SmsReader.cpp 并自行提供传输层
+QmiSmsReader::QmiSmsReader(const std::string &devicePath, IoContext *io)
+    : QmiSmsReader(std::make_unique<LibqmiTransport>(), devicePath, io) {}
+
+namespace {
+
+// 以下上下文在发起调用时创建，在对应的完成回调中释放
+
+struct DeviceOpenContext {
+  std::function<void(bool)> done;
+  QmiDevice **device;
+};
+
+struct CloseContext {
+  std::function<void()> done;
+};
+
+struct AllocateClientContext {
+  std::function<void(WmsClient *, WmsStatus)> done;
+};
+
+struct ReleaseClientContext {
+  std::function<void()> done;
+};
+
+struct ListContext {
+  SmsStorage storage;
+  std::function<void(WmsStatus, std::vector<int>)> done;
+};
+
+struct RawReadContext {
+  MessageSlot slot;
+  std::function<void(WmsStatus, std::vector<uint8_t>)> done;
+};
+
+struct DeleteContext {
+  std::function<void(WmsStatus)> done;
+};
+
+struct ModifyTagContext {
+  std::function<void(bool)> done;
+};
+
+struct RawSendContext {
+  std::function<void(WmsStatus, uint16_t)> done;
+};
+
+struct StoreMaxSizeContext {
+  SmsStorage storage;
+  std::function<void(WmsStatus, uint32_t)> done;
+};
+
+struct EventReportContext {
+  LibqmiTransport *self;
+  WmsClient *client;
+  std::function<void(bool)> done;
+};
+
+bool isTimeout(const GError *error) {
+  return error && error->message &&
+         strstr(error->message, "Transaction timed out");
+}
+
+void openCallback(QmiDevice *dev, GAsyncResult *res, gpointer user_data) {
+  auto *ctx = static_cast<DeviceOpenContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  if (!qmi_device_open_finish(dev, res, &error)) {
+    std::cerr << "无法打开设备: " << error->message << std::endl;
+    g_object_unref(dev);
+    ctx->done(false);
+  } else {
+    *ctx->device = dev;
+    ctx->done(true);
+  }
+  delete ctx;
+}
+
+void deviceNewCallback(GObject * /*source*/, GAsyncResult *res,
+                       gpointer user_data) {
+  auto *ctx = static_cast<DeviceOpenContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  QmiDevice *dev = qmi_device_new_finish(res, &error);
+  if (!dev) {
+    std::cerr << "无法创建 QmiDevice: " << error->message << std::endl;
+    ctx->done(false);
+    delete ctx;
+    return;
+  }
+  // 打开设备
+  qmi_device_open(dev,
+                  (QmiDeviceOpenFlags)(QMI_DEVICE_OPEN_FLAGS_PROXY |
+                                       QMI_DEVICE_OPEN_FLAGS_AUTO),
+                  10, /* timeout 秒 */
+                  nullptr, (GAsyncReadyCallback)openCallback, ctx);
+}
+
+void closeCallback(QmiDevice *dev, GAsyncResult *res, gpointer user_data) {
+  auto *ctx = static_cast<CloseContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  if (!qmi_device_close_finish(dev, res, &error)) {
+    std::cerr << "关闭设备失败: " << error->message << std::endl;
+  }
+  g_object_unref(dev);
+  ctx->done();
+  delete ctx;
+}
+
+void allocateClientCallback(QmiDevice *device, GAsyncResult *res,
+                            gpointer user_data) {
+  auto *ctx = static_cast<AllocateClientContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(QmiClient) client =
+      qmi_device_allocate_client_finish(device, res, &error);
+  if (client) {
+    ctx->done(reinterpret_cast<WmsClient *>(
+                  QMI_CLIENT_WMS(g_object_ref(client))),
+              WmsStatus::Ok);
+  } else if (isTimeout(error)) {
+    ctx->done(nullptr, WmsStatus::Timeout);
+  } else {
+    std::cerr << "无法分配 WMS 客户端: "
+              << (error ? error->message : "未知错误") << std::endl;
+    ctx->done(nullptr, WmsStatus::Error);
+  }
+  delete ctx;
+}
+
+void releaseClientCallback(QmiDevice *device, GAsyncResult *res,
+                           gpointer user_data) {
+  auto *ctx = static_cast<ReleaseClientContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  if (!qmi_device_release_client_finish(device, res, &error)) {
+    std::cerr << "关闭客户端失败: " << (error ? error->message : "未知错误")
+              << std::endl;
+  }
+  ctx->done();
+  delete ctx;
+}
+
+void listCallback(QmiClientWms *client, GAsyncResult *res,
+                  gpointer user_data) {
+  auto *ctx = static_cast<ListContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(QmiMessageWmsListMessagesOutput) output =
+      qmi_client_wms_list_messages_finish(client, res, &error);
+
+  std::vector<int> messageIndices;
+  WmsStatus status = WmsStatus::Error;
+  if (!output && isTimeout(error)) {
+    status = WmsStatus::Timeout;
+  } else if (!output ||
+             !qmi_message_wms_list_messages_output_get_result(output,
+                                                              &error)) {
+    std::cerr << "列出 " << smsStorageName(ctx->storage)
+              << " 存储中的短信失败: " << error->message << std::endl;
+  } else {
+    GArray *message_list = nullptr;
+    qmi_message_wms_list_messages_output_get_message_list(output, &message_list,
+                                                          nullptr);
+    if (message_list) {
+      for (guint i = 0; i < message_list->len; i++) {
+        auto *msg = &g_array_index(
+            message_list, QmiMessageWmsListMessagesOutputMessageListElement, i);
+        messageIndices.push_back(msg->memory_index);
+      }
+      status = WmsStatus::Ok;
+    }
+  }
+  ctx->done(status, std::move(messageIndices));
+  delete ctx;
+}
+
+void rawReadCallback(QmiClientWms *client, GAsyncResult *res,
+                     gpointer user_data) {
+  auto *ctx = static_cast<RawReadContext *>(user_data);
+  MessageSlot slot = ctx->slot;
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(QmiMessageWmsRawReadOutput) output =
+      qmi_client_wms_raw_read_finish(client, res, &error);
+
+  WmsStatus status = WmsStatus::Error;
+  std::vector<uint8_t> pdu;
+  if (!output) {
+    if (isTimeout(error)) {
+      status = WmsStatus::Timeout;
+    } else {
+      std::cerr << "读取短信内容（" << slot
+                << "）失败: " << (error ? error->message : "未知错误")
+                << std::endl;
+    }
+  } else {
+    GArray *raw_data = nullptr;
+    QmiWmsMessageTagType msg_tag;
+    QmiWmsMessageFormat msg_format;
+    if (!qmi_message_wms_raw_read_output_get_raw_message_data(
+            output, &msg_tag, &msg_format, &raw_data, &error)) {
+      std::cerr << "获取短信原始数据（" << slot
+                << "）失败: " << error->message << std::endl;
+    } else {
+      status = WmsStatus::Ok;
+      if (raw_data && raw_data->len > 0) {
+        auto *bytes = reinterpret_cast<const uint8_t *>(raw_data->data);
+        pdu.assign(bytes, bytes + raw_data->len);
+      }
+    }
+  }
+  ctx->done(status, std::move(pdu));
+  delete ctx;
+}
+
+void deleteCallback(QmiClientWms *client, GAsyncResult *res,
+                    gpointer user_data) {
+  auto *ctx = static_cast<DeleteContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(QmiMessageWmsDeleteOutput) output =
+      qmi_client_wms_delete_finish(client, res, &error);
+  WmsStatus status = WmsStatus::Ok;
+  if (!output) {
+    if (isTimeout(error)) {
+      status = WmsStatus::Timeout;
+    } else {
+      std::cerr << "删除短信失败: " << error->message << std::endl;
+      status = WmsStatus::Error;
+    }
+  }
+  ctx->done(status);
+  delete ctx;
+}
+
+void modifyTagCallback(QmiClientWms *client, GAsyncResult *res,
+                       gpointer user_data) {
+  auto *ctx = static_cast<ModifyTagContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(QmiMessageWmsModifyTagOutput) output =
+      qmi_client_wms_modify_tag_finish(client, res, &error);
+  bool success = true;
+  if (!output ||
+      !qmi_message_wms_modify_tag_output_get_result(output, &error)) {
+    std::cerr << "修改短信标签失败: "
+              << (error ? error->message : "未知错误") << std::endl;
+    success = false;
+  }
+  ctx->done(success);
+  delete ctx;
+}
+
+void rawSendCallback(QmiClientWms *client, GAsyncResult *res,
+                     gpointer user_data) {
+  auto *ctx = static_cast<RawSendContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(QmiMessageWmsRawSendOutput) output =
+      qmi_client_wms_raw_send_finish(client, res, &error);
+  WmsStatus status = WmsStatus::Error;
+  guint16 messageId = 0;
+  if (!output && isTimeout(error)) {
+    status = WmsStatus::Timeout;
+  } else if (!output ||
+             !qmi_message_wms_raw_send_output_get_result(output, &error)) {
+    std::cerr << "发送短信失败: " << (error ? error->message : "未知错误")
+              << std::endl;
+  } else {
+    status = WmsStatus::Ok;
+    // 部分固件不回报消息参考号，不影响发送结果
+    qmi_message_wms_raw_send_output_get_message_id(output, &messageId,
+                                                   nullptr);
+  }
+  ctx->done(status, messageId);
+  delete ctx;
+}
+
+void storeMaxSizeCallback(QmiClientWms *client, GAsyncResult *res,
+                          gpointer user_data) {
+  auto *ctx = static_cast<StoreMaxSizeContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(QmiMessageWmsGetStoreMaxSizeOutput) output =
+      qmi_client_wms_get_store_max_size_finish(client, res, &error);
+  WmsStatus status = WmsStatus::Error;
+  guint32 maxSize = 0;
+  if (!output && isTimeout(error)) {
+    status = WmsStatus::Timeout;
+  } else if (!output ||
+             !qmi_message_wms_get_store_max_size_output_get_result(output,
+                                                                   &error) ||
+             !qmi_message_wms_get_store_max_size_output_get_memory_store_max_size(
+                 output, &maxSize, &error)) {
+    std::cerr << "查询 " << smsStorageName(ctx->storage)
+              << " 存储容量失败: " << (error ? error->message : "未知错误")
+              << std::endl;
+  } else {
+    status = WmsStatus::Ok;
+  }
+  ctx->done(status, maxSize);
+  delete ctx;
+}
+
+void setEventReportCallback(QmiClientWms *client, GAsyncResult *res,
+                            gpointer user_data) {
+  auto *ctx = static_cast<EventReportContext *>(user_data);
+  g_autoptr(GError) error = nullptr;
+  g_autoptr(QmiMessageWmsSetEventReportOutput) output =
+      qmi_client_wms_set_event_report_finish(client, res, &error);
+  bool success = true;
+  if (!output ||
+      !qmi_message_wms_set_event_report_output_get_result(output, &error)) {
+    std::cerr << "设置 WMS 事件报告失败: "
+              << (error ? error->message : "未知错误") << std::endl;
+    success = false;
+    ctx->self->unregisterNewMessageIndications(ctx->client);
+  }
+  ctx->done(success);
+  delete ctx;
+}
+
+} // namespace
+
+LibqmiTransport::~LibqmiTransport() {
+  // 正常情况下 close 已释放设备；这里只兜底
+  if (device_)
+    g_object_unref(device_);
+}
+
+void LibqmiTransport::open(const std::string &devicePath,
+                           std::function<void(bool success)> done) {
+  auto *ctx = new DeviceOpenContext{std::move(done), &device_};
+  g_autoptr(GFile) file = g_file_new_for_path(devicePath.c_str());
+  qmi_device_new(file, nullptr, deviceNewCallback, ctx);
+}
+
+void LibqmiTransport::close(std::function<void()> done) {
+  if (!device_) {
+    done();
+    return;
+  }
+  // client 随设备一起失效，只释放本地对象；proxy 会在连接关闭时回收 CID
+  if (indicationClient_)
+    unregisterNewMessageIndications(indicationClient_);
+  for (WmsClient *client : clients_)
+    g_object_unref(qmiClient(client));
+  clients_.clear();
+  QmiDevice *device = device_;
+  device_ = nullptr;
+  qmi_device_close_async(device, 10, nullptr,
+                         (GAsyncReadyCallback)closeCallback,
+                         new CloseContext{std::move(done)});
+}
+
+void LibqmiTransport::allocateClient(
+    std::function<void(WmsClient *client, WmsStatus)> done) {
+  qmi_device_allocate_client(device_, QMI_SERVICE_WMS, QMI_CID_NONE,
+                             timeoutSeconds(WmsOperation::AllocateClient),
+                             nullptr,
+                             (GAsyncReadyCallback)allocateClientCallback,
+                             new AllocateClientContext{
+                                 [this, done = std::move(done)](
+                                     WmsClient *client, WmsStatus status) {
+                                   if (client)
+                                     clients_.insert(client);
+                                   done(client, status);
+                                 }});
+}
+
+void LibqmiTransport::releaseClient(WmsClient *client,
+                                    std::function<void()> done) {
+  if (!clients_.erase(client)) {
+    // 已随设备关闭而丢弃
+    done();
+    return;
+  }
+  QmiClientWms *wms = qmiClient(client);
+  qmi_device_release_client(
+      device_, QMI_CLIENT(wms), QMI_DEVICE_RELEASE_CLIENT_FLAGS_NONE, 10,
+      nullptr, (GAsyncReadyCallback)releaseClientCallback,
+      new ReleaseClientContext{[wms, done = std::move(done)] {
+        g_object_unref(wms);
+        done();
+      }});
+}
+
+void LibqmiTransport::listMessages(
+    WmsClient *client, SmsStorage storage, WmsMessageTag tag,
+    std::function<void(WmsStatus, std::vector<int> indices)> done) {
+  if (!live(client)) {
+    done(WmsStatus::Error, {});
+    return;
+  }
+  g_autoptr(GError) error = nullptr;
+  // 输入参数对象
+  QmiMessageWmsListMessagesInput *input =
+      qmi_message_wms_list_messages_input_new();
+
+  // 设置存储类型
+  if (!qmi_message_wms_list_messages_input_set_storage_type(
+          input, qmiStorage(storage), &error)) {
+    g_printerr("Error setting storage type: %s\n", error->message);
+    qmi_message_wms_list_messages_input_unref(input);
+    done(WmsStatus::Error, {});
+    return;
+  }
+
+  // QMI_WMS_MESSAGE_MODE_GSM_WCDMA
+  if (!qmi_message_wms_list_messages_input_set_message_mode(
+          input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
+    g_printerr("Error setting message mode: %s\n", error->message);
+    qmi_message_wms_list_messages_input_unref(input);
+    done(WmsStatus::Error, {});
+    return;
+  }
+
+  if (!qmi_message_wms_list_messages_input_set_message_tag(
+          input, qmiTag(tag), &error)) {
+    g_printerr("Error setting message tag: %s\n", error->message);
+    qmi_message_wms_list_messages_input_unref(input);
+    done(WmsStatus::Error, {});
+    return;
+  }
+
+  // 发起列表消息请求
+  qmi_client_wms_list_messages(qmiClient(client), input,
+                               timeoutSeconds(WmsOperation::List), nullptr,
+                               (GAsyncReadyCallback)listCallback,
+                               new ListContext{storage, std::move(done)});
+  qmi_message_wms_list_messages_input_unref(input);
+}
+
+void LibqmiTransport::rawRead(
+    WmsClient *client, MessageSlot slot,
+    std::function<void(WmsStatus, std::vector<uint8_t> pdu)> done) {
+  if (!live(client)) {
+    done(WmsStatus::Error, {});
+    return;
+  }
+  QmiMessageWmsRawReadInput *read_input = qmi_message_wms_raw_read_input_new();
+  g_autoptr(GError) error = nullptr;
+
+  if (!qmi_message_wms_raw_read_input_set_message_mode(
+          read_input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
+    std::cerr << "设置短信模式失败: " << error->message << std::endl;
+    qmi_message_wms_raw_read_input_unref(read_input);
+    done(WmsStatus::Error, {});
+    return;
+  }
+
+  if (!qmi_message_wms_raw_read_input_set_message_memory_storage_id(
+          read_input, qmiStorage(slot.storage), slot.index, &error)) {
+    std::cerr << "设置短信存储ID失败: " << error->message << std::endl;
+    qmi_message_wms_raw_read_input_unref(read_input);
+    done(WmsStatus::Error, {});
+    return;
+  }
+
+  qmi_client_wms_raw_read(qmiClient(client), read_input,
+                          timeoutSeconds(WmsOperation::RawRead), nullptr,
+                          (GAsyncReadyCallback)rawReadCallback,
+                          new RawReadContext{slot, std::move(done)});
+  qmi_message_wms_raw_read_input_unref(read_input);
+}
+
+void LibqmiTransport::deleteMessage(WmsClient *client, MessageSlot slot,
+                                    std::function<void(WmsStatus)> done) {
+  if (!live(client)) {
+    done(WmsStatus::Error);
+    return;
+  }
+  QmiMessageWmsDeleteInput *input = qmi_message_wms_delete_input_new();
+  g_autoptr(GError) error = nullptr;
+  if (!qmi_message_wms_delete_input_set_memory_storage(
+          input, qmiStorage(slot.storage), &error)) {
+    std::cerr << "设置删除短信存储位置失败: " << error->message << std::endl;
+    qmi_message_wms_delete_input_unref(input);
+    done(WmsStatus::Error);
+    return;
+  }
+  if (!qmi_message_wms_delete_input_set_memory_index(input, slot.index,
+                                                     &error)) {
+    std::cerr << "设置删除短信 index 失败: " << error->message << std::endl;
+    qmi_message_wms_delete_input_unref(input);
+    done(WmsStatus::Error);
+    return;
+  }
+  if (!qmi_message_wms_delete_input_set_message_mode(
+          input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
+    std::cerr << "设置删除短信模式失败: " << error->message << std::endl;
+    qmi_message_wms_delete_input_unref(input);
+    done(WmsStatus::Error);
+    return;
+  }
+  qmi_client_wms_delete(qmiClient(client), input,
+                        timeoutSeconds(WmsOperation::Delete), nullptr,
+                        (GAsyncReadyCallback)deleteCallback,
+                        new DeleteContext{std::move(done)});
+  qmi_message_wms_delete_input_unref(input);
+}
+
+void LibqmiTransport::deleteByTag(WmsClient *client, SmsStorage storage,
+                                  WmsMessageTag tag,
+                                  std::function<void(bool success)> done) {
+  if (!live(client)) {
+    done(false);
+    return;
+  }
+  // 只指定存储位置与标签、不指定索引时，设备删除该标签下的全部短信
+  QmiMessageWmsDeleteInput *input = qmi_message_wms_delete_input_new();
+  g_autoptr(GError) error = nullptr;
+  if (!qmi_message_wms_delete_input_set_memory_storage(
+          input, qmiStorage(storage), &error)) {
+    std::cerr << "设置删除短信存储位置失败: " << error->message << std::endl;
+    qmi_message_wms_delete_input_unref(input);
+    done(false);
+    return;
+  }
+  if (!qmi_message_wms_delete_input_set_message_tag(input, qmiTag(tag),
+                                                    &error)) {
+    std::cerr << "设置删除短信标签失败: " << error->message << std::endl;
+    qmi_message_wms_delete_input_unref(input);
+    done(false);
+    return;
+  }
+  if (!qmi_message_wms_delete_input_set_message_mode(
+          input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
+    std::cerr << "设置删除短信模式失败: " << error->message << std::endl;
+    qmi_message_wms_delete_input_unref(input);
+    done(false);
+    return;
+  }
+  qmi_client_wms_delete(
+      qmiClient(client), input, timeoutSeconds(WmsOperation::Delete), nullptr,
+      (GAsyncReadyCallback)deleteCallback,
+      new DeleteContext{[done = std::move(done)](WmsStatus status) {
+        done(status == WmsStatus::Ok);
+      }});
+  qmi_message_wms_delete_input_unref(input);
+}
+
+void LibqmiTransport::markRead(WmsClient *client, MessageSlot slot,
+                               std::function<void(bool success)> done) {
+  if (!live(client)) {
+    done(false);
+    return;
+  }
+  QmiMessageWmsModifyTagInput *input = qmi_message_wms_modify_tag_input_new();
+  g_autoptr(GError) error = nullptr;
+  if (!qmi_message_wms_modify_tag_input_set_message_tag(
+          input, qmiStorage(slot.storage), slot.index,
+          QMI_WMS_MESSAGE_TAG_TYPE_MT_READ, &error)) {
+    std::cerr << "设置短信标签失败: " << error->message << std::endl;
+    qmi_message_wms_modify_tag_input_unref(input);
+    done(false);
+    return;
+  }
+  if (!qmi_message_wms_modify_tag_input_set_message_mode(
+          input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
+    std::cerr << "设置短信标签模式失败: " << error->message << std::endl;
+    qmi_message_wms_modify_tag_input_unref(input);
+    done(false);
+    return;
+  }
+  qmi_client_wms_modify_tag(qmiClient(client), input,
+                            timeoutSeconds(WmsOperation::ModifyTag), nullptr,
+                            (GAsyncReadyCallback)modifyTagCallback,
+                            new ModifyTagContext{std::move(done)});
+  qmi_message_wms_modify_tag_input_unref(input);
+}
+
+void LibqmiTransport::rawSend(
+    WmsClient *client, const std::vector<uint8_t> &pdu,
+    std::function<void(WmsStatus, uint16_t messageId)> done) {
+  if (!live(client)) {
+    done(WmsStatus::Error, 0);
+    return;
+  }
+  QmiMessageWmsRawSendInput *input = qmi_message_wms_raw_send_input_new();
+  g_autoptr(GError) error = nullptr;
+  GArray *raw_data = g_array_sized_new(FALSE, FALSE, sizeof(guint8),
+                                       static_cast<guint>(pdu.size()));
+  g_array_append_vals(raw_data, pdu.data(), static_cast<guint>(pdu.size()));
+  bool ok = qmi_message_wms_raw_send_input_set_raw_message_data(
+      input, QMI_WMS_MESSAGE_FORMAT_GSM_WCDMA_POINT_TO_POINT, raw_data,
+      &error);
+  g_array_unref(raw_data);
+  if (!ok) {
+    std::cerr << "设置待发送短信失败: " << error->message << std::endl;
+    qmi_message_wms_raw_send_input_unref(input);
+    done(WmsStatus::Error, 0);
+    return;
+  }
+  qmi_client_wms_raw_send(qmiClient(client), input,
+                          timeoutSeconds(WmsOperation::RawSend), nullptr,
+                          (GAsyncReadyCallback)rawSendCallback,
+                          new RawSendContext{std::move(done)});
+  qmi_message_wms_raw_send_input_unref(input);
+}
+
+void LibqmiTransport::getStoreMaxSize(
+    WmsClient *client, SmsStorage storage,
+    std::function<void(WmsStatus, uint32_t maxSize)> done) {
+  if (!live(client)) {
+    done(WmsStatus::Error, 0);
+    return;
+  }
+  QmiMessageWmsGetStoreMaxSizeInput *input =
+      qmi_message_wms_get_store_max_size_input_new();
+  g_autoptr(GError) error = nullptr;
+  if (!qmi_message_wms_get_store_max_size_input_set_storage_type(
+          input, qmiStorage(storage), &error) ||
+      !qmi_message_wms_get_store_max_size_input_set_message_mode(
+          input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
+    std::cerr << "设置容量查询参数失败: " << error->message << std::endl;
+    qmi_message_wms_get_store_max_size_input_unref(input);
+    done(WmsStatus::Error, 0);
+    return;
+  }
+  // 与列表同属轻量查询，沿用列表的超时
+  qmi_client_wms_get_store_max_size(
+      qmiClient(client), input, timeoutSeconds(WmsOperation::List), nullptr,
+      (GAsyncReadyCallback)storeMaxSizeCallback,
+      new StoreMaxSizeContext{storage, std::move(done)});
+  qmi_message_wms_get_store_max_size_input_unref(input);
+}
+
+void LibqmiTransport::registerNewMessageIndications(
+    WmsClient *client, std::function<void(MessageSlot slot)> onNewMessage,
+    std::function<void(bool success)> done) {
+  if (!live(client)) {
+    done(false);
+    return;
+  }
+  g_autoptr(GError) error = nullptr;
+  QmiMessageWmsSetEventReportInput *input =
+      qmi_message_wms_set_event_report_input_new();
+  if (!qmi_message_wms_set_event_report_input_set_new_mt_message_indicator(
+          input, TRUE, &error)) {
+    std::cerr << "设置新短信指示参数失败: " << error->message << std::endl;
+    qmi_message_wms_set_event_report_input_unref(input);
+    done(false);
+    return;
+  }
+
+  // 先连接信号，避免注册完成与首条指示之间的竞态
+  onNewMessage_ = std::move(onNewMessage);
+  indicationClient_ = client;
+  eventReportHandlerId_ =
+      g_signal_connect(qmiClient(client), "event-report",
+                       G_CALLBACK(eventReportCallback), this);
+
+  qmi_client_wms_set_event_report(
+      qmiClient(client), input, 10, nullptr,
+      (GAsyncReadyCallback)setEventReportCallback,
+      new EventReportContext{this, client, std::move(done)});
+  qmi_message_wms_set_event_report_input_unref(input);
+}
+
+void LibqmiTransport::unregisterNewMessageIndications(WmsClient *client) {
+  if (eventReportHandlerId_ && live(client)) {
+    g_signal_handler_disconnect(qmiClient(client), eventReportHandlerId_);
+  }
+  eventReportHandlerId_ = 0;
+  indicationClient_ = nullptr;
+  onNewMessage_ = nullptr;
+}
+
+void LibqmiTransport::eventReportCallback(
+    QmiClientWms * /*client*/, QmiIndicationWmsEventReportOutput *output,
+    gpointer user_data) {
+  auto *self = static_cast<LibqmiTransport *>(user_data);
+  QmiWmsStorageType storage;
+  guint32 memoryIndex = 0;
+  // 无论指示中是否携带存储位置，都通知一次；未携带时索引为 -1
+  MessageSlot slot;
+  if (qmi_indication_wms_event_report_output_get_mt_message(
+          output, &storage, &memoryIndex, nullptr)) {
+    slot.storage = storage == QMI_WMS_STORAGE_TYPE_NV ? SmsStorage::Nv
+                                                      : SmsStorage::Uim;
+    slot.index = static_cast<int>(memoryIndex);
+    std::cout << "收到新短信指示，位置: " << slot << std::endl;
+  }
+  if (self->onNewMessage_)
+    self->onNewMessage_(slot);
+}
@@ -0,0 +1,90 @@
+#ifndef LIBQMI_TRANSPORT_HPP
+#define LIBQMI_TRANSPORT_HPP
+
+#include "WmsTransport.hpp"
+
+#include <unordered_set>
+
+// C Headers
+extern "C" {
+#include <glib.h>
+#include <libqmi-glib.h>
+}
+
+// 基于 libqmi-glib 的 WMS 传输层。所有调用须在持有线程默认 GMainContext
+// 的 I/O 线程上发起，libqmi 的回调也在该 context 上分发
+class LibqmiTransport : public WmsTransport {
+public:
+  LibqmiTransport() = default;
+  ~LibqmiTransport() override;
+
+  void open(const std::string &devicePath,
+            std::function<void(bool success)> done) override;
+  void close(std::function<void()> done) override;
+
+  void allocateClient(
+      std::function<void(WmsClient *client, WmsStatus)> done) override;
+  void releaseClient(WmsClient *client, std::function<void()> done) override;
+
+  void listMessages(
+      WmsClient *client, SmsStorage storage, WmsMessageTag tag,
+      std::function<void(WmsStatus, std::vector<int> indices)> done) override;
+  void rawRead(WmsClient *client, MessageSlot slot,
+               std::function<void(WmsStatus, std::vector<uint8_t> pdu)> done)
+      override;
+  void deleteMessage(WmsClient *client, MessageSlot slot,
+                     std::function<void(WmsStatus)> done) override;
+  void deleteByTag(WmsClient *client, SmsStorage storage, WmsMessageTag tag,
+                   std::function<void(bool success)> done) override;
+  void markRead(WmsClient *client, MessageSlot slot,
+                std::function<void(bool success)> done) override;
+  void rawSend(WmsClient *client, const std::vector<uint8_t> &pdu,
+               std::function<void(WmsStatus, uint16_t messageId)> done)
+      override;
+  void getStoreMaxSize(
+      WmsClient *client, SmsStorage storage,
+      std::function<void(WmsStatus, uint32_t maxSize)> done) override;
+
+  void registerNewMessageIndications(
+      WmsClient *client, std::function<void(MessageSlot slot)> onNewMessage,
+      std::function<void(bool success)> done) override;
+  void unregisterNewMessageIndications(WmsClient *client) override;
+
+private:
+  static QmiClientWms *qmiClient(WmsClient *client) {
+    return reinterpret_cast<QmiClientWms *>(client);
+  }
+
+  // client 是否属于当前打开的设备
+  bool live(WmsClient *client) const { return clients_.count(client) > 0; }
+
+  // libqmi 的超时以秒为单位：向上取整，至少 1 秒
+  guint timeoutSeconds(WmsOperation op) const {
+    auto ms = timeout(op).count();
+    return ms <= 1000 ? 1 : static_cast<guint>((ms + 999) / 1000);
+  }
+
+  static QmiWmsStorageType qmiStorage(SmsStorage storage) {
+    return storage == SmsStorage::Nv ? QMI_WMS_STORAGE_TYPE_NV
+                                     : QMI_WMS_STORAGE_TYPE_UIM;
+  }
+
+  static QmiWmsMessageTagType qmiTag(WmsMessageTag tag) {
+    return tag == WmsMessageTag::Read ? QMI_WMS_MESSAGE_TAG_TYPE_MT_READ
+                                      : QMI_WMS_MESSAGE_TAG_TYPE_MT_NOT_READ;
+  }
+
+  // WMS event-report 指示回调（新 MT 短信到达）
+  static void eventReportCallback(QmiClientWms *client,
+                                  QmiIndicationWmsEventReportOutput *output,
+                                  gpointer user_data);
+
+  QmiDevice *device_ = nullptr;
+  // 已分配、尚未释放的 client；关闭设备时全部丢弃
+  std::unordered_set<WmsClient *> clients_;
+  WmsClient *indicationClient_ = nullptr;
+  gulong eventReportHandlerId_ = 0;
+  std::function<void(MessageSlot)> onNewMessage_;
+};
+
+#endif // LIBQMI_TRANSPORT_HPP
@@ -0,0 +1,178 @@
+#include "MultipartAssembler.hpp"
+
+#include <functional>
+#include <iostream>
+
+size_t MultipartKeyHash::operator()(const MultipartKey &key) const {
+  size_t h = std::hash<std::string>()(key.sender);
+  h ^= std::hash<int>()(key.reference) + 0x9e3779b97f4a7c15ULL + (h << 6) +
+       (h >> 2);
+  h ^= std::hash<int>()(key.totalParts) + 0x9e3779b97f4a7c15ULL + (h << 6) +
+       (h >> 2);
+  return h;
+}
+
+std::optional<CompleteSMS> MultipartAssembler::add(SMSPart part,
+                                                   Clock::time_point now) {
+  // 单条短信直接完成
+  if (part.totalParts <= 1) {
+    Group single;
+    single.slots.emplace_back(std::move(part));
+    single.received = 1;
+    return buildMessage(single, true);
+  }
+
+  if (part.partNumber < 1 || part.partNumber > part.totalParts) {
+    std::cerr << "分段号越界，位置 " << part.slot << "，分段 "
+              << part.partNumber << "/" << part.totalParts << std::endl;
+    return std::nullopt;
+  }
+
+  MultipartKey key{part.sender, part.reference, part.totalParts};
+  // 已完成分组的重复分段：正文相同才视为重复，参考号被复用的新短信照常重组
+  if (!groups_.count(key)) {
+    auto done = completed_.find(key);
+    if (done != completed_.end() &&
+        done->second.textHashes[part.partNumber - 1] ==
+            std::hash<std::string>()(part.text)) {
+      std::cerr << "检测到已完成短信的重复分段，参考号: " << part.reference
+                << "，发送者: " << part.sender << "，分段: " << part.partNumber
+                << std::endl;
+      duplicateSlots_.push_back(part.slot);
+      return std::nullopt;
+    }
+  }
+
+  auto [it, inserted] = groups_.try_emplace(key);
+  Group &group = it->second;
+  if (inserted) {
+    group.slots.resize(part.totalParts);
+    group.firstSeen = now;
+  }
+
+  auto &held = group.slots[part.partNumber - 1];
+  if (held) {
+    if (held->slot == part.slot) {
+      // 同一位置上的同一分段，无需处理
+      return std::nullopt;
+    }
+    // 重复分段：保留内容最长的，长度相同时保留最早的
+    std::cerr << "检测到重复短信分段，参考号: " << part.reference
+              << "，发送者: " << part.sender << "，分段: " << part.partNumber
+              << std::endl;
+    bool keepNew = part.text.length() > held->text.length() ||
+                   (part.text.length() == held->text.length() &&
+                    part.timestamp < held->timestamp);
+    if (keepNew) {
+      duplicateSlots_.push_back(held->slot);
+      slotToGroup_.erase(held->slot);
+      slotToGroup_[part.slot] = key;
+      held = std::move(part);
+    } else {
+      duplicateSlots_.push_back(part.slot);
+    }
+    return std::nullopt;
+  }
+
+  slotToGroup_[part.slot] = key;
+  held = std::move(part);
+  ++group.received;
+  ++pendingSegments_;
+
+  if (group.received < static_cast<int>(group.slots.size())) {
+    return std::nullopt;
+  }
+
+  // 最后一个分段到达，组装完整短信
+  CompleteSMS csms = buildMessage(group, true);
+  Completed &done = completed_[key];
+  done.textHashes.clear();
+  done.completedAt = now;
+  for (const auto &p : csms.parts) {
+    slotToGroup_.erase(p.slot);
+    done.textHashes.push_back(std::hash<std::string>()(p.text));
+  }
+  pendingSegments_ -= group.received;
+  groups_.erase(it);
+  return csms;
+}
+
+std::vector<CompleteSMS> MultipartAssembler::expire(Clock::time_point now) {
+  for (auto it = completed_.begin(); it != completed_.end();) {
+    if (now - it->second.completedAt >= options_.timeout) {
+      it = completed_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  std::vector<CompleteSMS> expired;
+  for (auto it = groups_.begin(); it != groups_.end();) {
+    Group &group = it->second;
+    if (now - group.firstSeen < options_.timeout) {
+      ++it;
+      continue;
+    }
+    std::cerr << "分段短信等待超时，参考号: " << it->first.reference
+              << "，发送者: " << it->first.sender << "，已收到 "
+              << group.received << "/" << it->first.totalParts << " 个分段"
+              << (options_.deliverPartial ? "，按不完整短信投递" : "，丢弃")
+              << std::endl;
+    for (const auto &held : group.slots) {
+      if (held)
+        slotToGroup_.erase(held->slot);
+    }
+    pendingSegments_ -= group.received;
+    if (options_.deliverPartial) {
+      expired.push_back(buildMessage(group, false));
+    }
+    it = groups_.erase(it);
+  }
+  return expired;
+}
+
+void MultipartAssembler::removeSlot(MessageSlot slot) {
+  auto found = slotToGroup_.find(slot);
+  if (found == slotToGroup_.end()) {
+    return;
+  }
+  auto it = groups_.find(found->second);
+  slotToGroup_.erase(found);
+  if (it == groups_.end()) {
+    return;
+  }
+  Group &group = it->second;
+  for (auto &part : group.slots) {
+    if (part && part->slot == slot) {
+      part.reset();
+      --group.received;
+      --pendingSegments_;
+      break;
+    }
+  }
+  if (group.received == 0) {
+    groups_.erase(it);
+  }
+}
+
+std::vector<MessageSlot> MultipartAssembler::takeDuplicateSlots() {
+  std::vector<MessageSlot> slots;
+  slots.swap(duplicateSlots_);
+  return slots;
+}
+
+CompleteSMS MultipartAssembler::buildMessage(Group &group, bool complete) {
+  CompleteSMS csms;
+  csms.complete = complete;
+  for (auto &slot : group.slots) {
+    if (!slot)
+      continue;
+    if (csms.parts.empty()) {
+      csms.sender = slot->sender;
+      csms.timestamp = slot->timestamp;
+    }
+    csms.fullText += slot->text;
+    csms.parts.push_back(std::move(*slot));
+  }
+  return csms;
+}
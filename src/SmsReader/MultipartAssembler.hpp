@@ -0,0 +1,86 @@
+#ifndef MULTIPART_ASSEMBLER_HPP
+#define MULTIPART_ASSEMBLER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "SmsTypes.hpp"
+
+// 分段短信的分组键：发件人 + 参考号 + 总分段数
+struct MultipartKey {
+  std::string sender;
+  int reference = 0;
+  int totalParts = 0;
+
+  bool operator==(const MultipartKey &other) const {
+    return reference == other.reference && totalParts == other.totalParts &&
+           sender == other.sender;
+  }
+};
+
+struct MultipartKeyHash {
+  size_t operator()(const MultipartKey &key) const;
+};
+
+// 跨轮询保留状态的分段短信重组表。每个分组按总分段数预留固定槽位，
+// 最后一个分段到达时 O(1) 判定完整；超时的分组被丢弃或作为不完整短信投递。
+class MultipartAssembler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    std::chrono::seconds timeout{3600}; // 分组自首个分段到达起的最长等待时间
+    bool deliverPartial = false;        // 超时后是否以不完整短信投递
+  };
+
+  MultipartAssembler() = default;
+  explicit MultipartAssembler(Options options) : options_(options) {}
+
+  void setOptions(Options options) { options_ = options; }
+  const Options &options() const { return options_; }
+
+  // 加入一个已解析的分段。单条短信或使所属分组完整的分段返回完整短信
+  std::optional<CompleteSMS> add(SMSPart part, Clock::time_point now = Clock::now());
+
+  // 取出超时的分组：deliverPartial 时作为不完整短信返回，否则直接丢弃
+  std::vector<CompleteSMS> expire(Clock::time_point now = Clock::now());
+
+  // 某个位置上的分段已不存在（被删除或被复用）时将其移出分组
+  void removeSlot(MessageSlot slot);
+
+  // 取出并清空因重复分段而需要删除的位置
+  std::vector<MessageSlot> takeDuplicateSlots();
+
+  // 等待中的分段数与分组数
+  size_t pendingSegments() const { return pendingSegments_; }
+  size_t pendingGroups() const { return groups_.size(); }
+
+private:
+  struct Group {
+    std::vector<std::optional<SMSPart>> slots; // 下标为分段号 - 1
+    int received = 0;
+    Clock::time_point firstSeen;
+  };
+
+  // 最近完成的分组：记录各分段正文的哈希，用于识别完成之后才读到的重复分段，
+  // 与等待中的分组一样在超时后清除
+  struct Completed {
+    std::vector<size_t> textHashes; // 下标为分段号 - 1
+    Clock::time_point completedAt;
+  };
+
+  static CompleteSMS buildMessage(Group &group, bool complete);
+
+  Options options_;
+  std::unordered_map<MultipartKey, Group, MultipartKeyHash> groups_;
+  std::unordered_map<MultipartKey, Completed, MultipartKeyHash> completed_;
+  std::unordered_map<MessageSlot, MultipartKey, MessageSlotHash> slotToGroup_;
+  std::vector<MessageSlot> duplicateSlots_;
+  size_t pendingSegments_ = 0;
+};
+
+#endif // MULTIPART_ASSEMBLER_HPP
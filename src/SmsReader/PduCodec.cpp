@@ -0,0 +1,509 @@
+#include "PduCodec.hpp"
+
+#include <algorithm>
+#include <array>
+#include <string_view>
+
+namespace pdu {
+namespace {
+
+// GSM 03.38 默认字母表（0x1B 为扩展表转义，单独处理）
+constexpr std::array<char16_t, 128> kGsm7Default = {
+    // 0x00
+    u'@', u'£', u'$', u'¥', u'è', u'é', u'ù', u'ì',
+    u'ò', u'Ç', u'\n', u'Ø', u'ø', u'\r', u'Å', u'å',
+    // 0x10
+    u'Δ', u'_', u'Φ', u'Γ', u'Λ', u'Ω', u'Π', u'Ψ',
+    u'Σ', u'Θ', u'Ξ', u' ', u'Æ', u'æ', u'ß', u'É',
+    // 0x20
+    u' ', u'!', u'"', u'#', u'¤', u'%', u'&', u'\'',
+    u'(', u')', u'*', u'+', u',', u'-', u'.', u'/',
+    // 0x30
+    u'0', u'1', u'2', u'3', u'4', u'5', u'6', u'7',
+    u'8', u'9', u':', u';', u'<', u'=', u'>', u'?',
+    // 0x40
+    u'¡', u'A', u'B', u'C', u'D', u'E', u'F', u'G',
+    u'H', u'I', u'J', u'K', u'L', u'M', u'N', u'O',
+    // 0x50
+    u'P', u'Q', u'R', u'S', u'T', u'U', u'V', u'W',
+    u'X', u'Y', u'Z', u'Ä', u'Ö', u'Ñ', u'Ü', u'§',
+    // 0x60
+    u'¿', u'a', u'b', u'c', u'd', u'e', u'f', u'g',
+    u'h', u'i', u'j', u'k', u'l', u'm', u'n', u'o',
+    // 0x70
+    u'p', u'q', u'r', u's', u't', u'u', u'v', u'w',
+    u'x', u'y', u'z', u'ä', u'ö', u'ñ', u'ü', u'à'};
+
+constexpr uint8_t kGsm7Escape = 0x1B;
+
+// GSM 03.38 扩展表（ESC 之后的字符），未定义的返回 0
+char16_t gsm7Extension(uint8_t septet) {
+  switch (septet) {
+  case 0x0A:
+    return u'\f';
+  case 0x14:
+    return u'^';
+  case 0x28:
+    return u'{';
+  case 0x29:
+    return u'}';
+  case 0x2F:
+    return u'\\';
+  case 0x3C:
+    return u'[';
+  case 0x3D:
+    return u'~';
+  case 0x3E:
+    return u']';
+  case 0x40:
+    return u'|';
+  case 0x65:
+    return u'€';
+  default:
+    return 0;
+  }
+}
+
+void appendUtf8(uint32_t cp, std::string &out) {
+  if (cp < 0x80) {
+    out.push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+}
+
+// 从打包的 7 位数据中取出第 index 个 septet（bitOffset 为起始位偏移）
+uint8_t septetAt(std::span<const uint8_t> packed, size_t bitOffset,
+                 size_t index) {
+  size_t bit = bitOffset + index * 7;
+  size_t byte = bit / 8;
+  unsigned shift = bit % 8;
+  unsigned value = packed[byte] >> shift;
+  if (shift > 1 && byte + 1 < packed.size()) {
+    value |= packed[byte + 1] << (8 - shift);
+  }
+  return static_cast<uint8_t>(value & 0x7F);
+}
+
+// 追加一个 septet 对应的字符；escape 记录上一个 septet 是否为扩展表转义
+void appendSeptet(uint8_t septet, bool &escape, std::string &out) {
+  if (escape) {
+    char16_t ext = gsm7Extension(septet);
+    // 未定义的扩展字符按规范显示为空格
+    appendUtf8(ext ? ext : u' ', out);
+    escape = false;
+  } else if (septet == kGsm7Escape) {
+    escape = true;
+  } else {
+    appendUtf8(kGsm7Default[septet], out);
+  }
+}
+
+void appendUnpackedGsm7(std::span<const uint8_t> packed, size_t bitOffset,
+                        size_t count, std::string &out) {
+  bool escape = false;
+  for (size_t i = 0; i < count; ++i) {
+    appendSeptet(septetAt(packed, bitOffset, i), escape, out);
+  }
+}
+
+char semiOctetDigit(uint8_t nibble) {
+  static const char kDigits[] = "0123456789*#abc";
+  return nibble < 15 ? kDigits[nibble] : '\0';
+}
+
+enum class Alphabet { Gsm7, EightBit, Ucs2 };
+
+// 根据 TP-DCS（3GPP TS 23.038）确定字符集
+Alphabet alphabetOf(uint8_t dcs) {
+  switch (dcs >> 4) {
+  case 0x0:
+  case 0x1:
+  case 0x2:
+  case 0x3:
+  case 0x4:
+  case 0x5:
+  case 0x6:
+  case 0x7:
+    switch ((dcs >> 2) & 0x03) {
+    case 1:
+      return Alphabet::EightBit;
+    case 2:
+      return Alphabet::Ucs2;
+    default:
+      return Alphabet::Gsm7;
+    }
+  case 0xE:
+    return Alphabet::Ucs2;
+  case 0xF:
+    return (dcs & 0x04) ? Alphabet::EightBit : Alphabet::Gsm7;
+  default:
+    return Alphabet::Gsm7;
+  }
+}
+
+// 解析 UDH 中的分段信息元素
+void parseUserDataHeader(std::span<const uint8_t> udh, SMSPart &part) {
+  size_t pos = 0;
+  while (pos + 2 <= udh.size()) {
+    uint8_t iei = udh[pos];
+    uint8_t iel = udh[pos + 1];
+    pos += 2;
+    if (pos + iel > udh.size()) {
+      return;
+    }
+    if (iei == 0x00 && iel == 3) {
+      part.reference = udh[pos];
+      part.totalParts = udh[pos + 1];
+      part.partNumber = udh[pos + 2];
+    } else if (iei == 0x08 && iel == 4) {
+      part.reference = (udh[pos] << 8) | udh[pos + 1];
+      part.totalParts = udh[pos + 2];
+      part.partNumber = udh[pos + 3];
+    }
+    pos += iel;
+  }
+}
+
+// 单条短信与分段短信每个分段可携带的正文长度：GSM-7 为 septet 数，UCS-2 为
+// UTF-16 码元数。分段时 6 字节的 UDH 占去 7 个 septet 或 3 个码元
+constexpr size_t kGsm7Single = 160;
+constexpr size_t kGsm7Segment = 153;
+constexpr size_t kUcs2Single = 70;
+constexpr size_t kUcs2Segment = 67;
+constexpr size_t kMaxSegments = 255;
+
+// 逐个取出 UTF-8 码点，非法或截断的序列按 U+FFFD 处理
+std::u32string decodeUtf8(const std::string &text) {
+  std::u32string out;
+  out.reserve(text.size());
+  size_t i = 0;
+  while (i < text.size()) {
+    auto lead = static_cast<uint8_t>(text[i]);
+    size_t extra = lead < 0x80   ? 0
+                   : lead < 0xC2 ? 4 // 续字节或过长编码
+                   : lead < 0xE0 ? 1
+                   : lead < 0xF0 ? 2
+                   : lead < 0xF5 ? 3
+                                 : 4;
+    if (extra == 4 || i + extra >= text.size()) {
+      out.push_back(U'\uFFFD');
+      ++i;
+      continue;
+    }
+    char32_t cp = extra == 0 ? lead : lead & (0x3F >> extra);
+    size_t j = 1;
+    for (; j <= extra; ++j) {
+      auto next = static_cast<uint8_t>(text[i + j]);
+      if ((next & 0xC0) != 0x80)
+        break;
+      cp = (cp << 6) | (next & 0x3F);
+    }
+    if (j <= extra || (cp >= 0xD800 && cp <= 0xDFFF) || cp > 0x10FFFF ||
+        (extra == 2 && cp < 0x800) || (extra == 3 && cp < 0x10000)) {
+      out.push_back(U'\uFFFD');
+      i += j;
+      continue;
+    }
+    out.push_back(cp);
+    i += extra + 1;
+  }
+  return out;
+}
+
+// 码点的 GSM-7 编码：默认字母表为一个 septet，扩展表为 ESC 加一个 septet；
+// 无法表示时返回 0
+size_t gsm7Septets(char32_t cp, uint8_t out[2]) {
+  for (uint8_t septet = 0; septet < kGsm7Default.size(); ++septet) {
+    if (septet != kGsm7Escape && kGsm7Default[septet] == cp) {
+      out[0] = septet;
+      return 1;
+    }
+  }
+  for (uint8_t septet = 0; septet < 0x80; ++septet) {
+    char16_t ext = gsm7Extension(septet);
+    if (ext && ext == cp) {
+      out[0] = kGsm7Escape;
+      out[1] = septet;
+      return 2;
+    }
+  }
+  return 0;
+}
+
+// TP-DA：号码位数、号码类型（国际 0x91，未知 0x81）与半字节交换的 BCD
+bool appendDestination(const std::string &number, std::vector<uint8_t> &out) {
+  std::string_view digits(number);
+  bool international = !digits.empty() && digits[0] == '+';
+  if (international)
+    digits.remove_prefix(1);
+  if (digits.empty() || digits.size() > 20)
+    return false;
+  for (char c : digits) {
+    if (c < '0' || c > '9')
+      return false;
+  }
+  out.push_back(static_cast<uint8_t>(digits.size()));
+  out.push_back(international ? 0x91 : 0x81);
+  for (size_t i = 0; i < digits.size(); i += 2) {
+    uint8_t lo = digits[i] - '0';
+    uint8_t hi = i + 1 < digits.size() ? digits[i + 1] - '0' : 0x0F;
+    out.push_back(static_cast<uint8_t>((hi << 4) | lo));
+  }
+  return true;
+}
+
+// 构造一个分段的 SMS-SUBMIT：units 为 septet（GSM-7）或 UTF-16 码元（UCS-2）
+std::vector<uint8_t> buildSubmit(const std::vector<uint8_t> &destination,
+                                 bool gsm7, std::span<const uint16_t> units,
+                                 std::span<const uint8_t> udh) {
+  std::vector<uint8_t> out;
+  out.reserve(6 + destination.size() + 140);
+  out.push_back(0x00); // SMSC 信息长度为 0，使用设备配置的短信中心
+  // TP-MTI = 01（SMS-SUBMIT），不带有效期；有 UDH 时置 TP-UDHI
+  out.push_back(udh.empty() ? 0x01 : 0x41);
+  out.push_back(0x00); // TP-MR，由设备分配
+  out.insert(out.end(), destination.begin(), destination.end());
+  out.push_back(0x00);               // TP-PID
+  out.push_back(gsm7 ? 0x00 : 0x08); // TP-DCS
+
+  if (gsm7) {
+    // TP-UDL 为 septet 数；UDH 之后补齐到 septet 边界
+    size_t headerSeptets = (udh.size() * 8 + 6) / 7;
+    size_t septets = headerSeptets + units.size();
+    out.push_back(static_cast<uint8_t>(septets));
+    size_t start = out.size();
+    out.resize(start + (septets * 7 + 7) / 8, 0);
+    uint8_t *ud = out.data() + start;
+    std::copy(udh.begin(), udh.end(), ud);
+    for (size_t i = 0; i < units.size(); ++i) {
+      size_t bit = (headerSeptets + i) * 7;
+      unsigned shift = bit % 8;
+      ud[bit / 8] |= static_cast<uint8_t>(units[i] << shift);
+      if (shift > 1)
+        ud[bit / 8 + 1] |= static_cast<uint8_t>(units[i] >> (8 - shift));
+    }
+  } else {
+    out.push_back(static_cast<uint8_t>(udh.size() + units.size() * 2));
+    out.insert(out.end(), udh.begin(), udh.end());
+    for (uint16_t unit : units) {
+      out.push_back(static_cast<uint8_t>(unit >> 8));
+      out.push_back(static_cast<uint8_t>(unit & 0xFF));
+    }
+  }
+  return out;
+}
+
+} // namespace
+
+std::vector<std::vector<uint8_t>> encodeSubmit(const std::string &recipient,
+                                               const std::string &text,
+                                               uint8_t reference) {
+  std::vector<uint8_t> destination;
+  if (!appendDestination(recipient, destination))
+    return {};
+
+  // 正文按编码单位展开；boundary[i] 表示第 i 个单位是否为字符的开头，
+  // 分段只能在字符开头处切开
+  std::u32string codePoints = decodeUtf8(text);
+  std::vector<uint16_t> units;
+  std::vector<bool> boundary;
+  bool gsm7 = true;
+  for (char32_t cp : codePoints) {
+    uint8_t septets[2];
+    size_t count = gsm7Septets(cp, septets);
+    if (count == 0) {
+      gsm7 = false;
+      break;
+    }
+    for (size_t i = 0; i < count; ++i) {
+      units.push_back(septets[i]);
+      boundary.push_back(i == 0);
+    }
+  }
+  if (!gsm7) {
+    units.clear();
+    boundary.clear();
+    for (char32_t cp : codePoints) {
+      if (cp >= 0x10000) {
+        units.push_back(static_cast<uint16_t>(0xD800 + ((cp - 0x10000) >> 10)));
+        units.push_back(static_cast<uint16_t>(0xDC00 + ((cp - 0x10000) & 0x3FF)));
+        boundary.push_back(true);
+        boundary.push_back(false);
+      } else {
+        units.push_back(static_cast<uint16_t>(cp));
+        boundary.push_back(true);
+      }
+    }
+  }
+  boundary.push_back(true);
+
+  std::vector<std::pair<size_t, size_t>> chunks;
+  if (units.size() <= (gsm7 ? kGsm7Single : kUcs2Single)) {
+    chunks.emplace_back(0, units.size());
+  } else {
+    size_t segment = gsm7 ? kGsm7Segment : kUcs2Segment;
+    for (size_t start = 0; start < units.size();) {
+      size_t end = std::min(start + segment, units.size());
+      while (!boundary[end])
+        --end;
+      chunks.emplace_back(start, end);
+      start = end;
+    }
+  }
+  if (chunks.size() > kMaxSegments)
+    return {};
+
+  std::vector<std::vector<uint8_t>> pdus;
+  pdus.reserve(chunks.size());
+  std::span<const uint16_t> all(units);
+  for (size_t i = 0; i < chunks.size(); ++i) {
+    auto [start, end] = chunks[i];
+    std::array<uint8_t, 6> udh{0x05, 0x00, 0x03, reference,
+                               static_cast<uint8_t>(chunks.size()),
+                               static_cast<uint8_t>(i + 1)};
+    pdus.push_back(buildSubmit(
+        destination, gsm7, all.subspan(start, end - start),
+        chunks.size() > 1 ? std::span<const uint8_t>(udh)
+                          : std::span<const uint8_t>()));
+  }
+  return pdus;
+}
+
+void appendGsm7AsUtf8(std::span<const uint8_t> septets, std::string &out) {
+  bool escape = false;
+  for (uint8_t septet : septets) {
+    appendSeptet(septet & 0x7F, escape, out);
+  }
+}
+
+void appendUcs2AsUtf8(std::span<const uint8_t> bytes, std::string &out) {
+  for (size_t i = 0; i + 1 < bytes.size(); i += 2) {
+    uint32_t unit = (bytes[i] << 8) | bytes[i + 1];
+    if (unit >= 0xD800 && unit <= 0xDBFF && i + 3 < bytes.size()) {
+      uint32_t low = (bytes[i + 2] << 8) | bytes[i + 3];
+      if (low >= 0xDC00 && low <= 0xDFFF) {
+        appendUtf8(0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00), out);
+        i += 2;
+        continue;
+      }
+    }
+    // 落单的代理项（例如代理对被截断）不是合法字符，直接编码会得到无效的
+    // UTF-8，替换为 U+FFFD
+    if (unit >= 0xD800 && unit <= 0xDFFF)
+      unit = 0xFFFD;
+    appendUtf8(unit, out);
+  }
+}
+
+bool decodeDeliver(std::span<const uint8_t> data, SMSPart &part) {
+  size_t pos = 0;
+  auto need = [&](size_t n) { return pos + n <= data.size(); };
+
+  // SMSC 信息
+  if (!need(1))
+    return false;
+  pos += 1 + data[0];
+
+  // 首字节：仅处理 SMS-DELIVER（TP-MTI = 00）
+  if (!need(1))
+    return false;
+  uint8_t firstOctet = data[pos++];
+  if ((firstOctet & 0x03) != 0x00)
+    return false;
+  bool hasUdh = firstOctet & 0x40;
+
+  // 发件人地址（TP-OA）
+  if (!need(2))
+    return false;
+  uint8_t addressDigits = data[pos++];
+  uint8_t typeOfAddress = data[pos++];
+  size_t addressBytes = (addressDigits + 1) / 2;
+  if (!need(addressBytes))
+    return false;
+  auto address = data.subspan(pos, addressBytes);
+  pos += addressBytes;
+
+  part.sender.clear();
+  if ((typeOfAddress & 0x70) == 0x50) {
+    // 字母数字地址，以 GSM-7 打包
+    appendUnpackedGsm7(address, 0, addressDigits * 4 / 7, part.sender);
+  } else {
+    if ((typeOfAddress & 0x70) == 0x10)
+      part.sender.push_back('+');
+    for (size_t i = 0; i < addressDigits; ++i) {
+      uint8_t octet = address[i / 2];
+      char digit = semiOctetDigit(i % 2 ? octet >> 4 : octet & 0x0F);
+      if (digit)
+        part.sender.push_back(digit);
+    }
+  }
+
+  // TP-PID、TP-DCS、TP-SCTS（7 字节）、TP-UDL
+  if (!need(10))
+    return false;
+  pos += 1;
+  uint8_t dcs = data[pos++];
+  // 时间戳：逐字节交换半字节，得到 YYMMDDhhmmss 与时区共 14 位
+  part.timestamp.clear();
+  for (size_t i = 0; i < 7; ++i) {
+    uint8_t octet = data[pos + i];
+    part.timestamp.push_back(static_cast<char>('0' + (octet & 0x0F) % 10));
+    part.timestamp.push_back(static_cast<char>('0' + (octet >> 4) % 10));
+  }
+  pos += 7;
+  uint8_t userDataLength = data[pos++];
+  auto userData = data.subspan(pos);
+
+  part.reference = 0;
+  part.partNumber = 1;
+  part.totalParts = 1;
+  part.text.clear();
+
+  size_t headerBytes = 0;
+  if (hasUdh) {
+    if (userData.empty() || userData.size() < 1u + userData[0])
+      return false;
+    headerBytes = 1 + userData[0];
+    parseUserDataHeader(userData.subspan(1, userData[0]), part);
+  }
+
+  switch (alphabetOf(dcs)) {
+  case Alphabet::Gsm7: {
+    // UDL 为 septet 数；UDH 之后按 septet 边界对齐
+    size_t headerSeptets = (headerBytes * 8 + 6) / 7;
+    if ((static_cast<size_t>(userDataLength) * 7 + 7) / 8 > userData.size() ||
+        headerSeptets > userDataLength)
+      return false;
+    appendUnpackedGsm7(userData, headerSeptets * 7,
+                       userDataLength - headerSeptets, part.text);
+    break;
+  }
+  case Alphabet::Ucs2:
+    if (userDataLength > userData.size() || headerBytes > userDataLength)
+      return false;
+    appendUcs2AsUtf8(userData.subspan(headerBytes, userDataLength - headerBytes),
+                     part.text);
+    break;
+  case Alphabet::EightBit:
+    // 8-bit 数据按 Latin-1 转为 UTF-8
+    if (userDataLength > userData.size() || headerBytes > userDataLength)
+      return false;
+    for (size_t i = headerBytes; i < userDataLength; ++i)
+      appendUtf8(userData[i], part.text);
+    break;
+  }
+  return true;
+}
+
+} // namespace pdu
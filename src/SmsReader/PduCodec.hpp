@@ -0,0 +1,34 @@
+#ifndef PDU_CODEC_HPP
+#define PDU_CODEC_HPP
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "SmsTypes.hpp"
+
+namespace pdu {
+
+// 直接在二进制 PDU（含 SMSC 信息）上解析 SMS-DELIVER，填充 part 的文本、
+// 发件人、时间戳与分段信息。支持 GSM-7（含扩展表）、8-bit 与 UCS-2 正文，
+// 以及 8/16 位参考号的分段 UDH。长度不受限制，失败返回 false
+bool decodeDeliver(std::span<const uint8_t> data, SMSPart &part);
+
+// 将 UTF-8 文本编码为发往 recipient 的 SMS-SUBMIT PDU，每个分段一条，以空的
+// SMSC 信息开头（使用设备默认的短信中心）。正文均可用 GSM-7（含扩展表）表示
+// 时按 GSM-7 编码，否则按 UCS-2 编码；超出单条长度时按 8 位参考号的分段 UDH
+// 拆分，不拆开转义字符与代理对。号码无效或超过 255 个分段时返回空
+std::vector<std::vector<uint8_t>> encodeSubmit(const std::string &recipient,
+                                               const std::string &text,
+                                               uint8_t reference);
+
+// 将 GSM-7 默认字母表的 septet 序列转为 UTF-8
+void appendGsm7AsUtf8(std::span<const uint8_t> septets, std::string &out);
+
+// 将 UCS-2（UTF-16BE）字节序列转为 UTF-8；不成对的代理项替换为 U+FFFD
+void appendUcs2AsUtf8(std::span<const uint8_t> bytes, std::string &out);
+
+} // namespace pdu
+
+#endif // PDU_CODEC_HPP
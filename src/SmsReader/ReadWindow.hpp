@@ -0,0 +1,64 @@
+#ifndef READ_WINDOW_HPP
+#define READ_WINDOW_HPP
+
+#include <deque>
+#include <vector>
+
+#include "SmsTypes.hpp"
+
+// 原始读取的在途窗口：按列表顺序发出读取请求，同时在途的请求数不超过
+// maxInFlight，并统计已结束的请求数，用于判断一轮读取是否完成
+class ReadWindow {
+public:
+  explicit ReadWindow(int maxInFlight = 1) { setMaxInFlight(maxInFlight); }
+
+  void setMaxInFlight(int maxInFlight) {
+    maxInFlight_ = maxInFlight < 1 ? 1 : maxInFlight;
+  }
+  int maxInFlight() const { return maxInFlight_; }
+
+  // 以新的位置列表开始一轮读取，列表可以混合多个存储
+  void reset(const std::vector<MessageSlot> &slots) {
+    pending_.assign(slots.begin(), slots.end());
+    total_ = static_cast<int>(slots.size());
+    completed_ = 0;
+    inFlight_ = 0;
+  }
+
+  // 窗口未满且仍有待读取的短信时，取出下一个位置并计入在途
+  bool acquire(MessageSlot &slot) {
+    if (inFlight_ >= maxInFlight_ || pending_.empty()) {
+      return false;
+    }
+    slot = pending_.front();
+    pending_.pop_front();
+    ++inFlight_;
+    return true;
+  }
+
+  // 一个在途请求结束（成功、失败或放弃重试均算结束）
+  void release() {
+    --inFlight_;
+    ++completed_;
+  }
+
+  // 放弃尚未发出的位置，只等待在途的请求结束
+  void abandon() {
+    pending_.clear();
+    total_ = completed_ + inFlight_;
+  }
+
+  bool done() const { return completed_ >= total_; }
+  int inFlight() const { return inFlight_; }
+  int completed() const { return completed_; }
+  int total() const { return total_; }
+
+private:
+  int maxInFlight_ = 1;
+  std::deque<MessageSlot> pending_;
+  int total_ = 0;
+  int completed_ = 0;
+  int inFlight_ = 0;
+};
+
+#endif // READ_WINDOW_HPP
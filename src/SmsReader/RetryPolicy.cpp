@@ -0,0 +1,119 @@
+#include "RetryPolicy.hpp"
+
+#include <algorithm>
+
+RetryPolicy::RetryPolicy(WmsTransport &transport)
+    : RetryPolicy(transport, Options()) {}
+
+RetryPolicy::RetryPolicy(WmsTransport &transport, Options options)
+    : transport_(transport), rng_(std::random_device{}()) {
+  setOptions(options);
+}
+
+void RetryPolicy::setOptions(Options options) {
+  options_ = options;
+  if (options_.maxAttempts < 1)
+    options_.maxAttempts = 1;
+  options_.jitter = std::clamp(options_.jitter, 0.0, 1.0);
+  latency_ = {};
+  for (size_t i = 0; i < kWmsOperationCount; ++i)
+    applyTimeout(i, options_.maxTimeout);
+}
+
+void RetryPolicy::applyTimeout(size_t index,
+                               std::chrono::milliseconds timeout) {
+  timeoutMs_[index].store(timeout.count(), std::memory_order_relaxed);
+  transport_.setTimeout(static_cast<WmsOperation>(index), timeout);
+}
+
+std::optional<std::chrono::microseconds>
+RetryPolicy::nextDelay(Attempt &attempt) {
+  size_t op = static_cast<size_t>(attempt.op);
+  if (attempt.number >= options_.maxAttempts) {
+    ++giveUps_[op];
+    return std::nullopt;
+  }
+
+  // 指数退避：base × 2^(n-1)，封顶后乘以抖动系数
+  auto backoff = std::chrono::duration_cast<std::chrono::microseconds>(
+      options_.baseDelay);
+  auto cap =
+      std::chrono::duration_cast<std::chrono::microseconds>(options_.maxDelay);
+  for (int i = 1; i < attempt.number && backoff < cap; ++i)
+    backoff *= 2;
+  backoff = std::min(backoff, cap);
+  std::uniform_real_distribution<double> jitter(1.0 - options_.jitter, 1.0);
+  auto delay = std::chrono::microseconds(
+      static_cast<int64_t>(backoff.count() * jitter(rng_)));
+
+  // 等待加上下一次调用可能耗尽的超时仍须落在预算之内
+  auto elapsed = Clock::now() - attempt.started;
+  if (elapsed + delay + timeout(attempt.op) > options_.deadline) {
+    ++giveUps_[op];
+    return std::nullopt;
+  }
+  ++attempt.number;
+  ++retries_[op];
+  return delay;
+}
+
+void RetryPolicy::recordTimeout(WmsOperation op) {
+  size_t index = static_cast<size_t>(op);
+  ++timeouts_[index];
+  // 超时的调用至少耗时当前的超时时间，按该值记为样本，否则设备变慢后
+  // 所有调用都超时，再没有样本能把学到的超时时间抬高。同时直接加倍，
+  // 不必等样本足够
+  auto current = timeout(op);
+  addSample(index, std::chrono::duration_cast<std::chrono::microseconds>(
+                       current));
+  auto widened = std::min(current * 2, options_.maxTimeout);
+  if (auto learned = learnedTimeout(index))
+    widened = std::max(widened, *learned);
+  if (widened != current)
+    applyTimeout(index, widened);
+}
+
+void RetryPolicy::recordLatency(WmsOperation op,
+                                std::chrono::microseconds latency) {
+  size_t index = static_cast<size_t>(op);
+  addSample(index, latency);
+  auto timeout = learnedTimeout(index);
+  if (timeout &&
+      timeout->count() != timeoutMs_[index].load(std::memory_order_relaxed))
+    applyTimeout(index, *timeout);
+}
+
+void RetryPolicy::addSample(size_t index, std::chrono::microseconds latency) {
+  LatencyWindow &window = latency_[index];
+  window.samples[window.next] = latency.count();
+  window.next = (window.next + 1) % kLatencySamples;
+  if (window.count < kLatencySamples)
+    ++window.count;
+}
+
+std::optional<std::chrono::milliseconds>
+RetryPolicy::learnedTimeout(size_t index) const {
+  const LatencyWindow &window = latency_[index];
+  if (window.count < kMinSamples)
+    return std::nullopt;
+
+  std::array<int64_t, kLatencySamples> sorted = window.samples;
+  auto end = sorted.begin() + window.count;
+  auto p99 = sorted.begin() + (window.count * 99) / 100;
+  std::nth_element(sorted.begin(), p99, end);
+  auto timeout = std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::microseconds(
+          static_cast<int64_t>(*p99 * options_.timeoutFactor)));
+  return std::clamp(timeout, options_.minTimeout, options_.maxTimeout);
+}
+
+RetryPolicy::Stats RetryPolicy::stats() const {
+  Stats stats;
+  for (size_t i = 0; i < kWmsOperationCount; ++i) {
+    stats.retries[i] = retries_[i];
+    stats.giveUps[i] = giveUps_[i];
+    stats.timeouts[i] = timeouts_[i];
+    stats.currentTimeouts[i] = timeout(static_cast<WmsOperation>(i));
+  }
+  return stats;
+}
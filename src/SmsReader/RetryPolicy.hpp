@@ -0,0 +1,101 @@
+#ifndef RETRY_POLICY_HPP
+#define RETRY_POLICY_HPP
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+
+#include "WmsTransport.hpp"
+
+// WMS 调用的重试与超时策略，由一个读取器的全部操作共享。
+// 重试间隔按指数增长并封顶，叠加随机抖动，避免多个操作同时重试；每个操作
+// （含全部重试）有总时间预算，用尽后放弃。各类调用的超时时间取近期成功
+// 调用延迟的 p99 乘以倍数，限制在上下限之间，样本不足时使用上限；超时的
+// 调用按超时时间计入样本并使超时时间加倍，设备变慢时能重新放宽；超时时间
+// 变化时写入传输层。只在 I/O 线程上调用，统计可在任意线程读取。
+class RetryPolicy {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    int maxAttempts = 4;                      // 含首次调用
+    std::chrono::milliseconds baseDelay{100}; // 首次重试前的等待
+    std::chrono::milliseconds maxDelay{5000};
+    double jitter = 0.5; // 实际等待在退避时间的 [1-jitter, 1] 倍之间均匀分布
+    std::chrono::milliseconds deadline{30000}; // 单个操作的总预算
+    std::chrono::milliseconds minTimeout{1000};
+    std::chrono::milliseconds maxTimeout{10000};
+    double timeoutFactor = 4.0; // 超时 = p99 延迟 × 倍数
+  };
+
+  // 按调用种类（WmsOperation）索引
+  struct Stats {
+    std::array<uint64_t, kWmsOperationCount> retries{};
+    std::array<uint64_t, kWmsOperationCount> giveUps{};
+    std::array<uint64_t, kWmsOperationCount> timeouts{};
+    std::array<std::chrono::milliseconds, kWmsOperationCount> currentTimeouts{};
+  };
+
+  // 一个操作的重试状态，在首次调用前创建
+  struct Attempt {
+    explicit Attempt(WmsOperation operation)
+        : op(operation), started(Clock::now()) {}
+    WmsOperation op;
+    int number = 1;
+    Clock::time_point started;
+  };
+
+  explicit RetryPolicy(WmsTransport &transport);
+  RetryPolicy(WmsTransport &transport, Options options);
+
+  // 会清空已有的延迟样本
+  void setOptions(Options options);
+
+  // 调用失败后询问是否重试：允许时递增 attempt.number 并返回重试前的等待时间；
+  // 尝试次数或时间预算用尽时记为放弃并返回空
+  std::optional<std::chrono::microseconds> nextDelay(Attempt &attempt);
+
+  // 记录一次超时，放宽该类调用的超时时间
+  void recordTimeout(WmsOperation op);
+  // 记录一次成功调用的延迟，并更新该类调用的超时时间
+  void recordLatency(WmsOperation op, std::chrono::microseconds latency);
+
+  std::chrono::milliseconds timeout(WmsOperation op) const {
+    return std::chrono::milliseconds(
+        timeoutMs_[static_cast<size_t>(op)].load(std::memory_order_relaxed));
+  }
+
+  Stats stats() const;
+
+  static constexpr size_t kLatencySamples = 64;
+  static constexpr size_t kMinSamples = 16;
+
+private:
+  // 最近 kLatencySamples 次调用的延迟（微秒），环形覆盖；超时的调用记为
+  // 当时的超时时间
+  struct LatencyWindow {
+    std::array<int64_t, kLatencySamples> samples{};
+    size_t count = 0;
+    size_t next = 0;
+  };
+
+  void applyTimeout(size_t index, std::chrono::milliseconds timeout);
+  void addSample(size_t index, std::chrono::microseconds latency);
+  // 由样本的 p99 得出的超时时间，样本不足时为空
+  std::optional<std::chrono::milliseconds> learnedTimeout(size_t index) const;
+
+  WmsTransport &transport_;
+  Options options_;
+  std::minstd_rand rng_;
+  std::array<LatencyWindow, kWmsOperationCount> latency_;
+  std::array<std::atomic<int64_t>, kWmsOperationCount> timeoutMs_;
+  std::array<std::atomic<uint64_t>, kWmsOperationCount> retries_{};
+  std::array<std::atomic<uint64_t>, kWmsOperationCount> giveUps_{};
+  std::array<std::atomic<uint64_t>, kWmsOperationCount> timeouts_{};
+};
+
+#endif // RETRY_POLICY_HPP
@@ -0,0 +1,135 @@
+#include "SeenSet.hpp"
+
+#include <algorithm>
+
+namespace {
+
+void fnv1a(uint64_t &hash, const void *data, size_t size) {
+  const auto *bytes = static_cast<const uint8_t *>(data);
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ULL;
+  }
+}
+
+// splitmix64 的终结步骤，使高低位都均匀分布
+uint64_t mix(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+} // namespace
+
+SeenSet::SeenSet(size_t capacity) {
+  size_t buckets = 1;
+  while (buckets * kWays < capacity) {
+    buckets <<= 1;
+  }
+  bucketMask_ = buckets - 1;
+  fingerprints_.assign(buckets * kWays, 0);
+  lastSeen_.assign(buckets * kWays, 0);
+}
+
+uint64_t SeenSet::fingerprint(const CompleteSMS &sms) {
+  uint64_t hash = 14695981039346656037ULL;
+  // 各字段以长度分隔，避免拼接后产生歧义
+  auto field = [&hash](const std::string &value) {
+    uint64_t size = value.size();
+    fnv1a(hash, &size, sizeof(size));
+    fnv1a(hash, value.data(), value.size());
+  };
+  field(sms.sender);
+  field(sms.timestamp);
+  int32_t concat[2] = {0, 1};
+  if (!sms.parts.empty()) {
+    concat[0] = sms.parts.front().reference;
+    concat[1] = sms.parts.front().totalParts;
+  }
+  fnv1a(hash, concat, sizeof(concat));
+  field(sms.fullText);
+  uint64_t fp = mix(hash);
+  return fp == 0 ? 1 : fp;
+}
+
+size_t SeenSet::bucket(uint64_t fingerprint, int which) const {
+  // 指纹已充分混合，高低 32 位可视为相互独立
+  uint64_t bits = which == 0 ? fingerprint : fingerprint >> 32;
+  return (static_cast<size_t>(bits) & bucketMask_) * kWays;
+}
+
+size_t SeenSet::find(uint64_t fingerprint) const {
+  for (int which = 0; which < 2; ++which) {
+    size_t base = bucket(fingerprint, which);
+    for (size_t i = base; i < base + kWays; ++i) {
+      if (fingerprints_[i] == fingerprint)
+        return i;
+    }
+  }
+  return npos;
+}
+
+bool SeenSet::insert(uint64_t fingerprint) {
+  if (fingerprint == 0)
+    fingerprint = 1;
+  ++clock_;
+  size_t slot = find(fingerprint);
+  if (slot != npos) {
+    lastSeen_[slot] = clock_;
+    return false;
+  }
+
+  // 优先使用空槽，否则淘汰两个桶中最久未出现的指纹；时钟回绕时按无符号
+  // 差值比较仍然正确
+  size_t victim = npos;
+  uint32_t oldestAge = 0;
+  for (int which = 0; which < 2 && victim == npos; ++which) {
+    size_t base = bucket(fingerprint, which);
+    for (size_t i = base; i < base + kWays; ++i) {
+      if (fingerprints_[i] == 0) {
+        victim = i;
+        break;
+      }
+    }
+  }
+  if (victim == npos) {
+    for (int which = 0; which < 2; ++which) {
+      size_t base = bucket(fingerprint, which);
+      for (size_t i = base; i < base + kWays; ++i) {
+        uint32_t age = clock_ - lastSeen_[i];
+        if (victim == npos || age > oldestAge) {
+          victim = i;
+          oldestAge = age;
+        }
+      }
+    }
+    ++evictions_;
+  } else {
+    ++size_;
+  }
+  fingerprints_[victim] = fingerprint;
+  lastSeen_[victim] = clock_;
+  return true;
+}
+
+bool SeenSet::contains(uint64_t fingerprint) const {
+  return find(fingerprint == 0 ? 1 : fingerprint) != npos;
+}
+
+bool SeenSet::erase(uint64_t fingerprint) {
+  size_t slot = find(fingerprint == 0 ? 1 : fingerprint);
+  if (slot == npos)
+    return false;
+  fingerprints_[slot] = 0;
+  --size_;
+  return true;
+}
+
+void SeenSet::clear() {
+  std::fill(fingerprints_.begin(), fingerprints_.end(), 0);
+  std::fill(lastSeen_.begin(), lastSeen_.end(), 0);
+  size_ = 0;
+}
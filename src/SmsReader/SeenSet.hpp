@@ -0,0 +1,51 @@
+#ifndef SEEN_SET_HPP
+#define SEEN_SET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "SmsTypes.hpp"
+
+// 已投递短信的去重表：以内容指纹为键，容量固定。表按 8 路组相联组织，
+// 每个指纹有两个候选桶；两桶都满时淘汰其中最久未出现的指纹。
+// 查找与插入最多检查 16 个槽位，与容量无关。
+class SeenSet {
+public:
+  // capacity 为可记录的指纹数上限，向上取整到 2 的幂个桶
+  explicit SeenSet(size_t capacity = 16384);
+
+  // 指纹已存在时刷新其访问时间并返回 false；否则插入并返回 true
+  bool insert(uint64_t fingerprint);
+  bool contains(uint64_t fingerprint) const;
+  bool erase(uint64_t fingerprint);
+  void clear();
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return fingerprints_.size(); }
+  // 因容量不足被淘汰的指纹数
+  uint64_t evictions() const { return evictions_; }
+
+  // 短信内容指纹：发件人、时间戳、分段参考号与总分段数、正文
+  static uint64_t fingerprint(const CompleteSMS &sms);
+
+private:
+  static constexpr size_t kWays = 8;
+
+  // 指纹所在的槽位，不存在时返回 npos
+  size_t find(uint64_t fingerprint) const;
+  size_t bucket(uint64_t fingerprint, int which) const;
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  // 0 表示空槽，与之冲突的指纹改记为 1
+  std::vector<uint64_t> fingerprints_;
+  // 最近一次插入或命中时的时钟值，用于组内近似 LRU
+  std::vector<uint32_t> lastSeen_;
+  size_t bucketMask_ = 0;
+  size_t size_ = 0;
+  uint32_t clock_ = 0;
+  uint64_t evictions_ = 0;
+};
+
+#endif // SEEN_SET_HPP
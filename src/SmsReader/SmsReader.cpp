@@ -1,986 +1,1720 @@
 #include "SmsReader.hpp"
-#include "gio/gio.h"
-#include "glibconfig.h"
-#include "libqmi-glib.h"
+#include "PduCodec.hpp"
 
+#include <algorithm>
 #include <chrono>
-#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <sstream>
+#include <memory>
+#include <optional>
+#include <random>
 #include <stdexcept>
 #include <thread>
-
-// =======================
-// 设备初始化相关
-// =======================
-struct DeviceInitContext {
-  GMainLoop *loop;
-  QmiDevice *device;
-  bool success;
-};
-
-static void openCallback(QmiDevice *dev, GAsyncResult *res,
-                         gpointer user_data) {
-  DeviceInitContext *ctx = static_cast<DeviceInitContext *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  if (!qmi_device_open_finish(dev, res, &error)) {
-    std::cerr << "无法打开设备: " << error->message << std::endl;
-    ctx->success = false;
-    g_main_loop_quit(ctx->loop);
-    return;
-  }
-  ctx->device = dev;
-  ctx->success = true;
-  g_main_loop_quit(ctx->loop);
-}
-
-static void deviceNewCallback(GObject * /*source*/, GAsyncResult *res,
-                              gpointer user_data) {
-  DeviceInitContext *ctx = static_cast<DeviceInitContext *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  QmiDevice *dev = qmi_device_new_finish(res, &error);
-  if (!dev) {
-    std::cerr << "无法创建 QmiDevice: " << error->message << std::endl;
-    ctx->success = false;
-    g_main_loop_quit(ctx->loop);
-    return;
-  }
-  // 打开设备
-  qmi_device_open(dev,
-                  (QmiDeviceOpenFlags)(QMI_DEVICE_OPEN_FLAGS_PROXY |
-                                       QMI_DEVICE_OPEN_FLAGS_AUTO),
-                  10, /* timeout 秒 */
-                  nullptr, (GAsyncReadyCallback)openCallback, ctx);
-}
+#include <utility>
 
 // 构造函数
-QmiSmsReader::QmiSmsReader(const std::string &devicePath)
-    : devicePath_(devicePath) {
+QmiSmsReader::QmiSmsReader(std::unique_ptr<WmsTransport> transport,
+                           const std::string &devicePath, IoContext *io)
+    : ownedIo_(io ? nullptr : std::make_unique<IoContext>()),
+      io_(io ? *io : *ownedIo_), transport_(std::move(transport)),
+      retryPolicy_(*transport_),
+      clientPool_(*transport_, io_, retryPolicy_, kClientPoolSize),
+      devicePath_(devicePath) {
+  startup_.created = std::chrono::steady_clock::now();
+  // 分段参考号从随机值开始，重启后接收方不会把新旧短信的分段拼在一起
+  nextConcatReference_ = static_cast<uint8_t>(std::random_device{}());
   if (!initDevice()) {
     std::cerr << "设备初始化失败！" << std::endl;
     throw std::runtime_error("设备初始化失败");
   }
+  startup_.deviceOpened = std::chrono::steady_clock::now();
+  // 同时分配池中全部 client，持久 client 与首轮读取无需等待分配；
+  // 失败时在首次使用时再分配
+  size_t warmed = io_.start<size_t>([this](auto promise) {
+                       clientPool_.warm(kClientPoolSize,
+                                        [promise](size_t count) {
+                                          promise->set_value(count);
+                                        });
+                     }).get();
+  if (warmed == 0) {
+    std::cerr << "预分配 WMS 客户端失败" << std::endl;
+  }
+  startup_.clientReady = std::chrono::steady_clock::now();
 }
 
 // 析构函数
 QmiSmsReader::~QmiSmsReader() {
   stopListening();
+  // 不再接受新的短信，排队中尚未提交的短信以失败结束，等待在途的分段结束
+  io_.start<void>([this](auto promise) {
+       sendClosed_ = true;
+       failQueuedSends("stopped");
+       sendIdleWaiters_.push_back([promise] { promise->set_value(); });
+       pumpSends();
+     }).wait();
+  io_.start<void>([this](auto promise) {
+       timerGuard_.reset();
+       clientPool_.releaseAll([promise] { promise->set_value(); });
+     }).wait();
   closeDevice();
+  // 传输层在 I/O 线程上释放，与其回调所在的线程一致
+  io_.submit([this] { transport_.reset(); }).wait();
 }
 
+// =======================
+// 设备初始化相关
+// =======================
 bool QmiSmsReader::initDevice() {
-  DeviceInitContext ctx;
-  ctx.loop = g_main_loop_new(nullptr, FALSE);
-  ctx.device = nullptr;
-  ctx.success = false;
-
-  g_autoptr(GFile) file = g_file_new_for_path(devicePath_.c_str());
-  qmi_device_new(file, nullptr, deviceNewCallback, &ctx);
-
-  g_main_loop_run(ctx.loop);
-  g_main_loop_unref(ctx.loop);
-
-  if (!ctx.success) {
-    return false;
-  }
-  device_ = ctx.device;
-  return true;
-}
-
-void closeCallback(QmiDevice *dev, GAsyncResult *res, gpointer user_data) {
-  GMainLoop *loop = static_cast<GMainLoop *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  if (!qmi_device_close_finish(dev, res, &error)) {
-    std::cerr << "关闭设备失败: " << error->message << std::endl;
-  }
-  g_main_loop_quit(loop);
+  // 在 I/O 线程上打开设备，其后续读写都在该线程的 context 上分发
+  deviceOpen_ = io_.start<bool>([this](auto promise) {
+                     transport_->open(devicePath_, [promise](bool success) {
+                       promise->set_value(success);
+                     });
+                   }).get();
+  return deviceOpen_;
 }
 
 void QmiSmsReader::closeDevice() {
-  if (device_) {
-    GMainLoop *loop = g_main_loop_new(nullptr, FALSE);
-    qmi_device_close_async(device_, 10, nullptr,
-                           (GAsyncReadyCallback)closeCallback, loop);
-    g_main_loop_run(loop);
-    g_main_loop_unref(loop);
-    g_object_unref(device_);
-    device_ = nullptr;
+  if (deviceOpen_) {
+    io_.start<void>([this](auto promise) {
+         transport_->close([promise] { promise->set_value(); });
+       }).wait();
+    deviceOpen_ = false;
   }
 }
 
 // =======================
-// 同步 WMS Client 创建／释放封装
+// WMS Client 借用／归还
 // =======================
-void QmiSmsReader::synchronousAllocateClientCallback(QmiDevice *device,
-                                                     GAsyncResult *res,
-                                                     gpointer user_data) {
-  auto *ctx = static_cast<SynchronousClientContext *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  g_autoptr(QmiClient) client =
-      qmi_device_allocate_client_finish(device, res, &error);
-  if (error && error->message &&
-      strstr(error->message, "Transaction timed out")) {
-    ctx->client = nullptr;
-    ctx->success = false;
-    g_main_loop_quit(ctx->loop);
-    return;
-  }
-  if (!client) {
-    std::cerr << "无法分配 WMS 客户端: "
-              << (error ? error->message : "未知错误") << std::endl;
-    ctx->client = nullptr;
-    ctx->success = false;
-    g_main_loop_quit(ctx->loop);
+void QmiSmsReader::withClientAsync(
+    std::function<void(WmsClient *client,
+                       std::function<void(bool healthy)> release)>
+        op) {
+  // 若已有持久 client，则复用；否则从池中借用，操作结束后归还
+  if (persistentClient_) {
+    op(persistentClient_, [](bool) {});
     return;
   }
-  ctx->client = QMI_CLIENT_WMS(g_object_ref(client));
-  ctx->success = true;
-  g_main_loop_quit(ctx->loop);
-}
-
-QmiClientWms *QmiSmsReader::createWmsClientSync() {
-  const int maxRetries = 3;
-  int retries = 0;
-  QmiClientWms *client = nullptr;
-  while (retries < maxRetries) {
-    SynchronousClientContext ctx;
-    ctx.loop = g_main_loop_new(nullptr, FALSE);
-    ctx.client = nullptr;
-    ctx.success = false;
-    qmi_device_allocate_client(
-        device_, QMI_SERVICE_WMS, QMI_CID_NONE, 10, nullptr,
-        (GAsyncReadyCallback)synchronousAllocateClientCallback, &ctx);
-    g_main_loop_run(ctx.loop);
-    g_main_loop_unref(ctx.loop);
-    if (ctx.success && ctx.client != nullptr) {
-      client = ctx.client;
-      break;
+  clientPool_.lease([this, op = std::move(op)](WmsClient *client) {
+    if (!client) {
+      op(nullptr, [](bool) {});
+      return;
     }
-    ++retries;
-  }
-  return client;
-}
-
-void QmiSmsReader::synchronousReleaseClientCallback(QmiDevice *device,
-                                                    GAsyncResult *res,
-                                                    gpointer user_data) {
-  auto *ctx = static_cast<ReleaseClientContext *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  if (!qmi_device_release_client_finish(device, res, &error)) {
-    std::cerr << "关闭客户端失败: " << (error ? error->message : "未知错误")
-              << std::endl;
-    ctx->success = false;
-  } else {
-    ctx->success = true;
-  }
-  g_main_loop_quit(ctx->loop);
-}
-
-void QmiSmsReader::releaseWmsClientSync(QmiClientWms *client) {
-  ReleaseClientContext ctx;
-  ctx.loop = g_main_loop_new(nullptr, FALSE);
-  ctx.success = false;
-  qmi_device_release_client(
-      device_, QMI_CLIENT(client), QMI_DEVICE_RELEASE_CLIENT_FLAGS_NONE, 10,
-      nullptr, (GAsyncReadyCallback)synchronousReleaseClientCallback, &ctx);
-  g_main_loop_run(ctx.loop);
-  g_main_loop_unref(ctx.loop);
+    op(client, [this, client](bool healthy) {
+      clientPool_.giveBack(client, healthy);
+    });
+  });
 }
 
 // =======================
-// 短信读取（同步）
+// 短信读取
 // =======================
 std::vector<CompleteSMS> QmiSmsReader::readAllMessages() {
-  return performSyncRead();
+  return readAllMessagesAsync().get();
 }
 
-// 创建列表消息回调
-static void listCallback(QmiClientWms *client, GAsyncResult *res,
-                         gpointer user_data) {
-  auto *listCtx = static_cast<ListContext *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  g_autoptr(QmiMessageWmsListMessagesOutput) output =
-      qmi_client_wms_list_messages_finish(client, res, &error);
+std::future<std::vector<CompleteSMS>> QmiSmsReader::readAllMessagesAsync() {
+  return io_.start<std::vector<CompleteSMS>>([this](auto promise) {
+    withClientAsync([this, promise](WmsClient *client,
+                                    std::function<void(bool)> release) {
+      if (!client) {
+        promise->set_value({});
+        return;
+      }
+      // 先列出各存储中的短信位置
+      listStoragesAsync(client, WmsMessageTag::Unread,
+                        [this, promise, client,
+                         release](std::vector<StorageListing> listings) {
+        bool listed = false;
+        std::vector<MessageSlot> slots;
+        for (const auto &listing : listings) {
+          listed = listed || listing.listed;
+          for (int index : listing.indices)
+            slots.push_back(MessageSlot{listing.storage, index});
+        }
+        if (slots.empty()) {
+          release(listed);
+          promise->set_value({});
+          return;
+        }
+        auto *ctx = new MessageSyncContext;
+        ctx->client = client;
+        ctx->clientEpoch = clientEpoch_;
+        ctx->drained = [this, ctx, promise, release] {
+          // 解析并处理所有短信（例如多段短信拼接）
+          decodeAllParts(ctx);
+          processAllSMS(ctx);
+
+          release(true);
+          if (ctx->replacementClient)
+            clientPool_.giveBack(ctx->replacementClient);
+          // 重复短信分段交给删除队列，不等待删除完成
+          if (!ctx->toDeleteSlots.empty()) {
+            std::cerr << "删除 " << ctx->toDeleteSlots.size()
+                      << " 个重复短信分段" << std::endl;
+          }
+          for (const MessageSlot &slot : ctx->toDeleteSlots)
+            enqueueDelete(slot);
+          for (auto &sms : ctx->completeSMSList)
+            sms.deviceId = deviceId_;
+          promise->set_value(std::move(ctx->completeSMSList));
+          delete ctx;
+        };
+        readSlotsAsync(ctx, slots);
+      });
+    });
+  });
+}
+
+
+std::vector<MessageSlot> QmiSmsReader::listAllMessages(bool *success) {
+  using ListResult = std::pair<bool, std::vector<MessageSlot>>;
+  auto result = io_.start<ListResult>([this](auto promise) {
+    withClientAsync([this, promise](WmsClient *client,
+                                    std::function<void(bool)> release) {
+      if (!client) {
+        promise->set_value(ListResult{false, {}});
+        return;
+      }
+      listStoragesAsync(
+          client, WmsMessageTag::Unread,
+          [promise, release](std::vector<StorageListing> listings) {
+            ListResult result{false, {}};
+            for (const auto &listing : listings) {
+              result.first = result.first || listing.listed;
+              for (int index : listing.indices)
+                result.second.push_back(MessageSlot{listing.storage, index});
+            }
+            release(result.first);
+            promise->set_value(std::move(result));
+          });
+    });
+  });
+  auto [listed, slots] = result.get();
+  if (success)
+    *success = listed;
+  return slots;
+}
 
-  if (!output ||
-      !qmi_message_wms_list_messages_output_get_result(output, &error)) {
-    std::cerr << "列出短信列表失败: " << error->message << std::endl;
-    g_main_loop_quit(listCtx->loop);
+void QmiSmsReader::setStorages(std::vector<SmsStorage> storages) {
+  std::sort(storages.begin(), storages.end());
+  storages.erase(std::unique(storages.begin(), storages.end()),
+                 storages.end());
+  if (listening_ || storages.empty()) {
     return;
   }
+  io_.submit([this, storages = std::move(storages)] {
+       storages_ = storages;
+       storageErrors_ = {};
+     }).wait();
+}
 
-  GArray *message_list = nullptr;
-  qmi_message_wms_list_messages_output_get_message_list(output, &message_list,
-                                                        nullptr);
-  if (message_list) {
-    for (guint i = 0; i < message_list->len; i++) {
-      auto *msg = &g_array_index(
-          message_list, QmiMessageWmsListMessagesOutputMessageListElement, i);
-      listCtx->messageIndices->push_back(msg->memory_index);
-    }
-    listCtx->success = true;
+void QmiSmsReader::listStoragesAsync(
+    WmsClient *client, WmsMessageTag tag,
+    std::function<void(std::vector<StorageListing>)> done) {
+  // 列出失败的存储可能在回调中被移出 storages_，这里先复制一份
+  std::vector<SmsStorage> storages = storages_;
+  if (storages.empty()) {
+    done({});
+    return;
   }
-  g_main_loop_quit(listCtx->loop);
-};
-
-std::vector<int> QmiSmsReader::listAllMessages(bool alreadyLocked) {
-  // 只有在未持有锁时才获取锁
-  std::unique_lock<std::mutex> opLock(clientOperationMutex_, std::defer_lock);
-  if (!alreadyLocked) {
-    opLock.lock();
+  struct Progress {
+    size_t remaining;
+    std::vector<StorageListing> listings;
+    std::function<void(std::vector<StorageListing>)> done;
+  };
+  auto progress = std::make_shared<Progress>(
+      Progress{storages.size(), {}, std::move(done)});
+  progress->listings.resize(storages.size());
+  // 各存储的列表同时发出，不必等前一个应答后再列下一个
+  for (size_t i = 0; i < storages.size(); ++i) {
+    listStorageAsync(client, storages[i], tag,
+                     RetryPolicy::Attempt(WmsOperation::List),
+                     [progress, i](StorageListing listing) {
+                       progress->listings[i] = std::move(listing);
+                       if (--progress->remaining == 0)
+                         progress->done(std::move(progress->listings));
+                     });
   }
+}
+
+void QmiSmsReader::listStorageAsync(WmsClient *client, SmsStorage storage,
+                                    WmsMessageTag tag,
+                                    RetryPolicy::Attempt attempt,
+                                    std::function<void(StorageListing)> done) {
+  auto issued = RetryPolicy::Clock::now();
+  transport_->listMessages(
+      client, storage, tag,
+      [this, client, storage, tag, attempt, issued, done = std::move(done)](
+          WmsStatus status, std::vector<int> indices) mutable {
+        size_t s = static_cast<size_t>(storage);
+        if (status == WmsStatus::Ok) {
+          recordLatency(WmsOperation::List, issued);
+          storageErrors_[s] = 0;
+          done(StorageListing{storage, true, std::move(indices)});
+          return;
+        }
+        if (status == WmsStatus::Timeout) {
+          retryPolicy_.recordTimeout(WmsOperation::List);
+          noteFailure();
+          // 退避后重新列出，不必等到下一次指示或轮询；停止监听时放弃
+          if (listening_ || client != persistentClient_) {
+            if (auto delay = retryPolicy_.nextDelay(attempt)) {
+              io_.postAfter(*delay, [this, client, storage, tag, attempt,
+                                     done = std::move(done)]() mutable {
+                listStorageAsync(client, storage, tag, attempt,
+                                 std::move(done));
+              });
+              return;
+            }
+          }
+        } else if (storage == SmsStorage::Uim) {
+          noteFailure();
+        } else if (++storageErrors_[s] >= kStorageErrorLimit &&
+                   storages_.size() > 1) {
+          // 部分设备不支持 NV 存储，每次列出都会出错
+          std::cerr << "连续 " << storageErrors_[s] << " 次列出 "
+                    << smsStorageName(storage)
+                    << " 存储失败，本次运行不再读取该存储" << std::endl;
+          std::erase(storages_, storage);
+        }
+        done(StorageListing{storage, false, {}});
+      });
+}
 
-  std::vector<int> messageIndices;
+void QmiSmsReader::setReadWindow(int maxInFlight) {
+  readWindow_ = maxInFlight < 1 ? 1 : maxInFlight;
+}
 
-  auto *ctx = new MessageSyncContext;
-  ctx->loop = g_main_loop_new(nullptr, FALSE);
-  ctx->device = device_;
+void QmiSmsReader::readSlotsAsync(MessageSyncContext *ctx,
+                                  const std::vector<MessageSlot> &slots) {
+  // 以在途窗口发出原始读取请求，各存储共用同一个窗口
+  ctx->window.setMaxInFlight(readWindow_);
+  ctx->window.reset(slots);
+  pumpRawReads(ctx);
+}
 
-  // 若已有持久 client，则复用；否则创建临时 client
-  {
-    std::unique_lock lock(persistentClientMutex_);
-    if (persistentClient_) {
-      ctx->client = persistentClient_;
-      ctx->temporaryClient = false;
-    }
+
+void QmiSmsReader::pumpRawReads(MessageSyncContext *ctx) {
+  MessageSlot slot;
+  while (ctx->window.acquire(slot)) {
+    issueRawRead(ctx, slot, RetryPolicy::Attempt(WmsOperation::RawRead));
+  }
+  if (ctx->window.done() && ctx->drained) {
+    // drained 可能释放 ctx，先取出
+    auto drained = std::move(ctx->drained);
+    ctx->drained = nullptr;
+    drained();
   }
+}
 
-  if (ctx->client == nullptr) {
-    ctx->client = createWmsClientSync();
-    ctx->temporaryClient = true;
-    if (!ctx->client) {
-      std::cerr << "无法分配临时 WMS 客户端" << std::endl;
-      g_main_loop_unref(ctx->loop);
-      delete ctx;
-      return messageIndices;
+void QmiSmsReader::issueRawRead(MessageSyncContext *ctx, MessageSlot slot,
+                                RetryPolicy::Attempt attempt) {
+  if (abandoned(ctx) || !ctx->client) {
+    ctx->window.release();
+    pumpRawReads(ctx);
+    return;
+  }
+  if (ctx->clientEpoch != clientEpoch_) {
+    // 退避期间设备被重新打开，原 client 已失效；借一个新的再重试，
+    // 同一上下文的多个重试共用一次借用
+    ctx->clientWaiters.push_back(
+        [this, ctx, slot, attempt] { issueRawRead(ctx, slot, attempt); });
+    if (ctx->clientWaiters.size() > 1) {
+      return;
     }
+    clientPool_.lease([this, ctx](WmsClient *client) {
+      if (ctx->replacementClient)
+        clientPool_.giveBack(ctx->replacementClient);
+      ctx->replacementClient = client;
+      ctx->client = client;
+      ctx->clientEpoch = clientEpoch_;
+      auto waiters = std::move(ctx->clientWaiters);
+      ctx->clientWaiters.clear();
+      for (auto &waiter : waiters)
+        waiter();
+    });
+    return;
   }
+  auto issued = RetryPolicy::Clock::now();
+  transport_->rawRead(
+      ctx->client, slot,
+      [this, ctx, slot, attempt, issued](
+          WmsStatus status, std::vector<uint8_t> pdu) mutable {
+        if (abandoned(ctx)) {
+          ctx->window.release();
+          pumpRawReads(ctx);
+          return;
+        }
+        if (status == WmsStatus::Timeout) {
+          retryPolicy_.recordTimeout(WmsOperation::RawRead);
+          noteFailure();
+          // 退避后重新发出，等待期间请求仍占用窗口
+          if (auto delay = retryPolicy_.nextDelay(attempt)) {
+            std::cout << "读取短信（" << slot << "）超时，"
+                      << delay->count() / 1000 << " ms 后第 "
+                      << attempt.number << " 次尝试" << std::endl;
+            io_.postAfter(*delay, [this, ctx, slot, attempt] {
+              issueRawRead(ctx, slot, attempt);
+            });
+            return;
+          }
+          std::cerr << "读取短信内容（" << slot << "）失败: 多次超时"
+                    << std::endl;
+        } else if (status == WmsStatus::Ok) {
+          recordLatency(WmsOperation::RawRead, issued);
+        }
+        if (status == WmsStatus::Ok && !pdu.empty()) {
+          // 只保留二进制 PDU，解析时直接在字节上进行
+          SMSPart &part = ctx->rawSMSMap[slot];
+          part.slot = slot;
+          part.rawData = std::move(pdu);
+        } else if (status == WmsStatus::Ok) {
+          std::cout << "短信（" << slot << "）无内容或读取为空。"
+                    << std::endl;
+        }
 
-  g_autoptr(GError) error = nullptr;
-  // 输入参数对象
-  QmiMessageWmsListMessagesInput *input =
-      qmi_message_wms_list_messages_input_new();
+        if (ctx->streaming) {
+          ++cycleReadsDone_;
+          streamFetched(ctx);
+        }
+        // 释放窗口并补充新的读取请求；全部结束时继续后续步骤
+        ctx->window.release();
+        pumpRawReads(ctx);
+      });
+}
 
-  // 设置存储类型
-  if (!qmi_message_wms_list_messages_input_set_storage_type(
-          input,
-          QMI_WMS_STORAGE_TYPE_UIM, // SIM/UIM 卡
-          &error)) {
-    g_printerr("Error setting storage type: %s\n", error->message);
-    qmi_message_wms_list_messages_input_unref(input);
-    if (ctx->temporaryClient)
-      releaseWmsClientSync(ctx->client);
-    g_main_loop_unref(ctx->loop);
-    delete ctx;
-    return messageIndices;
-  }
+// =======================
+// 短信删除
+// =======================
+bool QmiSmsReader::deleteMessage(MessageSlot slot) {
+  return deleteMessageAsync(slot).get();
+}
 
-  // QMI_WMS_MESSAGE_MODE_GSM_WCDMA
-  if (!qmi_message_wms_list_messages_input_set_message_mode(
-          input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
-    g_printerr("Error setting message mode: %s\n", error->message);
-    qmi_message_wms_list_messages_input_unref(input);
-    if (ctx->temporaryClient)
-      releaseWmsClientSync(ctx->client);
-    g_main_loop_unref(ctx->loop);
-    delete ctx;
-    return messageIndices;
-  }
+std::future<bool> QmiSmsReader::deleteMessageAsync(MessageSlot slot) {
+  return io_.start<bool>([this, slot](auto promise) {
+    enqueueDelete(slot,
+                  [promise](bool success) { promise->set_value(success); });
+  });
+}
 
-  // QMI_WMS_MESSAGE_TAG_TYPE_MT_READ
-  if (!qmi_message_wms_list_messages_input_set_message_tag(
-          input, QMI_WMS_MESSAGE_TAG_TYPE_MT_NOT_READ, &error)) {
-    g_printerr("Error setting message tag: %s\n", error->message);
-    qmi_message_wms_list_messages_input_unref(input);
-    if (ctx->temporaryClient)
-      releaseWmsClientSync(ctx->client);
-    g_main_loop_unref(ctx->loop);
-    delete ctx;
-    return messageIndices;
-  }
+std::future<size_t>
+QmiSmsReader::deleteMessagesAsync(std::vector<MessageSlot> slots) {
+  return io_.start<size_t>([this, slots = std::move(slots)](auto promise) {
+    if (slots.empty()) {
+      promise->set_value(0);
+      return;
+    }
+    struct Progress {
+      size_t remaining;
+      size_t deleted = 0;
+    };
+    auto progress = std::make_shared<Progress>(Progress{slots.size()});
+    for (const MessageSlot &slot : slots) {
+      enqueueDelete(slot, [promise, progress](bool success) {
+        if (success)
+          ++progress->deleted;
+        if (--progress->remaining == 0)
+          promise->set_value(progress->deleted);
+      });
+    }
+  });
+}
 
-  // 创建单独的GMainLoop用于同步等待列表请求完成
-  GMainLoop *listLoop = g_main_loop_new(nullptr, FALSE);
+void QmiSmsReader::waitForDeletes() {
+  io_.start<void>([this](auto promise) {
+       deleteDrainWaiters_.push_back([promise] { promise->set_value(); });
+       pumpDeletes();
+     }).wait();
+}
 
-  ListContext listCtx;
-  listCtx.loop = listLoop;
-  listCtx.messageIndices = &messageIndices;
-  listCtx.success = false;
 
-  // 发起列表消息请求
-  qmi_client_wms_list_messages(QMI_CLIENT_WMS(ctx->client), input, 10, nullptr,
-                               (GAsyncReadyCallback)listCallback, &listCtx);
+void QmiSmsReader::recordLatency(WmsOperation op,
+                                 RetryPolicy::Clock::time_point issued) {
+  consecutiveFailures_ = 0;
+  retryPolicy_.recordLatency(
+      op, std::chrono::duration_cast<std::chrono::microseconds>(
+              RetryPolicy::Clock::now() - issued));
+}
 
-  qmi_message_wms_list_messages_input_unref(input);
+void QmiSmsReader::setRetryOptions(const RetryPolicy::Options &options) {
+  io_.submit([this, options] { retryPolicy_.setOptions(options); }).wait();
+}
 
-  // 等待列表请求完成
-  g_main_loop_run(listLoop);
-  g_main_loop_unref(listLoop);
+void QmiSmsReader::deleteSlotAsync(WmsClient *client, MessageSlot slot,
+                                   RetryPolicy::Attempt attempt,
+                                   std::function<void(bool success)> done) {
+  auto issued = RetryPolicy::Clock::now();
+  transport_->deleteMessage(
+      client, slot,
+      [this, client, slot, attempt, issued,
+       done = std::move(done)](WmsStatus status) mutable {
+        if (status == WmsStatus::Timeout) {
+          retryPolicy_.recordTimeout(WmsOperation::Delete);
+          noteFailure();
+          if (auto delay = retryPolicy_.nextDelay(attempt)) {
+            io_.postAfter(*delay, [this, client, slot, attempt,
+                                   done = std::move(done)]() mutable {
+              deleteSlotAsync(client, slot, attempt, std::move(done));
+            });
+            return;
+          }
+          std::cerr << "删除短信（" << slot << "）失败: 多次超时"
+                    << std::endl;
+        }
+        if (status == WmsStatus::Error && attempt.number > 1) {
+          // 超时的请求可能已在设备上生效，重试时该索引已不存在；但出错也可能
+          // 是 client 失效或存储故障，列出该存储确认索引确实已空出
+          confirmDeletedAsync(client, slot,
+                              [this, slot, done = std::move(done)](
+                                  bool gone) mutable {
+                                if (gone)
+                                  forgetDeletedSlot(slot);
+                                else
+                                  std::cerr << "删除短信（" << slot
+                                            << "）失败: 重试出错且短信仍在"
+                                            << std::endl;
+                                done(gone);
+                              });
+          return;
+        }
+        bool success = status == WmsStatus::Ok;
+        if (success) {
+          recordLatency(WmsOperation::Delete, issued);
+          forgetDeletedSlot(slot);
+        }
+        done(success);
+      });
+}
 
-  if (ctx->temporaryClient)
-    releaseWmsClientSync(ctx->client);
+void QmiSmsReader::confirmDeletedAsync(WmsClient *client, MessageSlot slot,
+                                       std::function<void(bool gone)> done) {
+  // 短信只会带未读或已读标签；两个列表都成功且都不含该索引才算已删除
+  struct Progress {
+    int remaining = 2;
+    bool gone = true;
+    std::function<void(bool)> done;
+  };
+  auto progress = std::make_shared<Progress>();
+  progress->done = std::move(done);
+  for (WmsMessageTag tag : {WmsMessageTag::Unread, WmsMessageTag::Read}) {
+    transport_->listMessages(
+        client, slot.storage, tag,
+        [progress, slot](WmsStatus status, std::vector<int> indices) {
+          if (status != WmsStatus::Ok ||
+              std::find(indices.begin(), indices.end(), slot.index) !=
+                  indices.end())
+            progress->gone = false;
+          if (--progress->remaining == 0)
+            progress->done(progress->gone);
+        });
+  }
+}
 
-  g_main_loop_unref(ctx->loop);
-  delete ctx;
+void QmiSmsReader::forgetDeletedSlot(MessageSlot slot) {
+  // 位置释放后可能被设备复用，不能再沿用缓存；只有监听读取过的位置才在
+  // 重组表中
+  if (partCache_.erase(slot))
+    pendingRemovals_.push_back(slot);
+  bool read = markedRead_.erase(slot) > 0;
+  adjustUsage(slot.storage, read ? 0 : -1, read ? -1 : 0);
+}
 
-  return messageIndices;
+void QmiSmsReader::enqueueDelete(MessageSlot slot,
+                                 std::function<void(bool success)> done) {
+  deleteQueue_.push_back(PendingDelete{slot, std::move(done)});
+  deletingSlots_.insert(slot);
+  // 推迟到当前事件处理完再提交，使连续加入的删除能一起判断是否按标签删除
+  if (!deletePumpPosted_) {
+    deletePumpPosted_ = true;
+    io_.post([this] {
+      deletePumpPosted_ = false;
+      pumpDeletes();
+    });
+  }
 }
 
-std::vector<CompleteSMS> QmiSmsReader::performSyncRead() {
-  // 序列化对 client 的操作
-  std::unique_lock opLock(clientOperationMutex_);
-  auto *ctx = new MessageSyncContext;
-  ctx->loop = g_main_loop_new(nullptr, FALSE);
-  ctx->device = device_;
+void QmiSmsReader::finishDelete(PendingDelete item, bool success) {
+  auto it = deletingSlots_.find(item.slot);
+  if (it != deletingSlots_.end())
+    deletingSlots_.erase(it);
+  if (item.done)
+    item.done(success);
+}
 
-  // 若已有持久 client，则复用；否则创建临时 client
-  {
-    std::unique_lock lock(persistentClientMutex_);
-    if (persistentClient_) {
-      ctx->client = persistentClient_;
-      ctx->temporaryClient = false;
+void QmiSmsReader::pumpDeletes() {
+  // 清空模式下腾出存储优先，读取进行中也继续提交删除
+  if ((cycleActive_ && !draining_) || tagDeleteInFlight_ ||
+      leasingDeleteClient_ || recovering_) {
+    return;
+  }
+  if (deleteQueue_.empty()) {
+    if (deletesInFlight_ > 0) {
+      return;
+    }
+    if (deleteClient_) {
+      clientPool_.giveBack(deleteClient_);
+      deleteClient_ = nullptr;
     }
+    auto waiters = std::move(deleteDrainWaiters_);
+    deleteDrainWaiters_.clear();
+    for (auto &waiter : waiters)
+      waiter();
+    return;
   }
 
-  if (ctx->client == nullptr) {
-    ctx->client = createWmsClientSync();
-    ctx->temporaryClient = true;
-    if (!ctx->client) {
-      std::cerr << "无法分配临时 WMS 客户端" << std::endl;
-      g_main_loop_unref(ctx->loop);
-      delete ctx;
-      return std::vector<CompleteSMS>();
-    }
+  // 监听中复用持久 client，否则为本批删除从池中借用一个
+  WmsClient *client = persistentClient_ ? persistentClient_ : deleteClient_;
+  if (!client) {
+    leasingDeleteClient_ = true;
+    clientPool_.lease([this](WmsClient *leased) {
+      leasingDeleteClient_ = false;
+      if (!leased) {
+        std::cerr << "无法取得 WMS 客户端，放弃 " << deleteQueue_.size()
+                  << " 条排队的删除" << std::endl;
+        auto queue = std::move(deleteQueue_);
+        deleteQueue_.clear();
+        for (auto &item : queue)
+          finishDelete(std::move(item), false);
+      }
+      deleteClient_ = leased;
+      pumpDeletes();
+    });
+    return;
   }
 
-  // 先获取所有短信索引
-  std::vector<int> messageIndices;
-  {
-    // 临时释放当前锁，以便让 listAllMessages 可以获取锁
-    opLock.unlock();
-    messageIndices = listAllMessages();
-    opLock.lock();
+  if (tryDeleteByTag(client)) {
+    return;
   }
+  while (deletesInFlight_ < readWindow_ && !deleteQueue_.empty()) {
+    PendingDelete item = std::move(deleteQueue_.front());
+    deleteQueue_.pop_front();
+    ++deletesInFlight_;
+    MessageSlot slot = item.slot;
+    deleteSlotAsync(client, slot, RetryPolicy::Attempt(WmsOperation::Delete),
+                    [this, item = std::move(item)](bool success) mutable {
+                      --deletesInFlight_;
+                      finishDelete(std::move(item), success);
+                      pumpDeletes();
+                    });
+  }
+}
 
-  if (messageIndices.empty()) {
-    if (ctx->temporaryClient)
-      releaseWmsClientSync(ctx->client);
-    g_main_loop_unref(ctx->loop);
-    delete ctx;
-    return std::vector<CompleteSMS>();
+bool QmiSmsReader::tryDeleteByTag(WmsClient *client) {
+  // 新到达的短信总是未读，按已读标签删除不会误删尚未转发的短信；但存储中
+  // 可能还有其他已读短信，所以必须先核对已读列表。每次只处理一个存储
+  // 在途的标记可能在核对之后才生效，使删除波及未排队的短信
+  if (markedRead_.empty() || markReadsInFlight_ > 0 ||
+      deleteQueue_.size() < kTagDeleteMinBatch) {
+    return false;
+  }
+  std::unordered_set<MessageSlot, MessageSlotHash> queued;
+  for (const auto &item : deleteQueue_)
+    queued.insert(item.slot);
+  std::optional<SmsStorage> target;
+  for (SmsStorage storage : {SmsStorage::Uim, SmsStorage::Nv}) {
+    bool marked = false;
+    bool covered = true;
+    for (const MessageSlot &slot : markedRead_) {
+      if (slot.storage != storage)
+        continue;
+      marked = true;
+      if (!queued.count(slot)) {
+        covered = false;
+        break;
+      }
+    }
+    if (marked && covered) {
+      target = storage;
+      break;
+    }
+  }
+  if (!target) {
+    return false;
   }
 
-  // 设置总数量，用于跟踪处理进度
-  ctx->totalSMSCount = messageIndices.size();
+  SmsStorage storage = *target;
+  auto forgetMarked = [this, storage] {
+    std::erase_if(markedRead_, [storage](const MessageSlot &slot) {
+      return slot.storage == storage;
+    });
+  };
+  tagDeleteInFlight_ = true;
+  transport_->listMessages(
+      client, storage, WmsMessageTag::Read,
+      [this, client, storage, forgetMarked](WmsStatus status,
+                                            std::vector<int> readIndices) {
+        // 核对期间不提交其他删除，队列只会增长
+        std::unordered_set<MessageSlot, MessageSlotHash> queued;
+        for (const auto &item : deleteQueue_)
+          queued.insert(item.slot);
+        bool covered = status == WmsStatus::Ok && !readIndices.empty();
+        for (int index : readIndices) {
+          if (!queued.count(MessageSlot{storage, index})) {
+            covered = false;
+            break;
+          }
+        }
+        if (!covered) {
+          // 这些位置已在队列中，逐条删除即可；不再重复核对该存储
+          forgetMarked();
+          endTagDelete();
+          pumpDeletes();
+          return;
+        }
+        transport_->deleteByTag(
+            client, storage, WmsMessageTag::Read,
+            [this, storage, forgetMarked,
+             readIndices = std::move(readIndices)](bool success) {
+              if (success) {
+                std::unordered_set<MessageSlot, MessageSlotHash> deleted;
+                for (int index : readIndices)
+                  deleted.insert(MessageSlot{storage, index});
+                std::deque<PendingDelete> remaining;
+                for (auto &item : deleteQueue_) {
+                  if (!deleted.count(item.slot)) {
+                    remaining.push_back(std::move(item));
+                    continue;
+                  }
+                  if (partCache_.erase(item.slot))
+                    pendingRemovals_.push_back(item.slot);
+                  markedRead_.erase(item.slot);
+                  adjustUsage(storage, 0, -1);
+                  finishDelete(std::move(item), true);
+                }
+                deleteQueue_ = std::move(remaining);
+              } else {
+                forgetMarked();
+              }
+              endTagDelete();
+              pumpDeletes();
+            });
+      });
+  return true;
+}
 
-  // 将所有短信索引添加到待处理队列
-  for (int memoryIndex : messageIndices) {
-    ctx->pendingSmsIndices.push(memoryIndex);
-  }
+void QmiSmsReader::endTagDelete() {
+  tagDeleteInFlight_ = false;
+  auto held = std::move(heldMarkReads_);
+  heldMarkReads_.clear();
+  for (auto &resume : held)
+    resume();
+}
 
-  // 开始处理第一条短信
-  processNextSms(ctx);
+// =======================
+// 标记已读
+// =======================
+void QmiSmsReader::markMessageRead(MessageSlot slot) {
+  std::unique_lock lock(markReadMutex_);
+  pendingMarkRead_.push_back(slot);
+}
 
-  // 等待所有短信读取完成
-  g_main_loop_run(ctx->loop);
+std::future<size_t>
+QmiSmsReader::markReadAsync(std::vector<MessageSlot> slots) {
+  return io_.start<size_t>([this, slots = std::move(slots)](
+                               auto promise) mutable {
+    withClientAsync([this, slots = std::move(slots), promise](
+                        WmsClient *client,
+                        std::function<void(bool)> release) mutable {
+      if (!client) {
+        promise->set_value(0);
+        return;
+      }
+      size_t total = slots.size();
+      markSlotsReadAsync(client, std::move(slots), 0,
+                         [promise, release, total](size_t marked) {
+                           // 全部失败时怀疑 client 已失效
+                           release(marked > 0 || total == 0);
+                           promise->set_value(marked);
+                         });
+    });
+  });
+}
 
-  // 处理所有短信（例如多段短信拼接）
-  processAllSMS(ctx);
+void QmiSmsReader::markSlotsReadAsync(WmsClient *client,
+                                      std::vector<MessageSlot> slots,
+                                      size_t marked,
+                                      std::function<void(size_t)> done) {
+  if (slots.empty()) {
+    done(marked);
+    return;
+  }
+  if (tagDeleteInFlight_) {
+    // 核对已读列表到按标签删除之间新标记的短信会被一并删除，等删除结束再提交
+    heldMarkReads_.push_back([this, client, slots = std::move(slots), marked,
+                              done = std::move(done)]() mutable {
+      markSlotsReadAsync(client, std::move(slots), marked, std::move(done));
+    });
+    return;
+  }
+  MessageSlot slot = slots.back();
+  slots.pop_back();
+  auto issued = RetryPolicy::Clock::now();
+  ++markReadsInFlight_;
+  transport_->markRead(
+      client, slot,
+      [this, client, slot, slots = std::move(slots), marked, issued,
+       done = std::move(done)](bool success) mutable {
+        --markReadsInFlight_;
+        if (success) {
+          recordLatency(WmsOperation::ModifyTag, issued);
+          markedRead_.insert(slot);
+          adjustUsage(slot.storage, -1, 1);
+          ++marked;
+        }
+        markSlotsReadAsync(client, std::move(slots), marked, std::move(done));
+      });
+}
 
-  // 处理需要删除的重复短信分段
-  if (!ctx->toDeleteIndices.empty()) {
-    std::cerr << "开始删除 " << ctx->toDeleteIndices.size() << " 个重复短信分段" << std::endl;
-    for (int index : ctx->toDeleteIndices) {
-      std::cerr << "删除重复短信分段，索引: " << index << std::endl;
-      deleteMessage(index);
-    }
+void QmiSmsReader::flushMarkRead() {
+  std::vector<MessageSlot> slots;
+  {
+    std::unique_lock lock(markReadMutex_);
+    slots.swap(pendingMarkRead_);
+  }
+  if (slots.empty()) {
+    return;
+  }
+  size_t total = slots.size();
+  size_t marked = markReadAsync(std::move(slots)).get();
+  if (marked < total) {
+    std::cerr << "有 " << total - marked << " 条短信标记已读失败，将保持未读"
+              << std::endl;
   }
+}
 
-  if (ctx->temporaryClient)
-    releaseWmsClientSync(ctx->client);
+// =======================
+// 处理短信
+// =======================
+bool QmiSmsReader::decodePart(SMSPart &part) {
+  if (!pdu::decodeDeliver(part.rawData, part)) {
+    return false;
+  }
+  // 分段号非法时按单条短信处理
+  if (part.totalParts <= 1 || part.partNumber < 1) {
+    part.reference = 0;
+    part.partNumber = 1;
+    part.totalParts = 1;
+  }
+  return true;
+}
 
-  std::vector<CompleteSMS> result = std::move(ctx->completeSMSList);
-  g_main_loop_unref(ctx->loop);
-  delete ctx;
-  return result;
+void QmiSmsReader::decodeAllParts(MessageSyncContext *ctx) {
+  for (auto it = ctx->rawSMSMap.begin(); it != ctx->rawSMSMap.end();) {
+    if (!decodePart(it->second)) {
+      std::cerr << "PDU解析失败，位置 " << it->first << std::endl;
+      it = ctx->rawSMSMap.erase(it);
+    } else {
+      ++it;
+    }
+  }
 }
 
-// 处理队列中的下一条短信
-void QmiSmsReader::processNextSms(MessageSyncContext *ctx) {
-  // 如果队列为空，表示所有短信已处理完毕
-  if (ctx->pendingSmsIndices.empty()) {
-    return;
+uint64_t QmiSmsReader::fingerprintPDU(const std::vector<uint8_t> &rawData) {
+  // FNV-1a 64 位
+  uint64_t hash = 14695981039346656037ULL;
+  for (uint8_t byte : rawData) {
+    hash ^= byte;
+    hash *= 1099511628211ULL;
   }
+  return hash;
+}
 
-  // 取出队列中的下一个短信索引
-  int memoryIndex = ctx->pendingSmsIndices.front();
-  ctx->pendingSmsIndices.pop();
+std::vector<MessageSlot>
+QmiSmsReader::refreshPartCache(SmsStorage storage,
+                               const std::vector<int> &messageIndices) {
+  std::unordered_set<int> listed(messageIndices.begin(),
+                                 messageIndices.end());
+  // 淘汰该存储中已从列表中消失的位置，其他存储的缓存不受影响
+  for (auto it = partCache_.begin(); it != partCache_.end();) {
+    if (it->first.storage == storage && !listed.count(it->first.index)) {
+      pendingRemovals_.push_back(it->first);
+      it = partCache_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  std::vector<MessageSlot> toRead;
+  for (int index : messageIndices) {
+    MessageSlot slot{storage, index};
+    // 正在删除的短信已经处理过，无需再读
+    if (deletingSlots_.count(slot))
+      continue;
+    auto it = partCache_.find(slot);
+    if (it == partCache_.end() || it->second.stale) {
+      toRead.push_back(slot);
+    }
+  }
+  return toRead;
+}
 
-  QmiMessageWmsRawReadInput *read_input = qmi_message_wms_raw_read_input_new();
-  g_autoptr(GError) error = nullptr;
+FetchBatch QmiSmsReader::collectFetched(MessageSyncContext *ctx) {
+  FetchBatch batch;
+  batch.removedSlots = std::move(pendingRemovals_);
+  pendingRemovals_.clear();
+  for (auto &kv : ctx->rawSMSMap) {
+    uint64_t fingerprint = fingerprintPDU(kv.second.rawData);
+    auto it = partCache_.find(kv.first);
+    if (it != partCache_.end()) {
+      if (it->second.fingerprint == fingerprint) {
+        // 内容未变化，重组表中已有该分段，无需再次解析
+        it->second.stale = false;
+        continue;
+      }
+      // 该位置上原有的分段已被替换
+      batch.removedSlots.push_back(kv.first);
+    }
+    partCache_[kv.first] = CachedPart{fingerprint, false};
+    batch.parts.push_back(std::move(kv.second));
+  }
+  ctx->rawSMSMap.clear();
+  return batch;
+}
 
-  if (!qmi_message_wms_raw_read_input_set_message_mode(
-          read_input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
-    std::cerr << "设置短信模式失败: " << error->message << std::endl;
-    qmi_message_wms_raw_read_input_unref(read_input);
-    // 处理下一条短信
-    processNextSms(ctx);
+void QmiSmsReader::streamFetched(MessageSyncContext *ctx) {
+  // 只有 I/O 线程放入，解码线程只会腾出位置，检查后放入不会失败
+  if (ctx->rawSMSMap.empty() ||
+      fetchQueue_.size() + 1 >= fetchQueue_.capacity()) {
     return;
   }
+  FetchBatch batch = collectFetched(ctx);
+  if (!batch.parts.empty() || !batch.removedSlots.empty()) {
+    fetchQueue_.tryPush(std::move(batch));
+  }
+}
 
-  if (!qmi_message_wms_raw_read_input_set_message_memory_storage_id(
-          read_input, QMI_WMS_STORAGE_TYPE_UIM, memoryIndex, &error)) {
-    std::cerr << "设置短信存储ID失败: " << error->message << std::endl;
-    qmi_message_wms_raw_read_input_unref(read_input);
-    // 处理下一条短信
-    processNextSms(ctx);
-    return;
+std::vector<CompleteSMS> QmiSmsReader::assembleBatch(FetchBatch &batch) {
+  std::vector<CompleteSMS> completed;
+  std::vector<MessageSlot> duplicates;
+  {
+    std::unique_lock lock(assemblerMutex_);
+    for (const MessageSlot &slot : batch.removedSlots) {
+      assembler_.removeSlot(slot);
+    }
+    for (auto &part : batch.parts) {
+      if (!decodePart(part)) {
+        std::cerr << "PDU解析失败，位置 " << part.slot << std::endl;
+        continue;
+      }
+      if (auto csms = assembler_.add(std::move(part))) {
+        completed.push_back(std::move(*csms));
+      }
+    }
+    // 超时的分段短信按配置丢弃或作为不完整短信投递
+    for (auto &csms : assembler_.expire()) {
+      completed.push_back(std::move(csms));
+    }
+    duplicates = assembler_.takeDuplicateSlots();
+    pendingSegments_ = assembler_.pendingSegments();
   }
+  // 重组时发现的重复分段交给 I/O 线程上的删除队列
+  if (!duplicates.empty()) {
+    io_.post([this, duplicates = std::move(duplicates)] {
+      for (const MessageSlot &slot : duplicates) {
+        std::cerr << "删除重复短信分段，位置: " << slot << std::endl;
+        enqueueDelete(slot);
+      }
+    });
+  }
+  return completed;
+}
 
-  qmi_message_wms_raw_read_input_ref(read_input);
-  auto *data = new RawReadUserData{ctx, memoryIndex, read_input};
+void QmiSmsReader::setMultipartTimeout(std::chrono::seconds timeout,
+                                       bool deliverPartial) {
+  std::unique_lock lock(assemblerMutex_);
+  assembler_.setOptions(MultipartAssembler::Options{timeout, deliverPartial});
+}
 
-  qmi_client_wms_raw_read(QMI_CLIENT_WMS(ctx->client), read_input, 10, nullptr,
-                          (GAsyncReadyCallback)rawReadReadyCallback, data);
+size_t QmiSmsReader::pendingSegmentCount() const { return pendingSegments_; }
+
+PipelineStats QmiSmsReader::pipelineStats() const {
+  PipelineStats stats;
+  stats.fetchQueueDepth = fetchQueue_.size();
+  stats.deliveryQueueDepth = deliveryQueue_.size();
+  stats.cycles = cycleCount_;
+  stats.delivered = deliveredCount_;
+  stats.fetchStalls = fetchStalls_;
+  stats.deliveryStalls = deliveryStalls_;
+  stats.cycleReads = cycleReads_;
+  stats.cycleReadsDone = cycleReadsDone_;
+  return stats;
+}
 
-  qmi_message_wms_raw_read_input_unref(read_input);
+StartupStats QmiSmsReader::startupStats() const {
+  StartupStats stats = startup_;
+  stats.backlogRead = std::chrono::steady_clock::time_point(
+      std::chrono::steady_clock::duration(backlogReadTicks_.load()));
+  stats.firstDelivered = std::chrono::steady_clock::time_point(
+      std::chrono::steady_clock::duration(firstDeliveredTicks_.load()));
+  return stats;
 }
 
-void QmiSmsReader::rawReadReadyCallback(QmiClientWms *client, GAsyncResult *res,
-                                        gpointer user_data) {
-  auto *data = static_cast<RawReadUserData *>(user_data);
-  auto *ctx = data->ctx;
-  int mem_index = data->memoryIndex;
-  // 取出 read_input 后删除 data
-  QmiMessageWmsRawReadInput *read_input = data->read_input;
-  delete data;
+void QmiSmsReader::setSeenCapacity(size_t capacity) {
+  if (listening_) {
+    return;
+  }
+  seenMessages_ = SeenSet(capacity);
+}
+
+void QmiSmsReader::processAllSMS(MessageSyncContext *ctx) {
+  // 一次性读取不跨轮次保留状态，使用临时重组表
+  MultipartAssembler assembler;
+  for (auto &kv : ctx->rawSMSMap) {
+    if (auto csms = assembler.add(kv.second)) {
+      ctx->completeSMSList.push_back(std::move(*csms));
+    }
+  }
+  if (assembler.pendingSegments() > 0) {
+    std::cerr << "有 " << assembler.pendingGroups() << " 条分段短信不完整，共 "
+              << assembler.pendingSegments() << " 个分段等待中" << std::endl;
+  }
+  // 重复分段由调用者删除
+  ctx->toDeleteSlots = assembler.takeDuplicateSlots();
+}
 
-  g_autoptr(GError) error = nullptr;
-  g_autoptr(QmiMessageWmsRawReadOutput) output =
-      qmi_client_wms_raw_read_finish(client, res, &error);
 
-  // 超时则不释放 read_input
-  if (error && strstr(error->message, "Transaction timed out")) {
-    std::cout << "读取短信超时，重试中..." << std::endl;
-    auto *retryData = new RawReadUserData{ctx, mem_index, read_input};
-    qmi_client_wms_raw_read(client, read_input, 10, nullptr,
-                            (GAsyncReadyCallback)rawReadReadyCallback,
-                            retryData);
+// =======================
+// 短信监听（异步）
+// =======================
+void QmiSmsReader::startListening(
+    std::chrono::seconds interval,
+    std::function<void(const CompleteSMS &)> callback, ListenMode mode) {
+  if (listening_) {
     return;
   }
-
-  if (!output) {
-    std::cerr << "读取短信内容（索引 " << mem_index
-              << "）失败: " << (error ? error->message : "未知错误")
-              << std::endl;
-    ctx->processedSMSCount++;
-    qmi_message_wms_raw_read_input_unref(read_input);
-  } else {
-    GArray *raw_data = nullptr;
-    QmiWmsMessageTagType msg_tag;
-    QmiWmsMessageFormat msg_format;
-    if (!qmi_message_wms_raw_read_output_get_raw_message_data(
-            output, &msg_tag, &msg_format, &raw_data, &error)) {
-      std::cerr << "获取短信原始数据（索引 " << mem_index
-                << "）失败: " << error->message << std::endl;
-      ctx->processedSMSCount++;
-    } else if (raw_data && raw_data->len > 0) {
-      std::ostringstream oss;
-      for (guint i = 0; i < raw_data->len; i++) {
-        char buf[3];
-        sprintf(buf, "%02X", ((guint8 *)raw_data->data)[i]);
-        oss << buf;
+  // 从池中取得持久 client 并按需注册新短信指示，均在 I/O 线程上完成
+  auto ready = io_.start<ListenMode>([this, mode](auto promise) {
+    clientPool_.lease([this, mode, promise](WmsClient *client) {
+      persistentClient_ = client;
+      if (!client || mode != ListenMode::Indication) {
+        promise->set_value(ListenMode::Polling);
+        return;
       }
-      SMSPart part;
-      part.memoryIndex = mem_index;
-      part.hexPDU = oss.str();
-      part.rawData.resize(raw_data->len);
-      memcpy(part.rawData.data(), raw_data->data, raw_data->len);
-      ctx->rawSMSMap[mem_index] = part;
-      ctx->processedSMSCount++;
-    } else {
-      std::cout << "短信索引 " << mem_index << " 无内容或读取为空。"
-                << std::endl;
-      ctx->processedSMSCount++;
-    }
+      transport_->registerNewMessageIndications(
+          client,
+          [this](MessageSlot slot) { onNewMessageIndication(slot); },
+          [promise](bool registered) {
+            if (!registered) {
+              std::cerr << "注册新短信指示失败，回退到定时轮询" << std::endl;
+            }
+            promise->set_value(registered ? ListenMode::Indication
+                                          : ListenMode::Polling);
+          });
+    });
+  });
+  listenMode_ = ready.get();
+  if (!io_.submit([this] { return persistentClient_ != nullptr; }).get()) {
+    throw std::runtime_error("无法取得持久化 WMS 客户端");
   }
+  listenInterval_ = interval;
+  fetchStalled_ = false;
+  listening_ = true;
+  startup_.listening = std::chrono::steady_clock::now();
+  // 启动解码与投递线程，再由 I/O 线程发起第一轮读取
+  decodeRunning_ = true;
+  deliveryRunning_ = true;
+  decodeThread_ = std::thread(&QmiSmsReader::decodeLoop, this);
+  deliveryThread_ =
+      std::thread(&QmiSmsReader::deliveryLoop, this, std::move(callback));
+  io_.post([this] {
+    requestCycle();
+    scheduleWatchdog(++watchdogGeneration_);
+    // 首次检查立即进行，启动时 SIM 可能已经接近占满
+    checkCapacity();
+    scheduleCapacityCheck(++capacityGeneration_);
+  });
+}
 
-  qmi_message_wms_raw_read_input_unref(read_input);
+void QmiSmsReader::stopListening() {
+  listening_ = false;
+  // 不再发起新的读取，并等待进行中的一轮结束；其批次仍会交给解码线程
+  io_.start<void>([this](auto promise) {
+       ++timerGeneration_;
+       ++watchdogGeneration_;
+       ++capacityGeneration_;
+       draining_ = false;
+       if (!cycleActive_) {
+         promise->set_value();
+         return;
+       }
+       cycleIdleWaiters_.push_back([promise] { promise->set_value(); });
+     }).wait();
+  // 依次停止解码与投递线程；已入队的批次和短信都处理完才退出
+  decodeRunning_ = false;
+  fetchQueue_.wake();
+  if (decodeThread_.joinable())
+    decodeThread_.join();
+  deliveryRunning_ = false;
+  deliveryQueue_.wake();
+  if (deliveryThread_.joinable())
+    deliveryThread_.join();
+  // 排队的删除结束后将持久 client 归还给池
+  io_.start<void>([this](auto promise) {
+       deleteDrainWaiters_.push_back([this, promise] {
+         if (persistentClient_) {
+           if (listenMode_ == ListenMode::Indication)
+             transport_->unregisterNewMessageIndications(persistentClient_);
+           clientPool_.giveBack(persistentClient_);
+           persistentClient_ = nullptr;
+         }
+         promise->set_value();
+       });
+       pumpDeletes();
+     }).wait();
+}
 
-  // 如果所有短信都已处理完，退出主循环
-  if (ctx->processedSMSCount >= ctx->totalSMSCount) {
-    g_main_loop_quit(ctx->loop);
-  } else {
-    // 否则处理下一条短信
-    processNextSms(ctx);
+void QmiSmsReader::onNewMessageIndication(MessageSlot slot) {
+  // 无论指示中是否携带位置，都触发一次读取；携带时将该位置标记为失效
+  if (slot.index >= 0) {
+    staleSlots_.push_back(slot);
   }
+  requestCycle();
 }
 
-void QmiSmsReader::startSyncListMessages(MessageSyncContext *ctx) {
-  // 获取短信索引列表 - 告知函数已持有锁
-  std::vector<int> messageIndices = listAllMessages(true);
+void QmiSmsReader::requestCycle() {
+  if (!listening_) {
+    return;
+  }
+  if (cycleActive_ || recovering_) {
+    cycleRequested_ = true;
+    return;
+  }
+  // 先登记再检查队列，与解码线程取走批次后的检查配对，不会漏掉恢复
+  fetchStalled_ = true;
+  if (fetchQueue_.full()) {
+    ++fetchStalls_;
+    return;
+  }
+  fetchStalled_ = false;
+  cycleRequested_ = false;
+  // 已投递的定时器作废，本轮结束后重新计时
+  ++timerGeneration_;
+  listenCycleAsync([this](FetchBatch batch) {
+    // 只有 I/O 线程放入；开始前队列有空位，逐条交出时始终保留该空位，此处
+    // 不会失败
+    fetchQueue_.tryPush(std::move(batch));
+    if (++cycleCount_ == 1) {
+      backlogReadTicks_ =
+          std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+    auto waiters = std::move(cycleIdleWaiters_);
+    cycleIdleWaiters_.clear();
+    for (auto &waiter : waiters)
+      waiter();
+    scheduleNextCycle();
+  });
+}
 
-  if (messageIndices.empty()) {
-    // 没有短信，直接退出循环
-    g_main_loop_quit(ctx->loop);
+void QmiSmsReader::scheduleNextCycle() {
+  if (!listening_) {
     return;
   }
+  // 读取期间已到达的指示无需等待
+  if (cycleRequested_) {
+    requestCycle();
+    return;
+  }
+  uint64_t generation = ++timerGeneration_;
+  std::weak_ptr<bool> guard = timerGuard_;
+  auto interval = listenInterval_;
+  if (draining_)
+    interval = std::min(interval, capacityOptions_.drainPollInterval);
+  io_.postAfter(interval, [this, guard, generation] {
+    if (guard.expired() || generation != timerGeneration_) {
+      return;
+    }
+    requestCycle();
+  });
+}
 
-  // 设置总数量，用于跟踪处理进度
-  ctx->totalSMSCount = messageIndices.size();
+void QmiSmsReader::listenCycleAsync(std::function<void(FetchBatch)> done) {
+  WmsClient *client = persistentClient_;
+  if (!client) {
+    done({});
+    return;
+  }
+  // 本轮读取期间暂停提交排队的删除，结束后恢复
+  cycleActive_ = true;
+  cycleStarted_ = RetryPolicy::Clock::now();
+  uint64_t generation = ++cycleGeneration_;
+  auto finish = [this, done = std::move(done)](FetchBatch batch) {
+    cycleActive_ = false;
+    pumpDeletes();
+    done(std::move(batch));
+  };
+  // 同时列出各存储，原始读取合并到同一个在途窗口
+  listStoragesAsync(client, WmsMessageTag::Unread,
+                    [this, client, finish,
+                     generation](std::vector<StorageListing> listings) {
+    // 设备重新打开时本轮已被放弃
+    if (generation != cycleGeneration_) {
+      return;
+    }
+    // 新短信指示中点名的位置可能已被设备复用，需要重新读取
+    for (const MessageSlot &slot : staleSlots_) {
+      auto it = partCache_.find(slot);
+      if (it != partCache_.end())
+        it->second.stale = true;
+    }
+    staleSlots_.clear();
+    bool listed = false;
+    std::vector<MessageSlot> toRead;
+    for (const auto &listing : listings) {
+      // 列表失败的存储保留缓存，本轮不读取
+      if (!listing.listed)
+        continue;
+      listed = true;
+      unreadCount_[static_cast<size_t>(listing.storage)] =
+          listing.indices.size();
+      auto slots = refreshPartCache(listing.storage, listing.indices);
+      toRead.insert(toRead.end(), slots.begin(), slots.end());
+    }
+    // 积压增长时不必等到下一次容量检查
+    updateDrainMode();
+    if (!listed) {
+      // 空批次仍用于处理重组超时
+      finish({});
+      return;
+    }
+    auto *ctx = new MessageSyncContext;
+    ctx->client = client;
+    ctx->clientEpoch = clientEpoch_;
+    ctx->streaming = true;
+    ctx->cycle = generation;
+    cycleCtx_ = ctx;
+    ctx->drained = [this, ctx, finish] {
+      cycleCtx_ = nullptr;
+      // 解码与重组交给解码线程，I/O 线程只比较指纹
+      FetchBatch batch = collectFetched(ctx);
+      delete ctx;
+      finish(std::move(batch));
+    };
+    // 只读取新增或失效的位置；即使没有需要读取的位置也要产出批次，
+    // 以便解码线程处理重组超时
+    cycleReads_ = toRead.size();
+    cycleReadsDone_ = 0;
+    readSlotsAsync(ctx, toRead);
+  });
+}
 
-  // 将所有短信索引添加到待处理队列
-  for (int memoryIndex : messageIndices) {
-    ctx->pendingSmsIndices.push(memoryIndex);
+void QmiSmsReader::decodeLoop() {
+  FetchBatch batch;
+  while (fetchQueue_.waitPop(batch, decodeRunning_)) {
+    // 腾出了位置，恢复被推迟的读取
+    if (fetchStalled_.exchange(false)) {
+      io_.post([this] { requestCycle(); });
+    }
+    for (auto &sms : assembleBatch(batch)) {
+      // 按内容指纹过滤已投递过的短信；存储索引会在删除后被设备复用，不能作为键
+      if (!seenMessages_.insert(SeenSet::fingerprint(sms))) {
+        continue;
+      }
+      sms.deviceId = deviceId_;
+      if (deliveryQueue_.full()) {
+        ++deliveryStalls_;
+      }
+      // 投递线程在本线程退出后才停止，等待期间不会丢弃短信
+      deliveryQueue_.waitPush(std::move(sms), deliveryRunning_);
+    }
   }
+}
 
-  // 开始处理第一条短信
-  processNextSms(ctx);
+void QmiSmsReader::deliveryLoop(
+    std::function<void(const CompleteSMS &)> callback) {
+  CompleteSMS sms;
+  while (deliveryQueue_.waitPop(sms, deliveryRunning_)) {
+    callback(sms);
+    if (++deliveredCount_ == 1) {
+      firstDeliveredTicks_ =
+          std::chrono::steady_clock::now().time_since_epoch().count();
+    }
+    // 已到达的短信全部回调后，一并提交其中标记为已读的短信
+    if (deliveryQueue_.empty()) {
+      if (onDeliveryIdle_)
+        onDeliveryIdle_();
+      flushMarkRead();
+    }
+  }
+  if (onDeliveryIdle_)
+    onDeliveryIdle_();
+  flushMarkRead();
 }
 
 // =======================
-// 短信删除（同步）
+// 存储容量
 // =======================
-bool QmiSmsReader::deleteMessage(int memoryIndex) {
-  std::unique_lock lock(seenMutex_);
-  if (!performMessageDelete(memoryIndex)) {
-    return false;
+CapacityStats QmiSmsReader::capacityStats() const {
+  CapacityStats stats;
+  for (size_t s = 0; s < kSmsStorageCount; ++s) {
+    StorageUsage usage;
+    usage.storage = static_cast<SmsStorage>(s);
+    usage.capacity = storageCapacity_[s];
+    usage.unread = unreadCount_[s];
+    usage.read = readCount_[s];
+    stats.storages.push_back(usage);
   }
-  return seenMessages_.erase(memoryIndex);
+  stats.draining = draining_;
+  stats.drainEntries = drainEntries_;
+  return stats;
 }
 
-bool QmiSmsReader::performMessageDelete(int memoryIndex) {
-  std::unique_lock opLock(clientOperationMutex_);
-  auto *ctx = new DeleteSMSContext;
-  ctx->loop = g_main_loop_new(nullptr, FALSE);
-  ctx->device = device_;
-  {
-    std::unique_lock lock(persistentClientMutex_);
-    if (persistentClient_) {
-      ctx->client = persistentClient_;
-      ctx->temporaryClient = false;
-    }
-  }
-  if (ctx->client == nullptr) {
-    ctx->client = createWmsClientSync();
-    ctx->temporaryClient = true;
-    if (!ctx->client) {
-      std::cerr << "无法分配临时 WMS 客户端" << std::endl;
-      g_main_loop_quit(ctx->loop);
-      delete ctx;
-      return false;
-    }
-  }
-  QmiMessageWmsDeleteInput *input = qmi_message_wms_delete_input_new();
-  g_autoptr(GError) error = nullptr;
-  if (!qmi_message_wms_delete_input_set_memory_storage(
-          input, QMI_WMS_STORAGE_TYPE_UIM, &error)) {
-    std::cerr << "设置删除短信存储位置失败: " << error->message << std::endl;
-    qmi_message_wms_delete_input_unref(input);
-    if (ctx->temporaryClient)
-      releaseWmsClientSync(ctx->client);
-    g_main_loop_quit(ctx->loop);
-    delete ctx;
-    return false;
+void QmiSmsReader::scheduleCapacityCheck(uint64_t generation) {
+  std::weak_ptr<bool> guard = timerGuard_;
+  io_.postAfter(capacityOptions_.checkInterval, [this, guard, generation] {
+    if (guard.expired() || generation != capacityGeneration_ ||
+        !listening_) {
+      return;
+    }
+    checkCapacity();
+    scheduleCapacityCheck(generation);
+  });
+}
+
+void QmiSmsReader::checkCapacity() {
+  WmsClient *client = persistentClient_;
+  if (!client || recovering_) {
+    return;
   }
-  if (!qmi_message_wms_delete_input_set_memory_index(input, memoryIndex,
-                                                     &error)) {
-    std::cerr << "设置删除短信 index 失败: " << error->message << std::endl;
-    qmi_message_wms_delete_input_unref(input);
-    if (ctx->temporaryClient)
-      releaseWmsClientSync(ctx->client);
-    g_main_loop_quit(ctx->loop);
-    delete ctx;
-    return false;
+  // 只是观测，失败时不重试也不计入看门狗，下次检查再查
+  for (SmsStorage storage : storages_) {
+    size_t s = static_cast<size_t>(storage);
+    // 容量不会变化，查询成功一次即可
+    if (storageCapacity_[s] == 0) {
+      transport_->getStoreMaxSize(
+          client, storage, [this, s](WmsStatus status, uint32_t maxSize) {
+            if (status != WmsStatus::Ok) {
+              return;
+            }
+            storageCapacity_[s] = maxSize;
+            updateDrainMode();
+          });
+    }
+    // 未读短信数随每轮读取更新，这里只补上已读短信
+    transport_->listMessages(
+        client, storage, WmsMessageTag::Read,
+        [this, s](WmsStatus status, std::vector<int> indices) {
+          if (status != WmsStatus::Ok) {
+            return;
+          }
+          readCount_[s] = indices.size();
+          updateDrainMode();
+          if (draining_) {
+            deleteMarkedRead();
+          }
+        });
   }
-  if (!qmi_message_wms_delete_input_set_message_mode(
-          input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
-    std::cerr << "设置删除短信模式失败: " << error->message << std::endl;
-    qmi_message_wms_delete_input_unref(input);
-    if (ctx->temporaryClient)
-      releaseWmsClientSync(ctx->client);
-    g_main_loop_quit(ctx->loop);
-    delete ctx;
-    return false;
+}
+
+void QmiSmsReader::updateDrainMode() {
+  // 以占用比例最高的存储为准，容量未知的存储不参与
+  double ratio = 0;
+  SmsStorage fullest = SmsStorage::Uim;
+  for (SmsStorage storage : storages_) {
+    size_t s = static_cast<size_t>(storage);
+    uint32_t capacity = storageCapacity_[s];
+    if (capacity == 0) {
+      continue;
+    }
+    double used =
+        static_cast<double>(unreadCount_[s] + readCount_[s]) / capacity;
+    if (used > ratio) {
+      ratio = used;
+      fullest = storage;
+    }
+  }
+  if (!draining_ && ratio >= capacityOptions_.highWater) {
+    draining_ = true;
+    ++drainEntries_;
+    std::cerr << smsStorageName(fullest) << " 存储已占用 "
+              << static_cast<int>(ratio * 100) << "%，进入清空模式"
+              << std::endl;
+    deleteMarkedRead();
+    // 已排队的删除不再等待本轮读取结束
+    pumpDeletes();
+    // 按清空模式的周期重新计时；读取进行中时本轮结束后生效
+    if (listening_ && !cycleActive_ && !recovering_) {
+      scheduleNextCycle();
+    }
+  } else if (draining_ && ratio < capacityOptions_.lowWater) {
+    draining_ = false;
+    std::cerr << "存储占用回落到 " << static_cast<int>(ratio * 100)
+              << "%，退出清空模式" << std::endl;
   }
-  qmi_client_wms_delete(QMI_CLIENT_WMS(ctx->client), input, 10, nullptr,
-                        (GAsyncReadyCallback)deleteMessageReadyCallback, ctx);
-  qmi_message_wms_delete_input_unref(input);
-  g_main_loop_run(ctx->loop);
-  if (ctx->temporaryClient)
-    releaseWmsClientSync(ctx->client);
-  bool success = ctx->promise.get_future().get();
-  delete ctx;
-  return success;
 }
 
-// =======================
-// 异步回调函数
-// =======================
-void QmiSmsReader::listMessagesReadyCallback(QmiClientWms *client,
-                                             GAsyncResult *res,
-                                             gpointer user_data) {
-  auto *ctx = static_cast<MessageSyncContext *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  g_autoptr(QmiMessageWmsListMessagesOutput) output =
-      qmi_client_wms_list_messages_finish(client, res, &error);
-  if (!output ||
-      !qmi_message_wms_list_messages_output_get_result(output, &error)) {
-    std::cerr << "列出短信列表失败: " << error->message << std::endl;
-    if (ctx->temporaryClient)
-      releaseClient(QMI_CLIENT(client), ctx);
-    g_main_loop_quit(ctx->loop);
+void QmiSmsReader::adjustUsage(SmsStorage storage, int unread, int read) {
+  size_t s = static_cast<size_t>(storage);
+  auto apply = [](std::atomic<size_t> &count, int delta) {
+    long value = static_cast<long>(count.load()) + delta;
+    count = value > 0 ? static_cast<size_t>(value) : 0;
+  };
+  apply(unreadCount_[s], unread);
+  apply(readCount_[s], read);
+}
+
+void QmiSmsReader::deleteMarkedRead() {
+  if (!listening_) {
     return;
   }
-  GArray *message_list = nullptr;
-  qmi_message_wms_list_messages_output_get_message_list(output, &message_list,
-                                                        nullptr);
-  if (message_list) {
-    ctx->totalSMSCount = message_list->len;
-    for (guint i = 0; i < message_list->len; i++) {
-      auto *msg = &g_array_index(
-          message_list, QmiMessageWmsListMessagesOutputMessageListElement, i);
-      QmiMessageWmsRawReadInput *read_input =
-          qmi_message_wms_raw_read_input_new();
-      if (!qmi_message_wms_raw_read_input_set_message_mode(
-              read_input, QMI_WMS_MESSAGE_MODE_GSM_WCDMA, &error)) {
-        std::cerr << "设置短信模式失败: " << error->message << std::endl;
-        qmi_message_wms_raw_read_input_unref(read_input);
-        continue;
-      }
-      if (!qmi_message_wms_raw_read_input_set_message_memory_storage_id(
-              read_input, QMI_WMS_STORAGE_TYPE_UIM, msg->memory_index,
-              &error)) {
-        std::cerr << "设置短信存储ID失败: " << error->message << std::endl;
-        qmi_message_wms_raw_read_input_unref(read_input);
-        continue;
-      }
-      qmi_message_wms_raw_read_input_ref(read_input);
-      auto *data = new RawReadUserData{ctx, static_cast<int>(msg->memory_index),
-                                       read_input};
-      qmi_client_wms_raw_read(QMI_CLIENT_WMS(ctx->client), read_input, 10,
-                              nullptr,
-                              (GAsyncReadyCallback)rawReadReadyCallback, data);
-      qmi_message_wms_raw_read_input_unref(read_input);
-    }
-    while (ctx->processedSMSCount < ctx->totalSMSCount) {
-      g_main_context_iteration(nullptr, TRUE);
-    }
-    // 处理所有短信（例如多段短信拼接）
-    processAllSMS(ctx);
-    if (ctx->temporaryClient)
-      releaseClient(QMI_CLIENT(client), ctx);
-    g_main_loop_quit(ctx->loop);
-  } else {
-    std::cout << "未找到短信。" << std::endl;
-    if (ctx->temporaryClient)
-      releaseClient(QMI_CLIENT(client), ctx);
-    g_main_loop_quit(ctx->loop);
-  }
-}
-
-void QmiSmsReader::deleteMessageReadyCallback(QmiClientWms *client,
-                                              GAsyncResult *res,
-                                              gpointer user_data) {
-  auto *ctx = static_cast<DeleteSMSContext *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  if (!qmi_client_wms_delete_finish(client, res, &error)) {
-    std::cerr << "删除短信失败: " << error->message << std::endl;
-    ctx->promise.set_value(false);
-  } else {
-    ctx->promise.set_value(true);
-  }
-  g_main_loop_quit(ctx->loop);
-}
-
-void QmiSmsReader::releaseClient(QmiClient *client, gpointer user_data) {
-  auto *ctx = static_cast<MessageSyncContext *>(user_data);
-  qmi_device_release_client(
-      ctx->device, client, QMI_DEVICE_RELEASE_CLIENT_FLAGS_RELEASE_CID, 10,
-      nullptr, (GAsyncReadyCallback)releaseClientReadyCallback, ctx);
-}
-
-void QmiSmsReader::releaseClientReadyCallback(QmiDevice *device,
-                                              GAsyncResult *res,
-                                              gpointer user_data) {
-  auto *ctx = static_cast<MessageSyncContext *>(user_data);
-  g_autoptr(GError) error = nullptr;
-  if (!qmi_device_release_client_finish(device, res, &error)) {
-    std::cerr << "释放 WMS client 失败: " << error->message << std::endl;
-  }
-  // 此处不调用 g_main_loop_quit(ctx->loop)，由上层逻辑统一 quit
+  for (const MessageSlot &slot : markedRead_) {
+    if (!deletingSlots_.count(slot)) {
+      enqueueDelete(slot);
+    }
+  }
 }
 
 // =======================
-// 处理短信
+// 短信发送
 // =======================
-void QmiSmsReader::processAllSMS(MessageSyncContext *ctx) {
-  std::vector<CompleteSMS> completeSMSList;
-  // 用于分段短信拼接的 map，key 为分段短信的参考号+发送者的组合
-  std::unordered_map<std::string, std::vector<SMSPart>> multipartGroups;
-
-  // 遍历所有读取到的短信原始数据
-  for (const auto &kv : ctx->rawSMSMap) {
-    int mem_index = kv.first;
-    const SMSPart &rawPart = kv.second;
-    // 使用 PDUlib 封装的 PDU 类进行解析
-    PDU pdu(200);
-    if (!pdu.decodePDU(rawPart.hexPDU.c_str())) {
-      std::cerr << "PDU解析失败，索引 " << mem_index << std::endl;
-      continue;
+void QmiSmsReader::sendMessage(const std::string &recipient,
+                               const std::string &text,
+                               std::function<void(SendResult)> done) {
+  auto send = std::make_shared<PendingSend>();
+  send->enqueued = std::chrono::steady_clock::now();
+  send->done = std::move(done);
+  // 编码不涉及设备，在调用线程上完成，不占用 I/O 线程
+  send->pdus = pdu::encodeSubmit(recipient, text, nextConcatReference_++);
+  send->result.parts = send->pdus.size();
+  send->result.messageIds.assign(send->pdus.size(), 0);
+  io_.post([this, send] {
+    if (send->pdus.empty()) {
+      send->failed = true;
+      send->result.error = "invalid";
+    } else if (sendClosed_) {
+      send->failed = true;
+      send->result.error = "stopped";
+    } else if (sendQueue_.size() >= sendOptions_.maxQueued) {
+      send->failed = true;
+      send->result.error = "queue_full";
     }
-    const char *text = pdu.getText();
-    const char *sender = pdu.getSender();
-    const char *timestamp = pdu.getTimeStamp();
-    const int *concatInfo = pdu.getConcatInfo();
-    // 如果存在分段信息（当前分段号大于0且总分段数大于1）
-    if (concatInfo && concatInfo[1] > 0 && concatInfo[2] > 1) {
-      int ref = concatInfo[0];
-      SMSPart part;
-      part.memoryIndex = mem_index;
-      part.partNumber = concatInfo[1];
-      part.text = text;
-      part.sender = sender;
-      part.timestamp = timestamp;
-      part.hexPDU = rawPart.hexPDU;
-      part.rawData = rawPart.rawData;
-      
-      // 创建唯一标识符：参考号+发送者
-      std::string uniqueKey = std::to_string(ref) + "_" + sender;
-      multipartGroups[uniqueKey].push_back(part);
-    } else {
-      // 单条短信
-      SMSPart part;
-      part.memoryIndex = mem_index;
-      part.partNumber = 1;
-      // 对于单条短信，使用 pdu.getText()（原代码中单条短信直接采用 getText()
-      // 的结果）
-      part.text = pdu.getText();
-      part.sender = sender;
-      part.timestamp = timestamp;
-      part.hexPDU = rawPart.hexPDU;
-      part.rawData = rawPart.rawData;
-      CompleteSMS csms;
-      csms.sender = sender;
-      csms.timestamp = timestamp;
-      csms.fullText = part.text;
-      csms.parts.push_back(part);
-      completeSMSList.push_back(csms);
-    }
-  }
-  // 对所有分段短信进行拼接：同一唯一标识符下的各分段先按 partNumber
-  // 升序排序，然后依次拼接文本
-  for (auto &groupEntry : multipartGroups) {
-    const std::string &uniqueKey = groupEntry.first;
-    auto &parts = groupEntry.second;
-    
-    // 从唯一标识符中提取参考号用于日志输出
-    int ref = 0;
-    size_t pos = uniqueKey.find("_");
-    if (pos != std::string::npos) {
-      ref = std::stoi(uniqueKey.substr(0, pos));
-    }
-
-    // 检查是否收到了所有分段
-    if (parts.empty()) {
-      continue;
+    if (send->failed) {
+      finishSend(*send);
+      return;
     }
+    sendQueue_.push_back(send);
+    ++sendQueued_;
+    pumpSends();
+  });
+}
 
-    // 排序所有分段
-    std::sort(parts.begin(), parts.end(),
-              [](const SMSPart &a, const SMSPart &b) {
-                return a.partNumber < b.partNumber;
-              });
+std::future<SendResult>
+QmiSmsReader::sendMessageAsync(const std::string &recipient,
+                               const std::string &text) {
+  auto promise = std::make_shared<std::promise<SendResult>>();
+  auto future = promise->get_future();
+  sendMessage(recipient, text, [promise](SendResult result) {
+    promise->set_value(std::move(result));
+  });
+  return future;
+}
 
-    // 获取总分段数（从第一个分段的concatInfo中获取）
-    PDU pdu;
-    if (!pdu.decodePDU(parts.front().hexPDU.c_str())) {
-      std::cerr << "PDU解析失败，无法获取总分段数，参考号: " << ref
-                << std::endl;
-      continue;
+SendResult QmiSmsReader::sendMessage(const std::string &recipient,
+                                     const std::string &text) {
+  return sendMessageAsync(recipient, text).get();
+}
+
+void QmiSmsReader::setSendOptions(const SendOptions &options) {
+  io_.submit([this, options] {
+       sendOptions_ = options;
+       sendOptions_.burst = std::max(sendOptions_.burst, 1);
+       sendOptions_.maxInFlight = std::max(sendOptions_.maxInFlight, 1);
+       sendTokens_ = std::min(sendTokens_, double(sendOptions_.burst));
+       pumpSends();
+     }).wait();
+}
+
+SendStats QmiSmsReader::sendStats() const {
+  SendStats stats;
+  stats.queued = sendQueued_;
+  stats.sent = sendSucceeded_;
+  stats.failed = sendFailed_;
+  stats.partsSent = partsSent_;
+  return stats;
+}
+
+void QmiSmsReader::pumpSends() {
+  if (recovering_ || leasingSendClient_) {
+    return;
+  }
+  // 前面的分段失败后，同一短信剩余的分段不再提交
+  while (!sendQueue_.empty() && sendQueue_.front()->failed)
+    sendQueue_.pop_front();
+  if (sendQueue_.empty()) {
+    if (sendsInFlight_ > 0) {
+      return;
     }
-    const int *concatInfo = pdu.getConcatInfo();
-    if (!concatInfo || concatInfo[2] <= 0) {
-      std::cerr << "无法获取总分段数，参考号: " << ref << std::endl;
-      continue;
+    if (sendClient_) {
+      clientPool_.giveBack(sendClient_);
+      sendClient_ = nullptr;
     }
+    auto waiters = std::move(sendIdleWaiters_);
+    sendIdleWaiters_.clear();
+    for (auto &waiter : waiters)
+      waiter();
+    return;
+  }
 
-    int totalParts = concatInfo[2];
+  // 与删除队列一样，监听中复用持久 client，否则从池中借用一个
+  WmsClient *client = persistentClient_ ? persistentClient_ : sendClient_;
+  if (!client) {
+    leasingSendClient_ = true;
+    clientPool_.lease([this](WmsClient *leased) {
+      leasingSendClient_ = false;
+      if (!leased) {
+        std::cerr << "无法取得 WMS 客户端，放弃 " << sendQueue_.size()
+                  << " 条排队的短信" << std::endl;
+        failQueuedSends("no_client");
+      }
+      sendClient_ = leased;
+      pumpSends();
+    });
+    return;
+  }
 
-    // 检查是否收到了所有分段
-    bool hasAllParts = (parts.size() >= totalParts);
+  auto now = RetryPolicy::Clock::now();
+  double rate = sendOptions_.partsPerSecond;
+  if (rate > 0) {
+    std::chrono::duration<double> elapsed = now - sendRefilled_;
+    sendTokens_ = std::min(double(sendOptions_.burst),
+                           sendTokens_ + elapsed.count() * rate);
+  }
+  sendRefilled_ = now;
+
+  while (sendsInFlight_ < sendOptions_.maxInFlight && !sendQueue_.empty()) {
+    if (rate > 0 && sendTokens_ < 1) {
+      // 令牌不足，在补足一个令牌时再继续；同一时刻只保留一个定时器
+      if (!sendTimerPosted_) {
+        sendTimerPosted_ = true;
+        auto wait = std::chrono::duration<double>((1 - sendTokens_) / rate);
+        std::weak_ptr<bool> guard = timerGuard_;
+        io_.postAfter(
+            std::chrono::duration_cast<std::chrono::microseconds>(wait) +
+                std::chrono::microseconds(1),
+            [this, guard] {
+              if (guard.expired()) {
+                return;
+              }
+              sendTimerPosted_ = false;
+              pumpSends();
+            });
+      }
+      return;
+    }
+    std::shared_ptr<PendingSend> send = sendQueue_.front();
+    size_t part = send->submitted++;
+    if (send->submitted == send->pdus.size())
+      sendQueue_.pop_front();
+    if (part == 0) {
+      send->firstSubmitted = std::chrono::steady_clock::now();
+      send->result.queueTime =
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              send->firstSubmitted - send->enqueued);
+    }
+    if (rate > 0)
+      sendTokens_ -= 1;
+    ++sendsInFlight_;
+    issueRawSend(client, std::move(send), part);
+    while (!sendQueue_.empty() && sendQueue_.front()->failed)
+      sendQueue_.pop_front();
+  }
+}
 
-    // 检查分段序号是否连续
-    if (hasAllParts) {
-      // 检查是否有所有预期的分段（从1到totalParts）
-      for (int i = 1; i <= totalParts; i++) {
-        bool found = false;
-        for (const auto &p : parts) {
-          if (p.partNumber == i) {
-            found = true;
-            break;
+void QmiSmsReader::issueRawSend(WmsClient *client,
+                                std::shared_ptr<PendingSend> send,
+                                size_t part) {
+  auto issued = RetryPolicy::Clock::now();
+  transport_->rawSend(
+      client, send->pdus[part],
+      [this, send, part, issued](WmsStatus status, uint16_t messageId) {
+        --sendsInFlight_;
+        ++send->finished;
+        if (status == WmsStatus::Ok) {
+          recordLatency(WmsOperation::RawSend, issued);
+          send->result.messageIds[part] = messageId;
+          ++send->result.partsSent;
+          ++partsSent_;
+        } else {
+          if (status == WmsStatus::Timeout) {
+            retryPolicy_.recordTimeout(WmsOperation::RawSend);
+            noteFailure();
           }
-        }
-        if (!found) {
-          hasAllParts = false;
-          std::cerr << "分段短信不完整，缺少分段 " << i << "，参考号: " << ref
-                    << std::endl;
-          break;
-        }
-      }
-    } else {
-      std::cerr << "分段短信不完整，预期 " << totalParts << " 个分段，实际收到 "
-                << parts.size() << " 个，参考号: " << ref 
-                << "，发送者: " << parts.front().sender << std::endl;
-    }
-
-    // 去重处理：如果收到的分段数超过预期且所有预期分段都存在
-    if (hasAllParts && parts.size() > totalParts) {
-      std::cerr << "检测到重复短信分段，参考号: " << ref 
-                << "，发送者: " << parts.front().sender
-                << "，预期分段数: " << totalParts
-                << "，实际收到: " << parts.size() << std::endl;
-      
-      // 按分段号分组，每个分段号可能有多个相同的分段
-      std::unordered_map<int, std::vector<SMSPart>> partsByNumber;
-      for (const auto &p : parts) {
-        partsByNumber[p.partNumber].push_back(p);
-      }
-      
-      // 创建新的parts列表，只保留每个分段号中最完整且最早的分段
-      std::vector<SMSPart> uniqueParts;
-      std::vector<int> toDeleteIndices;
-      
-      for (int i = 1; i <= totalParts; i++) {
-        auto &duplicates = partsByNumber[i];
-        if (duplicates.size() > 1) {
-          // 按文本长度降序排序，相同长度则按时间戳升序排序
-          std::sort(duplicates.begin(), duplicates.end(), 
-                    [](const SMSPart &a, const SMSPart &b) {
-                      if (a.text.length() != b.text.length()) {
-                        return a.text.length() > b.text.length(); // 保留内容最长的
-                      }
-                      return a.timestamp < b.timestamp; // 内容长度相同时保留最早的
-                    });
-          
-          // 保留第一个（最完整且最早的）
-          uniqueParts.push_back(duplicates[0]);
-          
-          // 将其余的标记为待删除
-          for (size_t j = 1; j < duplicates.size(); j++) {
-            toDeleteIndices.push_back(duplicates[j].memoryIndex);
+          if (!send->failed) {
+            send->failed = true;
+            send->result.error =
+                status == WmsStatus::Timeout ? "timeout" : "rejected";
           }
-        } else if (duplicates.size() == 1) {
-          uniqueParts.push_back(duplicates[0]);
         }
-      }
-      
-      // 删除多余的分段
-      // 由于这是静态方法，我们不能直接调用deleteMessage
-      // 将待删除的索引添加到上下文中，让调用者处理删除操作
-      ctx->toDeleteIndices = toDeleteIndices;
-      
-      // 更新parts列表为去重后的列表
-      parts = uniqueParts;
-    }
-
-    // 只有当所有分段都收到时才组装完整短信
-    if (hasAllParts) {
-      CompleteSMS csms;
-      csms.sender = parts.front().sender;
-      csms.timestamp = parts.front().timestamp;
-      for (const auto &p : parts) {
-        csms.fullText += p.text;
-        csms.parts.push_back(p);
-      }
-      completeSMSList.push_back(csms);
+        if (send->finished == send->submitted &&
+            (send->failed || send->submitted == send->pdus.size())) {
+          --sendQueued_;
+          finishSend(*send);
+        }
+        pumpSends();
+      });
+}
+
+void QmiSmsReader::finishSend(PendingSend &send) {
+  send.result.success = !send.failed;
+  if (send.submitted > 0) {
+    send.result.submitTime =
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - send.firstSubmitted);
+  }
+  if (send.failed)
+    ++sendFailed_;
+  else
+    ++sendSucceeded_;
+  if (send.done)
+    send.done(std::move(send.result));
+}
+
+void QmiSmsReader::failQueuedSends(const char *error) {
+  auto queue = std::move(sendQueue_);
+  sendQueue_.clear();
+  for (auto &send : queue) {
+    if (send->failed)
+      continue;
+    send->failed = true;
+    send->result.error = error;
+    // 已有分段在途的短信在最后一个分段结束时回报
+    if (send->finished == send->submitted) {
+      --sendQueued_;
+      finishSend(*send);
     }
   }
-  ctx->completeSMSList = std::move(completeSMSList);
-  g_main_loop_quit(ctx->loop);
 }
 
 // =======================
-// 短信监听（异步）
+// 看门狗
 // =======================
-void QmiSmsReader::startListening(
-    std::chrono::seconds interval,
-    std::function<void(const CompleteSMS &)> callback) {
-  std::unique_lock lock(persistentClientMutex_);
-  if (/* 正在监听 */ persistentClient_ != nullptr && interval.count() <= 0) {
-    return;
-  }
-  // 标记为正在监听
-  // 创建持久 client（同步方式）
-  persistentClient_ = createWmsClientSync();
-  if (!persistentClient_) {
-    throw std::runtime_error("无法分配持久化 WMS 客户端");
-  }
-  listening_ = true;
-  // 启动监听线程
-  listenerThread_ =
-      std::thread(&QmiSmsReader::pollingLoop, this, interval, callback);
+WatchdogStats QmiSmsReader::watchdogStats() const {
+  WatchdogStats stats;
+  stats.recoveries = recoveries_;
+  stats.failedRecoveries = failedRecoveries_;
+  stats.lastRecoveryTime = std::chrono::microseconds(lastRecoveryUs_);
+  return stats;
 }
 
-void QmiSmsReader::stopListening() {
-  // 停止轮询线程
-  listening_ = false;
-  if (listenerThread_.joinable())
-    listenerThread_.join();
-  // 释放持久 client
-  std::unique_lock lock(persistentClientMutex_);
-  if (persistentClient_) {
-    releaseWmsClientSync(persistentClient_);
-    persistentClient_ = nullptr;
+void QmiSmsReader::noteFailure() {
+  if (++consecutiveFailures_ >= watchdogOptions_.maxConsecutiveFailures) {
+    recoverDevice("WMS 调用连续失败");
   }
 }
 
-void QmiSmsReader::pollingLoop(
-    std::chrono::seconds interval,
-    std::function<void(const CompleteSMS &)> callback) {
-  while (listening_) {
-    std::vector<CompleteSMS> newMessages;
-    {
-      std::unique_lock opLock(clientOperationMutex_);
-      MessageSyncContext ctx;
-      ctx.loop = g_main_loop_new(nullptr, FALSE);
-      ctx.device = device_;
-      {
-        std::unique_lock lock(persistentClientMutex_);
-        ctx.client = persistentClient_;
-        ctx.temporaryClient = false;
-      }
-
-      // 启动短信读取过程
-      startSyncListMessages(&ctx);
-
-      // 等待所有短信读取完成
-      while (ctx.processedSMSCount < ctx.totalSMSCount) {
-        g_main_context_iteration(nullptr, TRUE);
-      }
-
-      // 处理所有短信（例如多段短信拼接）
-      processAllSMS(&ctx);
+void QmiSmsReader::scheduleWatchdog(uint64_t generation) {
+  std::weak_ptr<bool> guard = timerGuard_;
+  io_.postAfter(watchdogOptions_.checkInterval, [this, guard, generation] {
+    if (guard.expired() || generation != watchdogGeneration_ || !listening_) {
+      return;
+    }
+    if (!persistentClient_) {
+      recoverDevice("没有可用的 WMS 客户端");
+    } else if (cycleActive_ && RetryPolicy::Clock::now() - cycleStarted_ >
+                                   watchdogOptions_.stuckCycle) {
+      recoverDevice("本轮读取长时间未结束");
+    }
+    scheduleWatchdog(generation);
+  });
+}
 
-      // 查找新短信并存储到临时列表（在持有锁的情况下）
-      for (const auto &sms : ctx.completeSMSList) {
-        std::unique_lock lock(seenMutex_);
-        if (seenMessages_.find(sms.parts.front().memoryIndex) ==
-            seenMessages_.end()) {
-          seenMessages_.insert(sms.parts.front().memoryIndex);
-          newMessages.push_back(sms); // 存储到临时列表
+void QmiSmsReader::recoverDevice(const char *reason) {
+  if (recovering_ || !listening_) {
+    return;
+  }
+  recovering_ = true;
+  auto started = RetryPolicy::Clock::now();
+  std::cerr << "设备 " << devicePath_ << " 无响应（" << reason
+            << "），重新打开设备" << std::endl;
+  // 推迟到当前事件处理完，不在传输层的回调中关闭设备
+  io_.post([this, started] {
+    if (persistentClient_ && listenMode_ == ListenMode::Indication)
+      transport_->unregisterNewMessageIndications(persistentClient_);
+    persistentClient_ = nullptr;
+    deleteClient_ = nullptr;
+    sendClient_ = nullptr;
+    abandonCycle();
+    // 关闭设备使全部 client 失效，未完成的调用以失败结束
+    ++clientEpoch_;
+    clientPool_.discard();
+    transport_->close([this, started] {
+      transport_->open(devicePath_, [this, started](bool opened) {
+        if (!opened) {
+          finishRecovery(false, started);
+          return;
         }
-      }
-      g_main_loop_unref(ctx.loop);
-    } // 在这里释放 clientOperationMutex_
+        // 与构造时一样预热一个 client，并交给等待中的操作
+        clientPool_.warm(1, [this, started](size_t) {
+          clientPool_.lease([this, started](WmsClient *client) {
+            if (!client) {
+              finishRecovery(false, started);
+              return;
+            }
+            persistentClient_ = client;
+            if (listenMode_ != ListenMode::Indication) {
+              finishRecovery(true, started);
+              return;
+            }
+            transport_->registerNewMessageIndications(
+                client,
+                [this](MessageSlot slot) { onNewMessageIndication(slot); },
+                [this, started](bool registered) {
+                  if (!registered) {
+                    std::cerr << "重新注册新短信指示失败，依靠兜底轮询"
+                              << std::endl;
+                  }
+                  finishRecovery(true, started);
+                });
+          });
+        });
+      });
+    });
+  });
+}
 
-    // 在释放锁之后处理新消息
-    for (const auto &sms : newMessages) {
-      callback(sms); // 现在调用回调是安全的，因为已经释放了锁
-    }
+void QmiSmsReader::abandonCycle() {
+  if (!cycleActive_) {
+    return;
+  }
+  // 卡住的一轮不再等待，恢复后立即开始新的一轮
+  ++cycleGeneration_;
+  cycleActive_ = false;
+  if (MessageSyncContext *ctx = cycleCtx_) {
+    cycleCtx_ = nullptr;
+    // 尚未发出的读取不再发出；在途的请求迟到返回后释放上下文
+    ctx->window.abandon();
+    ctx->drained = [ctx] { delete ctx; };
+    pumpRawReads(ctx);
+  }
+  auto waiters = std::move(cycleIdleWaiters_);
+  cycleIdleWaiters_.clear();
+  for (auto &waiter : waiters)
+    waiter();
+}
 
-    std::this_thread::sleep_for(interval);
+void QmiSmsReader::finishRecovery(bool success,
+                                  RetryPolicy::Clock::time_point started) {
+  recovering_ = false;
+  consecutiveFailures_ = 0;
+  if (!success) {
+    // 下一次看门狗检查发现没有持久 client 时再试
+    ++failedRecoveries_;
+    std::cerr << "重新打开设备 " << devicePath_ << " 失败" << std::endl;
+    pumpDeletes();
+    pumpSends();
+    return;
   }
+  auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      RetryPolicy::Clock::now() - started);
+  lastRecoveryUs_ = elapsed.count();
+  ++recoveries_;
+  std::cout << "设备 " << devicePath_ << " 已恢复，用时 "
+            << elapsed.count() / 1000.0 << " ms" << std::endl;
+  // SIM 中的内容不受重新打开影响，但卡死期间可能有短信到达或索引被复用，
+  // 全部重新核对一遍；内容未变的分段不会重复送入重组表
+  for (auto &kv : partCache_)
+    kv.second.stale = true;
+  pumpDeletes();
+  pumpSends();
+  requestCycle();
 }
@@ -1,195 +1,633 @@
 #ifndef SMS_READER_HPP
 #define SMS_READER_HPP
 
+#include <array>
 #include <atomic>
 #include <chrono>
+#include <cstdint>
+#include <deque>
 #include <functional>
 #include <future>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
-#include <queue>
-
-// C Headers
-extern "C" {
-#include "pdulib.h"
-#include <glib-unix.h>
-#include <glib.h>
-#include <libqmi-glib.h>
-}
-
-// 单个短信分段结构
-struct SMSPart {
-  int memoryIndex;              // 短信在设备存储中的索引
-  int partNumber;               // 分段号
-  std::string hexPDU;           // 原始 PDU 十六进制文本
-  std::vector<uint8_t> rawData; // 原始 PDU 二进制数据
-  std::string text;             // 解码后的短信文本
-  std::string sender;           // 发件人号码
-  std::string timestamp;        // 时间戳
-};
-
-struct CompleteSMS {
-  std::string sender;
-  std::string timestamp;
-  std::string fullText;       // 完整消息
-  std::vector<SMSPart> parts; // 消息分段
-};
-
-// 用于同步列出短信的上下文
-struct ListContext {
-  GMainLoop *loop;
-  std::vector<int> *messageIndices;
-  bool success;
-};
-
-// 用于同步读取短信的上下文
+
+#include "IoContext.hpp"
+#include "MultipartAssembler.hpp"
+#include "ReadWindow.hpp"
+#include "RetryPolicy.hpp"
+#include "SeenSet.hpp"
+#include "SmsTypes.hpp"
+#include "SpscQueue.hpp"
+#include "WmsClientPool.hpp"
+#include "WmsTransport.hpp"
+
+// 增量轮询缓存：记录某个位置上已读取过的分段
+struct CachedPart {
+  uint64_t fingerprint; // 原始 PDU 的指纹，用于判断重新读取后内容是否变化
+  bool stale = false;   // 是否需要重新读取（索引可能已被复用）
+};
+
+// 用于读取短信的上下文，只在 I/O 线程上使用
 struct MessageSyncContext {
-  GMainLoop *loop;
   std::vector<CompleteSMS> completeSMSList;
-  // 按 memoryIndex 存储原始短信（实际应用中可能需要按分段参考号分组）
-  std::unordered_map<int, SMSPart> rawSMSMap;
-  int totalSMSCount = 0;
-  int processedSMSCount = 0;
-  std::promise<std::vector<CompleteSMS>> promise;
-  QmiDevice *device = nullptr;
-  QmiClientWms *client = nullptr;
-  bool temporaryClient = false; // 若为临时 client，则操作完成后需释放
-  
-  // 添加待处理的短信索引队列
-  std::queue<int> pendingSmsIndices;
-  
-  // 存储需要删除的重复短信索引
-  std::vector<int> toDeleteIndices;
-};
-
-// 用于同步删除短信的上下文
-struct DeleteSMSContext {
-  GMainLoop *loop;
-  uint memoryIndex;
-  std::promise<bool> promise;
-  QmiDevice *device = nullptr;
-  QmiClientWms *client = nullptr;
-  bool temporaryClient = false; // 若为临时 client，则操作完成后需释放
-};
-
-// 用于原始读取操作的上下文
-struct RawReadUserData {
-  MessageSyncContext *ctx;
-  int memoryIndex;
-  QmiMessageWmsRawReadInput *read_input;
-};
-
-// 用于同步 client 分配的上下文
-struct SynchronousClientContext {
-  GMainLoop *loop;
-  QmiClientWms *client;
-  bool success;
-};
-
-// 用于同步释放 client 的上下文
-struct ReleaseClientContext {
-  GMainLoop *loop;
-  bool success;
+  // 按位置有序存储原始短信，与读取完成的先后顺序无关
+  std::map<MessageSlot, SMSPart> rawSMSMap;
+  WmsClient *client = nullptr;
+  // client 所属的设备打开代次；设备重新打开后旧 client 失效，重试前改借新的
+  uint64_t clientEpoch = 0;
+  // 旧 client 失效后借用的 client，读取结束时归还
+  WmsClient *replacementClient = nullptr;
+  // 正在借用新 client 时等待的重试
+  std::vector<std::function<void()>> clientWaiters;
+  // 监听读取所属的轮次；设备重新打开时卡住的一轮被放弃，之后迟到的回调
+  // 只释放窗口，不再改动读取器的状态
+  uint64_t cycle = 0;
+
+  // 待读取位置与在途读取窗口
+  ReadWindow window;
+  // 窗口中的全部读取结束后调用
+  std::function<void()> drained;
+  // 监听读取：每读完一个分段即交给解码线程，不等整轮结束
+  bool streaming = false;
+
+  // 存储需要删除的重复短信位置
+  std::vector<MessageSlot> toDeleteSlots;
+};
+
+// 一个存储的列表结果
+struct StorageListing {
+  SmsStorage storage;
+  bool listed = false;
+  std::vector<int> indices;
+};
+
+// 一轮监听读取的结果，由 I/O 线程交给解码线程
+struct FetchBatch {
+  // 已从存储中消失、被删除或内容被替换的位置，先于 parts 从重组表中移除
+  std::vector<MessageSlot> removedSlots;
+  // 新读取且内容有变化的分段，只含原始 PDU；同一批内按索引排序
+  std::vector<SMSPart> parts;
+};
+
+// 监听流水线各阶段的队列深度与阻塞次数
+struct PipelineStats {
+  size_t fetchQueueDepth = 0;    // 等待解码的读取批次数
+  size_t deliveryQueueDepth = 0; // 等待回调的短信数
+  uint64_t cycles = 0;           // 完成的读取轮次
+  uint64_t delivered = 0;        // 已交给回调的短信数
+  uint64_t fetchStalls = 0;    // 解码积压导致推迟读取的次数
+  uint64_t deliveryStalls = 0; // 回调积压导致解码线程等待的次数
+  // 当前（或最近一轮）读取的进度：需要读取的索引数与其中已结束的数，
+  // 重启后清空 SIM 中积压短信时可据此估计剩余量
+  size_t cycleReads = 0;
+  size_t cycleReadsDone = 0;
+};
+
+// 删除队列中的一项；done 为空时不回报结果
+struct PendingDelete {
+  MessageSlot slot;
+  std::function<void(bool success)> done;
+};
+
+// 监听期间的设备看门狗：本轮读取长时间未结束，或 WMS 调用连续失败时，
+// 判定设备或 qmi-proxy 卡死，关闭并重新打开设备
+struct WatchdogOptions {
+  std::chrono::milliseconds checkInterval{5000}; // 检查周期
+  std::chrono::milliseconds stuckCycle{45000};   // 一轮读取的最长时间
+  int maxConsecutiveFailures = 8; // 连续超时或列表失败的次数上限
+};
+
+struct WatchdogStats {
+  uint64_t recoveries = 0;       // 重新打开设备并恢复监听的次数
+  uint64_t failedRecoveries = 0; // 重新打开失败的次数，下次检查时再试
+  // 最近一次恢复从关闭设备到恢复读取的用时
+  std::chrono::microseconds lastRecoveryTime{0};
+};
+
+// 存储容量监控：监听期间定期查询各存储的容量与已读短信数，每轮读取的
+// 未读列表随之更新占用。任一存储的占用达到高水位时进入清空模式，缩短轮询
+// 周期并删除已标记为已读的短信；回落到低水位以下时退出
+struct CapacityOptions {
+  std::chrono::milliseconds checkInterval{30000}; // 检查周期
+  double highWater = 0.8; // 进入清空模式的占用比例
+  double lowWater = 0.5;  // 退出清空模式的占用比例
+  std::chrono::seconds drainPollInterval{5}; // 清空模式下的轮询周期
+};
+
+// 一个存储的容量与占用；容量尚未查询成功时为 0
+struct StorageUsage {
+  SmsStorage storage = SmsStorage::Uim;
+  uint32_t capacity = 0;
+  size_t unread = 0; // 最近一轮读取列出的未读短信数
+  size_t read = 0;   // 最近一次检查列出的已读短信数
+};
+
+struct CapacityStats {
+  std::vector<StorageUsage> storages; // 按 SmsStorage 顺序
+  bool draining = false;              // 是否处于清空模式
+  uint64_t drainEntries = 0;          // 进入清空模式的次数
+};
+
+// 发送队列：短信编码为一个或多个分段后排队，分段按令牌桶限速提交，同时
+// 在途的 raw-send 请求数受窗口限制。发送与读取在 I/O 线程上交错进行，不等待
+// 读取轮次结束
+struct SendOptions {
+  double partsPerSecond = 1.0; // 令牌桶速率（分段/秒），0 表示不限速
+  int burst = 4;               // 令牌桶容量：空闲之后可连续提交的分段数
+  int maxInFlight = 2;         // 同时在途的 raw-send 请求数
+  size_t maxQueued = 10000;    // 排队中的短信数上限，超出时立即以失败结束
 };
 
+// 一条短信的发送结果
+struct SendResult {
+  bool success = false;
+  size_t parts = 0;     // 编码后的分段数
+  size_t partsSent = 0; // 网络确认提交的分段数
+  // 各分段由网络分配的消息参考号（TP-MR），未提交成功的为 0
+  std::vector<uint16_t> messageIds;
+  std::chrono::microseconds queueTime{0};  // 加入队列到提交第一个分段
+  std::chrono::microseconds submitTime{0}; // 提交第一个分段到全部分段结束
+  // 失败原因：invalid（号码无效或正文过长）、queue_full、timeout（可能已
+  // 发出）、rejected、no_client、stopped
+  std::string error;
+};
+
+struct SendStats {
+  size_t queued = 0;      // 尚未结束的短信数（含在途）
+  uint64_t sent = 0;      // 发送成功的短信数
+  uint64_t failed = 0;    // 发送失败的短信数
+  uint64_t partsSent = 0; // 网络确认提交的分段数
+};
+
+// 发送队列中的一条短信，仅在 I/O 线程上访问
+struct PendingSend {
+  std::vector<std::vector<uint8_t>> pdus;
+  size_t submitted = 0; // 已提交的分段数
+  size_t finished = 0;  // 已结束的分段数
+  bool failed = false;  // 有分段失败，其余分段不再提交
+  SendResult result;
+  std::chrono::steady_clock::time_point enqueued;
+  std::chrono::steady_clock::time_point firstSubmitted;
+  std::function<void(SendResult)> done;
+};
+
+// 启动各阶段完成的时刻，尚未完成的阶段为默认构造的时间点
+struct StartupStats {
+  std::chrono::steady_clock::time_point created;      // 开始构造
+  std::chrono::steady_clock::time_point deviceOpened; // 设备打开
+  std::chrono::steady_clock::time_point clientReady;  // client 池预热完成
+  std::chrono::steady_clock::time_point listening;    // 监听就绪
+  // 首轮读取结束，SIM 中的积压短信已全部交给流水线
+  std::chrono::steady_clock::time_point backlogRead;
+  // 第一条短信交给回调
+  std::chrono::steady_clock::time_point firstDelivered;
+};
+
+// 监听模式
+enum class ListenMode {
+  Polling,    // 每隔 interval 轮询一次 SIM
+  Indication, // 由 WMS event-report 指示驱动，interval 仅作为兜底轮询周期
+};
+
+// 每个读取器绑定一个 I/O 线程（见 IoContext），所有 WMS 调用都只在该线程上
+// 发起；多个读取器可以共享同一个 I/O 线程。与设备的通信由 WmsTransport 完成，
+// 读取器本身不依赖 libqmi。公开的同步接口把操作投递到 I/O 线程并等待其
+// future；*Async 接口直接返回 future。不能在 I/O 线程上调用同步接口。
 class QmiSmsReader {
 public:
-  // 构造时指定设备路径，默认"/dev/cdc-wdm0"
-  explicit QmiSmsReader(const std::string &devicePath = "/dev/cdc-wdm0");
+  // 构造时指定设备路径，默认"/dev/cdc-wdm0"，使用 libqmi 传输层；
+  // io 为空时使用独占的 I/O 线程
+  explicit QmiSmsReader(const std::string &devicePath = "/dev/cdc-wdm0",
+                        IoContext *io = nullptr);
+  // 使用指定的传输层（例如模拟设备）
+  QmiSmsReader(std::unique_ptr<WmsTransport> transport,
+               const std::string &devicePath, IoContext *io = nullptr);
   ~QmiSmsReader();
 
+  // 设备标识，写入该读取器产出的每条短信的 deviceId
+  void setDeviceId(const std::string &deviceId) { deviceId_ = deviceId; }
+  const std::string &deviceId() const { return deviceId_; }
+  const std::string &devicePath() const { return devicePath_; }
+
   // 同步方式一次性读取全部短信，返回一个 CompleteSMS 数组
   std::vector<CompleteSMS> readAllMessages();
+  std::future<std::vector<CompleteSMS>> readAllMessagesAsync();
 
-  // 异步监听：启动监听进程，每隔 interval 调用一次；新短信通过 callback
-  // 单条传出
+  // 异步监听：启动监听流水线；新短信通过 callback 单条传出。
+  // Polling 模式下每隔 interval 读取一次；Indication 模式下收到新短信指示即读取，
+  // 并每隔 interval 兜底轮询一次，以防指示丢失。
+  // I/O 线程只负责读取，解码与重组在解码线程上进行，callback 在投递线程上
+  // 调用；阶段之间以有界队列相连，后一阶段积压时前一阶段暂停
   void startListening(std::chrono::seconds interval,
-                      std::function<void(const CompleteSMS &)> callback);
-
-  // 同步删除短信
-  bool deleteMessage(int memoryIndex);
+                      std::function<void(const CompleteSMS &)> callback,
+                      ListenMode mode = ListenMode::Polling);
+
+  // 删除短信。删除请求进入 I/O 线程上的删除队列，在两轮读取之间以在途窗口
+  // 连续提交（窗口大小与原始读取相同），future 在该条删除结束时就绪。
+  // 同步接口等待删除完成
+  bool deleteMessage(MessageSlot slot);
+  std::future<bool> deleteMessageAsync(MessageSlot slot);
+  // 一次加入多条，future 在全部结束后就绪，值为成功删除的条数
+  std::future<size_t> deleteMessagesAsync(std::vector<MessageSlot> slots);
+
+  // 等待删除队列清空（包括在途的删除）
+  void waitForDeletes();
+
+  // 将短信标记为已读（MT_READ），之后不再出现在未读列表中，也不会被重新读取。
+  // 只加入队列，投递线程在已到达的短信全部回调后批量提交；应在监听回调中调用
+  void markMessageRead(MessageSlot slot);
+  // 立即依次标记，返回成功的条数
+  std::future<size_t> markReadAsync(std::vector<MessageSlot> slots);
+
+  // 发送短信：在调用线程上编码为 SMS-SUBMIT（过长时按分段 UDH 拆分），
+  // 加入 I/O 线程上的发送队列。done 在 I/O 线程上调用，不应阻塞。监听与否
+  // 均可调用，监听中复用持久 client
+  void sendMessage(const std::string &recipient, const std::string &text,
+                   std::function<void(SendResult)> done);
+  std::future<SendResult> sendMessageAsync(const std::string &recipient,
+                                           const std::string &text);
+  // 同步接口等待该条短信发送结束
+  SendResult sendMessage(const std::string &recipient,
+                         const std::string &text);
+
+  // 设置发送限速与在途窗口，可随时调用
+  void setSendOptions(const SendOptions &options);
+  // 发送队列的状态，可在任意线程调用
+  SendStats sendStats() const;
 
   // 停止监听，释放所有资源
   void stopListening();
 
-  // 列出所有短信的索引，新增参数表示是否已持有锁
-  std::vector<int> listAllMessages(bool alreadyLocked = false);
+  // 列出各存储中全部未读短信的位置；success 非空时写入是否至少有一个存储
+  // 列出成功
+  std::vector<MessageSlot> listAllMessages(bool *success = nullptr);
+
+  // 设置读取的存储，默认同时读取 SIM（UIM）与调制解调器存储（NV）。各存储
+  // 的列表同时发出，原始读取共用同一个在途窗口。须在 startListening 之前
+  // 调用
+  void setStorages(std::vector<SmsStorage> storages);
+
+  // 设置每轮读取中同时在途的原始读取请求数，默认 4
+  void setReadWindow(int maxInFlight);
+
+  // 设置分段短信重组的超时时间，以及超时后是否按不完整短信投递
+  void setMultipartTimeout(std::chrono::seconds timeout, bool deliverPartial);
+
+  // 设置投递线程在已到达的短信全部回调后调用的函数，在提交其中标记的已读
+  // 之前调用；调用方可借此对同一批短信统一处理（例如只等待一次落盘）。
+  // 须在 startListening 之前调用
+  void setOnDeliveryIdle(std::function<void()> onIdle) {
+    onDeliveryIdle_ = std::move(onIdle);
+  }
+
+  // 监听过程中等待其余分段的分段数
+  size_t pendingSegmentCount() const;
+
+  // 设置去重表可记录的短信指纹数，超出后淘汰最久未出现的指纹，默认 16384。
+  // 会清空已有记录，须在 startListening 之前调用
+  void setSeenCapacity(size_t capacity);
+
+  // 监听流水线的当前状态，可在任意线程调用
+  PipelineStats pipelineStats() const;
+
+  // 设置 WMS 调用的重试退避、时间预算与超时范围，会清空已观测的延迟
+  void setRetryOptions(const RetryPolicy::Options &options);
+  // 各类 WMS 调用的重试、放弃、超时次数与当前超时时间，可在任意线程调用
+  RetryPolicy::Stats retryStats() const { return retryPolicy_.stats(); }
+
+  // 设置看门狗的检查周期与判定条件，须在 startListening 之前调用
+  void setWatchdogOptions(const WatchdogOptions &options) {
+    watchdogOptions_ = options;
+  }
+  // 看门狗恢复设备的次数与用时，可在任意线程调用
+  WatchdogStats watchdogStats() const;
+
+  // 启动各阶段的完成时刻；startListening 返回后可在任意线程调用
+  StartupStats startupStats() const;
+
+  // 设置存储容量检查的周期与高低水位，须在 startListening 之前调用
+  void setCapacityOptions(const CapacityOptions &options) {
+    capacityOptions_ = options;
+  }
+  // 各存储的容量与占用，可在任意线程调用
+  CapacityStats capacityStats() const;
+  // 是否处于清空模式。此时即使配置为保留短信，回调也应在短信写入出站
+  // 日志后将其删除，可在任意线程调用
+  bool draining() const { return draining_; }
+
+  // client 池的容量；构造时并发预热全部 client，持久 client 与首轮读取
+  // 都无需等待分配
+  static constexpr size_t kClientPoolSize = 2;
+  // 删除队列中至少有这么多条时，才检查能否按已读标签一次删除
+  static constexpr size_t kTagDeleteMinBatch = 4;
+  // 非 UIM 存储连续列出失败这么多次后视为设备不支持，不再读取
+  static constexpr int kStorageErrorLimit = 3;
+  // 读取批次队列与待回调短信队列的容量
+  static constexpr size_t kFetchQueueDepth = 4;
+  static constexpr size_t kDeliveryQueueDepth = 64;
 
 private:
+  // 须最先构造、最后析构：传输层的对象都在它的线程上释放
+  std::unique_ptr<IoContext> ownedIo_;
+  IoContext &io_;
+  std::unique_ptr<WmsTransport> transport_;
+  // 所有 WMS 调用共用的重试与超时策略，仅在 I/O 线程上调用
+  RetryPolicy retryPolicy_;
+  // 一次性操作、删除队列与监听共用的 client 池，仅在 I/O 线程上访问
+  WmsClientPool clientPool_;
+
   std::string devicePath_;
-  QmiDevice *device_ = nullptr;
+  std::string deviceId_;
+  bool deviceOpen_ = false;
 
   std::atomic<bool> listening_{false};
-  std::thread listenerThread_;
-
-  // 持久化异步监听中使用的 WMS Client 与相关互斥锁
-  std::mutex persistentClientMutex_;
-  QmiClientWms *persistentClient_ = nullptr;
-  std::mutex clientOperationMutex_;
-
-  // 用于异步监听时记录已处理短信，防止重复通知
-  std::mutex seenMutex_;
-  std::unordered_set<int> seenMessages_; // 用 memoryIndex 标记
-
-  // 内部同步读取接口（复用同步上下文实现）
-  std::vector<CompleteSMS> performSyncRead();
-
-  // 同步短信删除
-  bool performMessageDelete(int memoryIndex);
-
-  // 开始同步短信读取（前提：ctx->client 已就绪）
-  void startSyncListMessages(MessageSyncContext *ctx);
-
-  // 以下为各个异步回调函数，全部为静态成员函数，user_data 中传入 SyncContext*
-  // 或其他上下文
-  static void listMessagesReadyCallback(QmiClientWms *client, GAsyncResult *res,
-                                        gpointer user_data);
-  static void rawReadReadyCallback(QmiClientWms *client, GAsyncResult *res,
-                                   gpointer user_data);
-  static void releaseClientReadyCallback(QmiDevice *device, GAsyncResult *res,
-                                         gpointer user_data);
-  static void deleteMessageReadyCallback(QmiClientWms *client,
-                                         GAsyncResult *res, gpointer user_data);
-
-  // 用于释放客户端（异步调用封装，由同步接口调用）
-  static void releaseClient(QmiClient *client, gpointer user_data);
-
-  // 对所有短信进行后续处理（例如多段短信拼接等）
+  ListenMode listenMode_ = ListenMode::Polling;
+  std::chrono::seconds listenInterval_{60};
+
+  // 监听流水线：I/O 线程读取 -> fetchQueue_ -> 解码线程 -> deliveryQueue_
+  // -> 投递线程
+  SpscQueue<FetchBatch> fetchQueue_{kFetchQueueDepth};
+  SpscQueue<CompleteSMS> deliveryQueue_{kDeliveryQueueDepth};
+  std::thread decodeThread_;
+  std::thread deliveryThread_;
+  std::function<void()> onDeliveryIdle_;
+  std::atomic<bool> decodeRunning_{false};
+  std::atomic<bool> deliveryRunning_{false};
+  // I/O 线程因 fetchQueue_ 已满而推迟了读取，解码线程取走批次后恢复
+  std::atomic<bool> fetchStalled_{false};
+  std::atomic<uint64_t> cycleCount_{0};
+  std::atomic<uint64_t> deliveredCount_{0};
+  std::atomic<uint64_t> fetchStalls_{0};
+  std::atomic<uint64_t> deliveryStalls_{0};
+  std::atomic<size_t> cycleReads_{0};
+  std::atomic<size_t> cycleReadsDone_{0};
+
+  // 读取调度，以下均仅在 I/O 线程上访问
+  // 本轮读取进行中又有读取请求（新短信指示、定时器），结束后立即再读一轮
+  bool cycleRequested_ = false;
+  // 递增后使已投递的定时器失效
+  uint64_t timerGeneration_ = 0;
+  // 读取器析构时释放，使仍在 I/O 线程上排队的定时器不再访问读取器
+  std::shared_ptr<bool> timerGuard_ = std::make_shared<bool>(true);
+  // 本轮读取结束时调用，用于停止监听
+  std::vector<std::function<void()>> cycleIdleWaiters_;
+  RetryPolicy::Clock::time_point cycleStarted_;
+  // 每轮读取开始或被放弃时递增，迟到的回调据此判断所属的一轮是否仍有效
+  uint64_t cycleGeneration_ = 0;
+  // 本轮正在进行原始读取的上下文
+  MessageSyncContext *cycleCtx_ = nullptr;
+  // 设备每次重新打开时递增，之前分配的 client 全部失效
+  uint64_t clientEpoch_ = 0;
+
+  // 看门狗，以下除统计外均仅在 I/O 线程上访问
+  WatchdogOptions watchdogOptions_;
+  uint64_t watchdogGeneration_ = 0;
+  int consecutiveFailures_ = 0;
+  // 正在重新打开设备；期间不发起读取，也不提交删除
+  bool recovering_ = false;
+  std::atomic<uint64_t> recoveries_{0};
+  std::atomic<uint64_t> failedRecoveries_{0};
+  std::atomic<int64_t> lastRecoveryUs_{0};
+
+  // 存储容量监控；各计数在 I/O 线程上更新，可在任意线程读取
+  CapacityOptions capacityOptions_;
+  uint64_t capacityGeneration_ = 0;
+  std::array<std::atomic<uint32_t>, kSmsStorageCount> storageCapacity_{};
+  std::array<std::atomic<size_t>, kSmsStorageCount> unreadCount_{};
+  std::array<std::atomic<size_t>, kSmsStorageCount> readCount_{};
+  std::atomic<bool> draining_{false};
+  std::atomic<uint64_t> drainEntries_{0};
+
+  // 启动各阶段的完成时刻；首轮读取在 I/O 线程上结束，单独以原子变量记录
+  StartupStats startup_;
+  std::atomic<std::chrono::steady_clock::rep> backlogReadTicks_{0};
+  std::atomic<std::chrono::steady_clock::rep> firstDeliveredTicks_{0};
+
+  // 监听期间从池中借出并一直占用的 client，仅在 I/O 线程上访问
+  WmsClient *persistentClient_ = nullptr;
+
+  // 读取的存储，以及各存储连续列出失败（非超时）的次数，仅在 I/O 线程上访问
+  std::vector<SmsStorage> storages_{SmsStorage::Uim, SmsStorage::Nv};
+  std::array<int, kSmsStorageCount> storageErrors_{};
+
+  // 同时在途的原始读取请求数
+  std::atomic<int> readWindow_{4};
+
+  // 增量轮询缓存：位置 -> 原始 PDU 指纹，仅在 I/O 线程上访问
+  std::map<MessageSlot, CachedPart> partCache_;
+  // 需要从重组表中移除、随下一个读取批次交给解码线程的位置，仅在 I/O 线程上访问
+  std::vector<MessageSlot> pendingRemovals_;
+  // 跨轮次的分段短信重组表，由解码线程使用；互斥量供设置选项时使用
+  std::mutex assemblerMutex_;
+  MultipartAssembler assembler_;
+  std::atomic<size_t> pendingSegments_{0};
+  // 新短信指示中点名、需要重新读取的位置，仅在 I/O 线程上访问
+  std::vector<MessageSlot> staleSlots_;
+
+  // 等待本轮结束后批量标记为已读的位置
+  std::mutex markReadMutex_;
+  std::vector<MessageSlot> pendingMarkRead_;
+
+  // 删除队列，以下均仅在 I/O 线程上访问
+  std::deque<PendingDelete> deleteQueue_;
+  // 已排队或在途、尚未结束删除的位置；读取时跳过
+  std::unordered_multiset<MessageSlot, MessageSlotHash> deletingSlots_;
+  int deletesInFlight_ = 0;
+  bool tagDeleteInFlight_ = false;
+  // 按标签删除期间暂缓提交的标记已读，删除结束后继续
+  std::vector<std::function<void()>> heldMarkReads_;
+  int markReadsInFlight_ = 0;
+  // 已投递、尚未执行的提交任务；同一轮事件中加入的删除合并提交
+  bool deletePumpPosted_ = false;
+  // 一轮读取进行中时暂停提交删除，读取优先
+  bool cycleActive_ = false;
+  // 未监听时删除队列从池中借用的 client，队列清空后归还
+  WmsClient *deleteClient_ = nullptr;
+  bool leasingDeleteClient_ = false;
+  // 删除队列清空时调用
+  std::vector<std::function<void()>> deleteDrainWaiters_;
+  // 本读取器标记为已读、尚未删除的位置
+  std::unordered_set<MessageSlot, MessageSlotHash> markedRead_;
+
+  // 发送队列，以下除统计外均仅在 I/O 线程上访问
+  SendOptions sendOptions_;
+  // 仍有分段未提交的短信
+  std::deque<std::shared_ptr<PendingSend>> sendQueue_;
+  int sendsInFlight_ = 0;
+  // 令牌桶：可立即提交的分段数及上次补充的时刻
+  double sendTokens_ = sendOptions_.burst;
+  RetryPolicy::Clock::time_point sendRefilled_ = RetryPolicy::Clock::now();
+  // 已投递、等待补充令牌的定时器
+  bool sendTimerPosted_ = false;
+  // 未监听时发送队列从池中借用的 client，队列清空后归还
+  WmsClient *sendClient_ = nullptr;
+  bool leasingSendClient_ = false;
+  // 析构中，新的发送立即以失败结束
+  bool sendClosed_ = false;
+  // 发送队列清空且没有在途分段时调用
+  std::vector<std::function<void()>> sendIdleWaiters_;
+  // 分段参考号，每条短信取一个，在调用线程上递增
+  std::atomic<uint8_t> nextConcatReference_{0};
+  std::atomic<size_t> sendQueued_{0};
+  std::atomic<uint64_t> sendSucceeded_{0};
+  std::atomic<uint64_t> sendFailed_{0};
+  std::atomic<uint64_t> partsSent_{0};
+
+  // 用于异步监听时记录已投递短信的内容指纹，防止重复通知；仅在解码线程上访问
+  SeenSet seenMessages_;
+
+  // 以下均在 I/O 线程上调用，通过 done 回调返回结果
+
+  // 取得可用的 client：监听中直接使用持久 client，否则从池中借用；
+  // op 结束后须调用 release，操作出错时传入 false 使池丢弃该 client
+  void withClientAsync(
+      std::function<void(WmsClient *client,
+                         std::function<void(bool healthy)> release)>
+          op);
+
+  // 删除单条短信，超时时按重试策略重试；成功时淘汰缓存，并在下一批次中
+  // 通知解码线程
+  void deleteSlotAsync(WmsClient *client, MessageSlot slot,
+                       RetryPolicy::Attempt attempt,
+                       std::function<void(bool success)> done);
+  // 重试的删除出错时列出 slot 所在存储，确认该索引已不带任何标签
+  void confirmDeletedAsync(WmsClient *client, MessageSlot slot,
+                           std::function<void(bool gone)> done);
+  // 删除成功后淘汰 slot 的缓存并更新占用计数
+  void forgetDeletedSlot(MessageSlot slot);
+
+  // 记录一次成功调用的延迟，用于调整该类调用的超时时间
+  void recordLatency(WmsOperation op, RetryPolicy::Clock::time_point issued);
+  // 记录一次调用失败（超时或列表失败）；连续失败过多时重新打开设备
+  void noteFailure();
+
+  // 看门狗定期检查：本轮读取是否卡死、上次恢复是否失败
+  void scheduleWatchdog(uint64_t generation);
+  // 关闭并重新打开设备，重新取得持久 client 与新短信指示后恢复读取
+  void recoverDevice(const char *reason);
+  void finishRecovery(bool success, RetryPolicy::Clock::time_point started);
+  // 放弃进行中的一轮读取：设备重新打开后其回调可能永远不会返回
+  void abandonCycle();
+
+  // 定期查询各存储的容量与已读短信数
+  void scheduleCapacityCheck(uint64_t generation);
+  void checkCapacity();
+  // 按各存储的占用进入或退出清空模式
+  void updateDrainMode();
+  // 标记或删除成功后更新占用，下次列出时再以设备的结果为准
+  void adjustUsage(SmsStorage storage, int unread, int read);
+  // 清空模式下删除本读取器标记为已读的短信，它们已写入出站日志
+  void deleteMarkedRead();
+
+  // 删除队列：加入一项，并在 I/O 线程处理完当前事件后提交
+  void enqueueDelete(MessageSlot slot,
+                     std::function<void(bool success)> done = nullptr);
+  // 在窗口允许的范围内提交排队的删除；队列清空时释放临时 client 并通知等待者
+  void pumpDeletes();
+  // 排队的删除覆盖了本读取器在某个存储中标记为已读的全部短信时，核对该
+  // 存储的已读列表，一致则按标签一次删除；返回是否已发起该流程
+  bool tryDeleteByTag(WmsClient *client);
+  // 按标签删除的流程结束，继续提交期间暂缓的标记已读
+  void endTagDelete();
+  // 一项删除结束
+  void finishDelete(PendingDelete item, bool success);
+
+  // 在令牌与窗口允许的范围内提交排队短信的分段；队列清空且没有在途分段
+  // 时归还临时 client 并通知等待者
+  void pumpSends();
+  // 提交一个分段。不重试：超时的分段可能已经发出，重试会使对方收到重复的
+  // 短信，由请求方根据结果决定是否重发
+  void issueRawSend(WmsClient *client, std::shared_ptr<PendingSend> send,
+                    size_t part);
+  // 一条短信的已提交分段全部结束后回报结果
+  void finishSend(PendingSend &send);
+  // 排队短信中尚未提交的分段不再提交，对应短信以 error 失败
+  void failQueuedSends(const char *error);
+
+  // 依次将多条短信标记为已读，done 传出成功的条数
+  void markSlotsReadAsync(WmsClient *client, std::vector<MessageSlot> slots,
+                          size_t marked, std::function<void(size_t)> done);
+
+  // 提交监听回调中排队的已读标记
+  void flushMarkRead();
+
+  // 以在途窗口读取 slots 中的短信，全部结束后调用 ctx->drained
+  void readSlotsAsync(MessageSyncContext *ctx,
+                      const std::vector<MessageSlot> &slots);
+
+  // 同时列出 storages_ 中各存储带有 tag 的短信，全部结束后一并传出
+  void listStoragesAsync(WmsClient *client, WmsMessageTag tag,
+                         std::function<void(std::vector<StorageListing>)> done);
+  // 列出单个存储，超时时按重试策略退避后重新列出
+  void listStorageAsync(WmsClient *client, SmsStorage storage,
+                        WmsMessageTag tag, RetryPolicy::Attempt attempt,
+                        std::function<void(StorageListing)> done);
+
+  // 监听中的一轮增量读取
+  void listenCycleAsync(std::function<void(FetchBatch)> done);
+
+  // 请求一轮读取：进行中则在结束后再读一轮；fetchQueue_ 已满则推迟到
+  // 解码线程取走批次之后
+  void requestCycle();
+  // 本轮读取结束后的调度：有积压的请求立即再读，否则等待 interval
+  void scheduleNextCycle();
+
+  // 新短信指示（I/O 线程上调用）
+  void onNewMessageIndication(MessageSlot slot);
+
+  // 解析单个分段的 PDU，填充文本、发件人、时间戳与分段信息
+  static bool decodePart(SMSPart &part);
+
+  // 解析上下文中全部分段，丢弃解析失败的分段
+  static void decodeAllParts(MessageSyncContext *ctx);
+
+  // 原始 PDU 指纹
+  static uint64_t fingerprintPDU(const std::vector<uint8_t> &rawData);
+
+  // 按某个存储的最新列表淘汰该存储的缓存，并返回需要读取的位置（新增或失效）
+  std::vector<MessageSlot>
+  refreshPartCache(SmsStorage storage, const std::vector<int> &messageIndices);
+
+  // 比较本轮新读取分段的指纹并写入缓存，内容有变化的分段连同待移除的位置
+  // 组成读取批次
+  FetchBatch collectFetched(MessageSyncContext *ctx);
+  // 监听读取中每个分段读完后调用：fetchQueue_ 留有余量时立即交出已读取的
+  // 分段，否则留待之后一并交出。始终保留一个空位给本轮的最后一批
+  void streamFetched(MessageSyncContext *ctx);
+
+  // 解码线程：解析批次中的分段并送入重组表，返回完成的短信
+  std::vector<CompleteSMS> assembleBatch(FetchBatch &batch);
+
+  // 对所有短信进行后续处理（例如多段短信拼接等），输入为已解析的分段
   static void processAllSMS(MessageSyncContext *ctx);
 
-  // 对短信 PDU 解析，返回 SMSMessage（仅用于提取文本，此处可自定义实现）
-  struct SMSMessage {
-    std::string sender;
-    std::string text;
-  };
-
-  // 异步监听线程主循环：定时调用同步读取，并将新短信通过 callback 传出
-  void pollingLoop(std::chrono::seconds interval,
-                   std::function<void(const CompleteSMS &)> callback);
-
-  // 构造和释放 WMS Client 的同步封装
-  QmiClientWms *createWmsClientSync();
-  void releaseWmsClientSync(QmiClientWms *client);
-
-  // 用于同步 client 分配的回调
-  static void synchronousAllocateClientCallback(QmiDevice *device,
-                                                GAsyncResult *res,
-                                                gpointer user_data);
-  // 用于同步释放 client 的回调
-  static void synchronousReleaseClientCallback(QmiDevice *device,
-                                               GAsyncResult *res,
-                                               gpointer user_data);
+  // 解码线程主循环：取出读取批次，解码、重组并去重后送入 deliveryQueue_
+  void decodeLoop();
+
+  // 投递线程主循环：逐条调用 callback，队列清空时调用 onDeliveryIdle_ 并
+  // 提交排队的已读标记
+  void deliveryLoop(std::function<void(const CompleteSMS &)> callback);
 
   // 设备初始化和关闭
   bool initDevice();
   void closeDevice();
 
-  // 处理队列中的下一条短信
-  static void processNextSms(MessageSyncContext *ctx);
+  // 在窗口允许的范围内发出待读取短信的原始读取请求
+  void pumpRawReads(MessageSyncContext *ctx);
+
+  // 发出单条原始读取请求；超时时按重试策略退避后重试，期间仍占用窗口
+  void issueRawRead(MessageSyncContext *ctx, MessageSlot slot,
+                    RetryPolicy::Attempt attempt);
+  // 所属的一轮已被放弃的监听读取上下文
+  bool abandoned(const MessageSyncContext *ctx) const {
+    return ctx->streaming && ctx->cycle != cycleGeneration_;
+  }
 };
 
 #endif // SMS_READER_HPP
@@ -0,0 +1,76 @@
+#ifndef SMS_TYPES_HPP
+#define SMS_TYPES_HPP
+
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 短信所在的存储：SIM 卡（UIM）或调制解调器自身的存储（NV）
+enum class SmsStorage : uint8_t {
+  Uim,
+  Nv,
+};
+inline constexpr size_t kSmsStorageCount = 2;
+
+inline const char *smsStorageName(SmsStorage storage) {
+  return storage == SmsStorage::Nv ? "NV" : "UIM";
+}
+
+// 短信在设备上的位置。两个存储的索引各自从 0 编号，只有 (存储, 索引) 一起
+// 才能确定一条短信
+struct MessageSlot {
+  SmsStorage storage = SmsStorage::Uim;
+  int index = -1;
+
+  auto operator<=>(const MessageSlot &) const = default;
+};
+
+struct MessageSlotHash {
+  size_t operator()(const MessageSlot &slot) const {
+    return std::hash<int>()(slot.index) * kSmsStorageCount +
+           static_cast<size_t>(slot.storage);
+  }
+};
+
+inline std::ostream &operator<<(std::ostream &out, const MessageSlot &slot) {
+  return out << smsStorageName(slot.storage) << " " << slot.index;
+}
+
+// 单个短信分段结构
+struct SMSPart {
+  MessageSlot slot;             // 短信在设备存储中的位置
+  int partNumber = 1;           // 分段号
+  int totalParts = 1;           // 总分段数，单条短信为 1
+  int reference = 0;            // 分段参考号
+  std::vector<uint8_t> rawData; // 原始 PDU 二进制数据
+  std::string text;             // 解码后的短信文本
+  std::string sender;           // 发件人号码
+  std::string timestamp;        // 时间戳
+
+  // 原始 PDU 十六进制文本，仅在调试时按需生成
+  std::string hexPDU() const {
+    static const char kHex[] = "0123456789ABCDEF";
+    std::string hex;
+    hex.reserve(rawData.size() * 2);
+    for (uint8_t byte : rawData) {
+      hex.push_back(kHex[byte >> 4]);
+      hex.push_back(kHex[byte & 0x0F]);
+    }
+    return hex;
+  }
+};
+
+struct CompleteSMS {
+  std::string sender;
+  std::string timestamp;
+  std::string fullText;       // 完整消息
+  std::vector<SMSPart> parts; // 消息分段
+  bool complete = true;       // 分段是否齐全；超时按不完整短信投递时为 false
+  std::string deviceId;       // 接收该短信的设备标识，单设备时为空
+};
+
+#endif // SMS_TYPES_HPP
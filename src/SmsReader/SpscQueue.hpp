@@ -0,0 +1,113 @@
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// 有界单生产者单消费者队列：环形缓冲区，容量向上取整到 2 的幂。
+// tryPush/tryPop 无锁且不阻塞；waitPush/waitPop 供流水线中的工作线程使用，
+// 队列满或空时在原子变量上休眠，直到对端取走/放入元素或调用 wake。
+// 生产者与消费者各自只能在一个线程上使用。
+template <typename T> class SpscQueue {
+public:
+  explicit SpscQueue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) {
+      size <<= 1;
+    }
+    mask_ = size - 1;
+    slots_ = std::make_unique<T[]>(size);
+  }
+
+  SpscQueue(const SpscQueue &) = delete;
+  SpscQueue &operator=(const SpscQueue &) = delete;
+
+  // 队列已满时返回 false，value 保持不变
+  bool tryPush(T &&value) {
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) > mask_) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move(value);
+    tail_.store(tail + 1, std::memory_order_release);
+    signal(pushSignal_);
+    return true;
+  }
+
+  // 队列为空时返回 false
+  bool tryPop(T &out) {
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) {
+      return false;
+    }
+    out = std::move(slots_[head & mask_]);
+    // 释放元素占用的资源，不必等到槽位被覆盖
+    slots_[head & mask_] = T();
+    head_.store(head + 1, std::memory_order_release);
+    signal(popSignal_);
+    return true;
+  }
+
+  // 队列满时等待消费者取走元素；running 变为 false 时放弃并返回 false
+  bool waitPush(T &&value, const std::atomic<bool> &running) {
+    while (true) {
+      uint32_t seen = popSignal_.load(std::memory_order_acquire);
+      if (tryPush(std::move(value))) {
+        return true;
+      }
+      if (!running) {
+        return false;
+      }
+      popSignal_.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  // 队列空时等待生产者放入元素；running 变为 false 且队列已空时返回 false，
+  // 因此停止前放入的元素仍会被取完
+  bool waitPop(T &out, const std::atomic<bool> &running) {
+    while (true) {
+      uint32_t seen = pushSignal_.load(std::memory_order_acquire);
+      if (tryPop(out)) {
+        return true;
+      }
+      if (!running) {
+        return false;
+      }
+      pushSignal_.wait(seen, std::memory_order_acquire);
+    }
+  }
+
+  // 唤醒所有在 waitPush/waitPop 中休眠的线程，使其重新检查 running
+  void wake() {
+    signal(pushSignal_);
+    signal(popSignal_);
+  }
+
+  size_t size() const {
+    return tail_.load(std::memory_order_acquire) -
+           head_.load(std::memory_order_acquire);
+  }
+  bool empty() const { return size() == 0; }
+  bool full() const { return size() > mask_; }
+  size_t capacity() const { return mask_ + 1; }
+
+private:
+  static void signal(std::atomic<uint32_t> &counter) {
+    counter.fetch_add(1, std::memory_order_release);
+    counter.notify_all();
+  }
+
+  std::unique_ptr<T[]> slots_;
+  size_t mask_ = 0;
+  // 生产者与消费者各写一个下标，分开放在不同缓存行上
+  alignas(64) std::atomic<size_t> head_{0};
+  alignas(64) std::atomic<size_t> tail_{0};
+  // 每次放入/取出后递增，供等待方休眠
+  alignas(64) std::atomic<uint32_t> pushSignal_{0};
+  std::atomic<uint32_t> popSignal_{0};
+};
+
+#endif // SPSC_QUEUE_HPP
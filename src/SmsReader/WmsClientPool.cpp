@@ -0,0 +1,171 @@
+#include "WmsClientPool.hpp"
+
+#include <iostream>
+#include <memory>
+
+void WmsClientPool::allocate(RetryPolicy::Attempt attempt,
+                             std::function<void(WmsClient *)> done) {
+  ++allocations_;
+  auto issued = RetryPolicy::Clock::now();
+  transport_.allocateClient([this, attempt, issued, done = std::move(done)](
+                                WmsClient *client, WmsStatus status) mutable {
+    if (client) {
+      owned_.insert(client);
+      retry_.recordLatency(
+          WmsOperation::AllocateClient,
+          std::chrono::duration_cast<std::chrono::microseconds>(
+              RetryPolicy::Clock::now() - issued));
+      done(client);
+      return;
+    }
+    if (status == WmsStatus::Timeout)
+      retry_.recordTimeout(WmsOperation::AllocateClient);
+    auto delay = retry_.nextDelay(attempt);
+    if (!delay) {
+      done(nullptr);
+      return;
+    }
+    io_.postAfter(*delay, [this, attempt, done = std::move(done)]() mutable {
+      allocate(attempt, std::move(done));
+    });
+  });
+}
+
+void WmsClientPool::warm(size_t count, std::function<void(size_t)> done) {
+  size_t total = idle_.size() + leased_ + allocating_;
+  size_t toAllocate = count > total ? count - total : 0;
+  if (toAllocate > maxClients_ - total)
+    toAllocate = maxClients_ - total;
+  if (toAllocate == 0) {
+    done(0);
+    return;
+  }
+  struct Progress {
+    size_t remaining;
+    size_t warmed = 0;
+    std::function<void(size_t)> done;
+  };
+  auto progress =
+      std::make_shared<Progress>(Progress{toAllocate, 0, std::move(done)});
+  for (size_t i = 0; i < toAllocate; ++i) {
+    ++allocating_;
+    RetryPolicy::Attempt attempt(WmsOperation::AllocateClient);
+    allocate(attempt, [this, progress](WmsClient *client) {
+      --allocating_;
+      if (client) {
+        ++progress->warmed;
+        // 预热期间已有操作在等待时直接交给它
+        ++leased_;
+        giveBack(client);
+      }
+      if (--progress->remaining == 0)
+        progress->done(progress->warmed);
+    });
+  }
+}
+
+void WmsClientPool::lease(std::function<void(WmsClient *)> done) {
+  if (!idle_.empty()) {
+    IdleClient idle = idle_.back();
+    idle_.pop_back();
+    ++leased_;
+    if (RetryPolicy::Clock::now() - idle.since >= kProbeIdleAfter) {
+      probe(idle.client, std::move(done));
+      return;
+    }
+    done(idle.client);
+    return;
+  }
+  if (idle_.size() + leased_ + allocating_ >= maxClients_) {
+    waiters_.push_back(std::move(done));
+    return;
+  }
+  ++allocating_;
+  RetryPolicy::Attempt attempt(WmsOperation::AllocateClient);
+  allocate(attempt, [this, done = std::move(done)](WmsClient *client) {
+    --allocating_;
+    if (!client) {
+      std::cerr << "无法分配 WMS 客户端" << std::endl;
+      done(nullptr);
+      return;
+    }
+    ++leased_;
+    done(client);
+  });
+}
+
+void WmsClientPool::giveBack(WmsClient *client, bool healthy) {
+  if (!client || !owned_.count(client))
+    return;
+  --leased_;
+  if (!healthy) {
+    // 出错的 client 可能已失效，释放后由下一个等待者重新分配
+    owned_.erase(client);
+    transport_.releaseClient(client, [] {});
+    if (!waiters_.empty()) {
+      auto waiter = std::move(waiters_.front());
+      waiters_.pop_front();
+      lease(std::move(waiter));
+    }
+    return;
+  }
+  if (!waiters_.empty()) {
+    auto waiter = std::move(waiters_.front());
+    waiters_.pop_front();
+    ++leased_;
+    waiter(client);
+    return;
+  }
+  idle_.push_back(IdleClient{client, RetryPolicy::Clock::now()});
+}
+
+void WmsClientPool::probe(WmsClient *client,
+                          std::function<void(WmsClient *)> done) {
+  // 长时间空闲期间设备可能已回收该 client（例如 modem 重启了 WMS 服务），
+  // 借出后的第一个操作才超时会拖慢整轮读取；先以一次轻量查询确认
+  transport_.getStoreMaxSize(
+      client, SmsStorage::Uim,
+      [this, client, done = std::move(done)](WmsStatus status,
+                                             uint32_t) mutable {
+        if (!owned_.count(client)) {
+          // 探测期间设备被重新打开，client 已被丢弃
+          lease(std::move(done));
+          return;
+        }
+        if (status == WmsStatus::Ok) {
+          done(client);
+          return;
+        }
+        std::cerr << "空闲的 WMS 客户端探测失败，重新借出" << std::endl;
+        ++probeFailures_;
+        --leased_;
+        owned_.erase(client);
+        transport_.releaseClient(client, [] {});
+        lease(std::move(done));
+      });
+}
+
+void WmsClientPool::releaseAll(std::function<void()> done) {
+  if (idle_.empty()) {
+    done();
+    return;
+  }
+  auto remaining = std::make_shared<size_t>(idle_.size());
+  auto shared = std::make_shared<std::function<void()>>(std::move(done));
+  std::vector<IdleClient> clients = std::move(idle_);
+  idle_.clear();
+  for (const IdleClient &idle : clients)
+    owned_.erase(idle.client);
+  for (const IdleClient &idle : clients) {
+    transport_.releaseClient(idle.client, [remaining, shared] {
+      if (--*remaining == 0)
+        (*shared)();
+    });
+  }
+}
+
+void WmsClientPool::discard() {
+  idle_.clear();
+  owned_.clear();
+  leased_ = 0;
+}
@@ -0,0 +1,79 @@
+#ifndef WMS_CLIENT_POOL_HPP
+#define WMS_CLIENT_POOL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <unordered_set>
+#include <vector>
+
+#include "IoContext.hpp"
+#include "RetryPolicy.hpp"
+#include "WmsTransport.hpp"
+
+// WMS client 池：预先分配的 client 借给各个操作，用完归还而不是释放，
+// 省去每次操作的分配/释放往返，也限制了同时占用的 client ID 数。
+// 只在读取器的 I/O 线程上使用。
+class WmsClientPool {
+public:
+  // 空闲超过该时长的 client 借出前先探测一次
+  static constexpr std::chrono::seconds kProbeIdleAfter{30};
+
+  WmsClientPool(WmsTransport &transport, IoContext &io, RetryPolicy &retry,
+                size_t maxClients)
+      : transport_(transport), io_(io), retry_(retry),
+        maxClients_(maxClients < 1 ? 1 : maxClients) {}
+
+  // 预先分配 count 个空闲 client（不超过上限），done 传出成功分配的个数
+  void warm(size_t count, std::function<void(size_t warmed)> done);
+
+  // 借出一个 client：优先使用空闲的，其次在上限内新分配，否则排队等待归还。
+  // 长时间空闲的 client 先以容量查询探测，无应答时释放并改借其他的。
+  // 分配失败时按重试策略退避重试，放弃后传出空指针
+  void lease(std::function<void(WmsClient *client)> done);
+
+  // 归还 client；healthy 为 false 时（操作出错）直接释放，下次借出时重新分配
+  void giveBack(WmsClient *client, bool healthy = true);
+
+  // 释放全部空闲 client；须在所有借出的 client 归还之后调用
+  void releaseAll(std::function<void()> done);
+
+  // 设备已关闭、全部 client 随之失效时调用：忘记空闲与借出的 client，
+  // 之后归还的旧 client 被忽略
+  void discard();
+
+  size_t idleCount() const { return idle_.size(); }
+  size_t leasedCount() const { return leased_; }
+  // 累计向设备分配 client 的次数
+  uint64_t allocations() const { return allocations_; }
+  // 探测失败而释放的空闲 client 数
+  uint64_t probeFailures() const { return probeFailures_; }
+
+private:
+  struct IdleClient {
+    WmsClient *client;
+    RetryPolicy::Clock::time_point since; // 归还的时刻
+  };
+
+  void allocate(RetryPolicy::Attempt attempt,
+                std::function<void(WmsClient *)> done);
+  // 确认已借出的 client 仍可用后交给 done，否则释放并重新借出
+  void probe(WmsClient *client, std::function<void(WmsClient *)> done);
+
+  WmsTransport &transport_;
+  IoContext &io_;
+  RetryPolicy &retry_;
+  size_t maxClients_;
+  std::vector<IdleClient> idle_;
+  // 由本池分配、尚未释放或丢弃的 client
+  std::unordered_set<WmsClient *> owned_;
+  size_t leased_ = 0;
+  size_t allocating_ = 0;
+  std::deque<std::function<void(WmsClient *)>> waiters_;
+  uint64_t allocations_ = 0;
+  uint64_t probeFailures_ = 0;
+};
+
+#endif // WMS_CLIENT_POOL_HPP
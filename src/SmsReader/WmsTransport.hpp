@@ -0,0 +1,135 @@
+#ifndef WMS_TRANSPORT_HPP
+#define WMS_TRANSPORT_HPP
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "SmsTypes.hpp"
+
+// WMS client 句柄，具体类型由传输层实现决定
+struct WmsClient;
+
+// 单次 WMS 调用的结果
+enum class WmsStatus {
+  Ok,
+  Timeout, // 设备未在超时时间内应答，可以重试
+  Error,
+};
+
+// 列出或删除短信时使用的标签
+enum class WmsMessageTag {
+  Unread, // MT_NOT_READ，新到达的短信
+  Read,   // MT_READ
+};
+
+// WMS 调用的种类，按类设置超时并统计重试
+enum class WmsOperation {
+  AllocateClient,
+  List,
+  RawRead,
+  Delete,
+  ModifyTag,
+  RawSend,
+};
+inline constexpr size_t kWmsOperationCount = 6;
+
+inline const char *wmsOperationName(WmsOperation op) {
+  switch (op) {
+  case WmsOperation::AllocateClient:
+    return "allocate";
+  case WmsOperation::List:
+    return "list";
+  case WmsOperation::RawRead:
+    return "raw_read";
+  case WmsOperation::Delete:
+    return "delete";
+  case WmsOperation::ModifyTag:
+    return "modify_tag";
+  case WmsOperation::RawSend:
+    return "raw_send";
+  }
+  return "unknown";
+}
+
+// QmiSmsReader 所用的 WMS 操作。实现负责与设备通信，读取器只处理调度、
+// 重试与解析。所有调用都在读取器的 I/O 线程上发起，完成回调也必须在该
+// 线程上调用。
+class WmsTransport {
+public:
+  WmsTransport() { timeouts_.fill(std::chrono::seconds(10)); }
+  virtual ~WmsTransport() = default;
+
+  // 某类调用的超时时间，默认 10 秒；读取器按观测到的延迟调整，
+  // 实现在之后发起的调用中使用
+  void setTimeout(WmsOperation op, std::chrono::milliseconds timeout) {
+    timeouts_[static_cast<size_t>(op)] = timeout;
+  }
+  std::chrono::milliseconds timeout(WmsOperation op) const {
+    return timeouts_[static_cast<size_t>(op)];
+  }
+
+  // 打开/关闭设备。关闭时未完成的调用须以失败结束，已分配的 client 随之
+  // 失效：之后以这些 client 发起的调用立即失败，释放它们不再访问设备
+  virtual void open(const std::string &devicePath,
+                    std::function<void(bool success)> done) = 0;
+  virtual void close(std::function<void()> done) = 0;
+
+  // 分配/释放 WMS client；分配失败时 client 为空
+  virtual void
+  allocateClient(std::function<void(WmsClient *client, WmsStatus)> done) = 0;
+  virtual void releaseClient(WmsClient *client,
+                             std::function<void()> done) = 0;
+
+  // 列出某个存储中带有指定标签的短信的索引。设备不支持该存储时以 Error
+  // 结束，与超时区分
+  virtual void
+  listMessages(WmsClient *client, SmsStorage storage, WmsMessageTag tag,
+               std::function<void(WmsStatus, std::vector<int> indices)>
+                   done) = 0;
+
+  // 读取单条短信的原始 PDU
+  virtual void
+  rawRead(WmsClient *client, MessageSlot slot,
+          std::function<void(WmsStatus, std::vector<uint8_t> pdu)> done) = 0;
+
+  // 删除单条短信
+  virtual void deleteMessage(WmsClient *client, MessageSlot slot,
+                             std::function<void(WmsStatus)> done) = 0;
+
+  // 一次删除某个存储中带有指定标签的全部短信
+  virtual void deleteByTag(WmsClient *client, SmsStorage storage,
+                           WmsMessageTag tag,
+                           std::function<void(bool success)> done) = 0;
+
+  // 将单条短信的标签改为已读（MT_READ），此后不再出现在未读列表中
+  virtual void markRead(WmsClient *client, MessageSlot slot,
+                        std::function<void(bool success)> done) = 0;
+
+  // 发送一条 SMS-SUBMIT PDU（含 SMSC 信息），成功时传出网络分配的消息参考号
+  // （TP-MR）。超时的发送可能已经发出
+  virtual void rawSend(WmsClient *client, const std::vector<uint8_t> &pdu,
+                       std::function<void(WmsStatus, uint16_t messageId)>
+                           done) = 0;
+
+  // 查询某个存储最多可保存的短信条数
+  virtual void
+  getStoreMaxSize(WmsClient *client, SmsStorage storage,
+                  std::function<void(WmsStatus, uint32_t maxSize)> done) = 0;
+
+  // 注册新短信指示。每次指示调用 onNewMessage，携带短信的存储位置；
+  // 未携带位置时 slot.index 为 -1
+  virtual void registerNewMessageIndications(
+      WmsClient *client, std::function<void(MessageSlot slot)> onNewMessage,
+      std::function<void(bool success)> done) = 0;
+  virtual void unregisterNewMessageIndications(WmsClient *client) = 0;
+
+private:
+  std::array<std::chrono::milliseconds, kWmsOperationCount> timeouts_;
+};
+
+#endif // WMS_TRANSPORT_HPP
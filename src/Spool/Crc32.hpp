@@ -0,0 +1,26 @@
+#ifndef CRC32_HPP
+#define CRC32_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// IEEE CRC-32，用于出站日志与短信归档的记录校验
+inline uint32_t crc32(const uint8_t *data, size_t len) {
+  static const auto table = [] {
+    std::array<uint32_t, 256> t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k)
+        c = (c & 1) ? 0xEDB88320U ^ (c >> 1) : c >> 1;
+      t[i] = c;
+    }
+    return t;
+  }();
+  uint32_t crc = 0xFFFFFFFFU;
+  for (size_t i = 0; i < len; ++i)
+    crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  return crc ^ 0xFFFFFFFFU;
+}
+
+#endif // CRC32_HPP
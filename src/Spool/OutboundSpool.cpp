@@ -0,0 +1,387 @@
+#include "OutboundSpool.hpp"
+#include "Crc32.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// 记录格式（小端）：magic u32 | type u8 | 保留 3 字节 | 长度 u32 | 序号 u64 |
+// CRC32 u32 | 负载
+constexpr uint32_t kRecordMagic = 0x4C505351; // "QSPL"
+constexpr size_t kHeaderSize = 24;
+constexpr uint8_t kRecordEntry = 1;
+constexpr uint8_t kRecordAck = 2;
+
+void putU32(std::string &out, uint32_t v) {
+  for (int i = 0; i < 4; ++i)
+    out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void putU64(std::string &out, uint64_t v) {
+  for (int i = 0; i < 8; ++i)
+    out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void putString(std::string &out, const std::string &s) {
+  putU32(out, static_cast<uint32_t>(s.size()));
+  out += s;
+}
+
+uint64_t getLE(const uint8_t *p, int bytes) {
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; ++i)
+    v |= static_cast<uint64_t>(p[i]) << (8 * i);
+  return v;
+}
+
+// 顺序读取负载字段，越界时 ok 置为 false
+struct Reader {
+  const uint8_t *p;
+  size_t left;
+  bool ok = true;
+
+  uint32_t u32() {
+    if (left < 4) {
+      ok = false;
+      return 0;
+    }
+    auto v = static_cast<uint32_t>(getLE(p, 4));
+    p += 4;
+    left -= 4;
+    return v;
+  }
+
+  std::string str() {
+    uint32_t len = u32();
+    if (!ok || left < len) {
+      ok = false;
+      return {};
+    }
+    std::string s(reinterpret_cast<const char *>(p), len);
+    p += len;
+    left -= len;
+    return s;
+  }
+};
+
+std::string encodeSms(const CompleteSMS &sms) {
+  std::string out;
+  putString(out, sms.sender);
+  putString(out, sms.timestamp);
+  putString(out, sms.fullText);
+  putU32(out, sms.complete ? 1 : 0);
+  putU32(out, static_cast<uint32_t>(sms.parts.size()));
+  for (const auto &part : sms.parts) {
+    // 高 8 位为存储类型；旧记录中恒为 0，即 UIM
+    putU32(out, (static_cast<uint32_t>(part.slot.index) & 0xFFFFFF) |
+                    (static_cast<uint32_t>(part.slot.storage) << 24));
+    putU32(out, static_cast<uint32_t>(part.partNumber));
+  }
+  putString(out, sms.deviceId);
+  return out;
+}
+
+bool decodeSms(const uint8_t *data, size_t len, CompleteSMS &sms) {
+  Reader r{data, len};
+  sms.sender = r.str();
+  sms.timestamp = r.str();
+  sms.fullText = r.str();
+  sms.complete = r.u32() != 0;
+  uint32_t partCount = r.u32();
+  for (uint32_t i = 0; r.ok && i < partCount; ++i) {
+    SMSPart part;
+    uint32_t slot = r.u32();
+    part.slot.index = static_cast<int>(slot & 0xFFFFFF);
+    part.slot.storage = static_cast<SmsStorage>(slot >> 24);
+    part.partNumber = static_cast<int>(r.u32());
+    sms.parts.push_back(std::move(part));
+  }
+  // 设备标识为后来追加的字段，旧记录中没有
+  if (r.ok && r.left > 0) {
+    sms.deviceId = r.str();
+  }
+  return r.ok;
+}
+
+std::string segmentName(uint64_t firstSeq) {
+  char name[48];
+  snprintf(name, sizeof(name), "spool-%020llu.log",
+           static_cast<unsigned long long>(firstSeq));
+  return name;
+}
+
+void syncDirectory(const std::string &dir) {
+  int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dfd >= 0) {
+    ::fsync(dfd);
+    ::close(dfd);
+  }
+}
+
+} // namespace
+
+OutboundSpool::OutboundSpool(Options options) : options_(std::move(options)) {
+  std::error_code ec;
+  fs::create_directories(options_.directory, ec);
+  if (ec) {
+    throw std::runtime_error("无法创建出站日志目录 " + options_.directory +
+                             ": " + ec.message());
+  }
+  recover();
+  openSegment(nextSeq_);
+  if (fd_ < 0) {
+    throw std::runtime_error("无法打开出站日志段文件");
+  }
+  // 新的当前段落盘之后才删除已全部确认的旧段：段文件名记录了序号的下限，
+  // 目录中至少保留一个段，重启后序号不会回退
+  dropDeadSegments();
+  flusher_ = std::thread(&OutboundSpool::flushLoop, this);
+}
+
+OutboundSpool::~OutboundSpool() {
+  {
+    std::unique_lock lock(mutex_);
+    stopping_ = true;
+  }
+  flushCv_.notify_all();
+  if (flusher_.joinable())
+    flusher_.join();
+  if (fd_ >= 0) {
+    ::fdatasync(fd_);
+    ::close(fd_);
+  }
+}
+
+void OutboundSpool::recover() {
+  std::map<uint64_t, std::string> files;
+  for (const auto &entry : fs::directory_iterator(options_.directory)) {
+    std::string name = entry.path().filename().string();
+    unsigned long long firstSeq = 0;
+    if (sscanf(name.c_str(), "spool-%20llu.log", &firstSeq) == 1) {
+      files[firstSeq] = entry.path().string();
+    }
+  }
+  for (const auto &[firstSeq, path] : files) {
+    // 段中的短信可能都已确认并随旧段删除，序号至少从段的起始序号继续
+    nextSeq_ = std::max<uint64_t>(nextSeq_, firstSeq);
+    segments_[firstSeq] = Segment{path, 0};
+    if (!replaySegment(firstSeq, path)) {
+      std::cerr << "出站日志段 " << path << " 尾部不完整，已忽略损坏部分"
+                << std::endl;
+    }
+  }
+  writtenSeq_ = durableSeq_ = nextSeq_ - 1;
+  if (!entries_.empty()) {
+    std::cerr << "出站日志中有 " << entries_.size() << " 条未确认的短信待重发"
+              << std::endl;
+  }
+}
+
+bool OutboundSpool::replaySegment(uint64_t firstSeq, const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  std::string buf((std::istreambuf_iterator<char>(in)),
+                  std::istreambuf_iterator<char>());
+  const auto *data = reinterpret_cast<const uint8_t *>(buf.data());
+  size_t pos = 0;
+  while (pos < buf.size()) {
+    if (buf.size() - pos < kHeaderSize ||
+        getLE(data + pos, 4) != kRecordMagic) {
+      return false;
+    }
+    uint8_t type = data[pos + 4];
+    auto len = static_cast<size_t>(getLE(data + pos + 8, 4));
+    uint64_t seq = getLE(data + pos + 12, 8);
+    auto crc = static_cast<uint32_t>(getLE(data + pos + 20, 4));
+    if (buf.size() - pos - kHeaderSize < len ||
+        crc32(data + pos + kHeaderSize, len) != crc) {
+      return false;
+    }
+    const uint8_t *payload = data + pos + kHeaderSize;
+    pos += kHeaderSize + len;
+
+    if (type == kRecordEntry) {
+      CompleteSMS sms;
+      if (!decodeSms(payload, len, sms)) {
+        return false;
+      }
+      entries_[seq] = Entry{std::move(sms), firstSeq};
+      ++segments_[firstSeq].live;
+      nextSeq_ = std::max(nextSeq_, seq + 1);
+    } else if (type == kRecordAck) {
+      nextSeq_ = std::max(nextSeq_, seq + 1);
+      auto it = entries_.find(seq);
+      if (it != entries_.end()) {
+        --segments_[it->second.segment].live;
+        entries_.erase(it);
+      }
+    }
+  }
+  return true;
+}
+
+void OutboundSpool::openSegment(uint64_t firstSeq) {
+  std::string path = (fs::path(options_.directory) / segmentName(firstSeq)).string();
+  int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    std::cerr << "无法打开出站日志段 " << path << ": " << strerror(errno)
+              << std::endl;
+    return;
+  }
+  syncDirectory(options_.directory);
+  if (fd_ >= 0) {
+    // 旧段在关闭前落盘，保证其中的记录都已持久
+    ::fdatasync(fd_);
+    ::close(fd_);
+    durableSeq_ = writtenSeq_;
+    durableCv_.notify_all();
+  }
+  fd_ = fd;
+  activeSegment_ = firstSeq;
+  activeBytes_ = static_cast<size_t>(::lseek(fd, 0, SEEK_END));
+  segments_.try_emplace(firstSeq, Segment{path, 0});
+}
+
+bool OutboundSpool::writeRecord(uint8_t type, uint64_t seq,
+                                const std::string &payload) {
+  std::string record;
+  record.reserve(kHeaderSize + payload.size());
+  putU32(record, kRecordMagic);
+  record.push_back(static_cast<char>(type));
+  record.append(3, '\0');
+  putU32(record, static_cast<uint32_t>(payload.size()));
+  putU64(record, seq);
+  putU32(record, crc32(reinterpret_cast<const uint8_t *>(payload.data()),
+                       payload.size()));
+  record += payload;
+
+  const char *p = record.data();
+  size_t left = record.size();
+  while (left > 0) {
+    ssize_t n = ::write(fd_, p, left);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      std::cerr << "写入出站日志失败: " << strerror(errno) << std::endl;
+      return false;
+    }
+    p += n;
+    left -= static_cast<size_t>(n);
+  }
+  activeBytes_ += record.size();
+  return true;
+}
+
+uint64_t OutboundSpool::append(const CompleteSMS &sms) {
+  std::string payload = encodeSms(sms);
+  std::unique_lock lock(mutex_);
+  if (activeBytes_ >= options_.segmentBytes) {
+    openSegment(nextSeq_);
+  }
+  uint64_t seq = nextSeq_;
+  if (fd_ < 0 || !writeRecord(kRecordEntry, seq, payload)) {
+    return 0;
+  }
+  ++nextSeq_;
+  writtenSeq_ = seq;
+  entries_[seq] = Entry{sms, activeSegment_};
+  ++segments_[activeSegment_].live;
+  flushCv_.notify_one();
+  return seq;
+}
+
+bool OutboundSpool::waitDurable(uint64_t seq) {
+  std::unique_lock lock(mutex_);
+  durableCv_.wait(lock,
+                  [&] { return durableSeq_ >= seq || failed_ || stopping_; });
+  return durableSeq_ >= seq;
+}
+
+void OutboundSpool::retire(uint64_t seq) {
+  std::unique_lock lock(mutex_);
+  auto it = entries_.find(seq);
+  if (it == entries_.end()) {
+    return;
+  }
+  // 确认记录丢失只会导致重发，不必等待落盘
+  if (fd_ >= 0 && writeRecord(kRecordAck, seq, std::string())) {
+    dirty_ = true;
+    flushCv_.notify_one();
+  }
+  --segments_[it->second.segment].live;
+  entries_.erase(it);
+  dropDeadSegments();
+}
+
+std::vector<std::pair<uint64_t, CompleteSMS>> OutboundSpool::pending() const {
+  std::unique_lock lock(mutex_);
+  std::vector<std::pair<uint64_t, CompleteSMS>> result;
+  result.reserve(entries_.size());
+  for (const auto &[seq, entry] : entries_) {
+    result.emplace_back(seq, entry.sms);
+  }
+  return result;
+}
+
+size_t OutboundSpool::pendingCount() const {
+  std::unique_lock lock(mutex_);
+  return entries_.size();
+}
+
+void OutboundSpool::dropDeadSegments() {
+  // 只从最旧的段开始删除，保证确认记录总是晚于其对应的短信被删除
+  while (!segments_.empty()) {
+    auto it = segments_.begin();
+    if (it->first == activeSegment_ || it->second.live > 0) {
+      break;
+    }
+    std::error_code ec;
+    fs::remove(it->second.path, ec);
+    segments_.erase(it);
+  }
+}
+
+void OutboundSpool::flushLoop() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    flushCv_.wait(lock, [&] {
+      return stopping_ || durableSeq_ < writtenSeq_ || dirty_;
+    });
+    if (stopping_) {
+      break;
+    }
+    // 稍作等待，让突发的多次追加共用一次 fdatasync
+    lock.unlock();
+    std::this_thread::sleep_for(options_.groupCommitDelay);
+    lock.lock();
+
+    uint64_t target = writtenSeq_;
+    dirty_ = false;
+    int fd = ::dup(fd_);
+    lock.unlock();
+    bool ok = fd >= 0 && ::fdatasync(fd) == 0;
+    if (fd >= 0)
+      ::close(fd);
+    lock.lock();
+    if (!ok) {
+      std::cerr << "出站日志落盘失败: " << strerror(errno) << std::endl;
+      failed_ = true;
+    } else {
+      failed_ = false;
+      durableSeq_ = std::max(durableSeq_, target);
+    }
+    durableCv_.notify_all();
+  }
+  durableCv_.notify_all();
+}
@@ -0,0 +1,88 @@
+#ifndef OUTBOUND_SPOOL_HPP
+#define OUTBOUND_SPOOL_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "SmsTypes.hpp"
+
+// 出站短信的持久化日志。每条短信在转发前追加到段文件中，fsync 后才视为持久；
+// 服务器确认后追加确认记录使其退役。重启时回放所有未确认的短信。
+//
+// 段文件按序号命名，只追加不修改；某段及其之前的所有段都不再有未确认的短信时
+// 整段删除。多次追加共用一次 fdatasync（组提交），fsync 次数不随突发流量线性增长。
+class OutboundSpool {
+public:
+  struct Options {
+    std::string directory = "spool";
+    size_t segmentBytes = 4 << 20; // 单个段文件的滚动阈值
+    // 组提交等待时间：首个待同步记录出现后等待这么久再 fdatasync
+    std::chrono::microseconds groupCommitDelay{2000};
+  };
+
+  // 打开（必要时创建）日志目录并恢复未确认的短信，失败抛出 std::runtime_error
+  explicit OutboundSpool(Options options);
+  ~OutboundSpool();
+
+  OutboundSpool(const OutboundSpool &) = delete;
+  OutboundSpool &operator=(const OutboundSpool &) = delete;
+
+  // 追加一条短信，返回其序号（从 1 开始）；写入失败返回 0
+  uint64_t append(const CompleteSMS &sms);
+
+  // 等待序号不大于 seq 的记录全部落盘；同步失败或日志关闭时返回 false
+  bool waitDurable(uint64_t seq);
+
+  // 服务器已确认，退役该短信
+  void retire(uint64_t seq);
+
+  // 按序号升序返回所有未确认的短信
+  std::vector<std::pair<uint64_t, CompleteSMS>> pending() const;
+  size_t pendingCount() const;
+
+private:
+  struct Segment {
+    std::string path;
+    size_t live = 0; // 段内未确认的短信数
+  };
+
+  struct Entry {
+    CompleteSMS sms;
+    uint64_t segment; // 所在段的起始序号
+  };
+
+  void recover();
+  bool replaySegment(uint64_t firstSeq, const std::string &path);
+  void openSegment(uint64_t firstSeq);
+  bool writeRecord(uint8_t type, uint64_t seq, const std::string &payload);
+  void dropDeadSegments();
+  void flushLoop();
+
+  Options options_;
+  mutable std::mutex mutex_;
+  std::condition_variable flushCv_;
+  std::condition_variable durableCv_;
+
+  int fd_ = -1;
+  uint64_t activeSegment_ = 0;
+  size_t activeBytes_ = 0;
+  std::map<uint64_t, Segment> segments_; // 起始序号 -> 段
+  std::map<uint64_t, Entry> entries_;    // 未确认的短信
+
+  uint64_t nextSeq_ = 1;
+  uint64_t writtenSeq_ = 0; // 已写入文件的最大序号
+  uint64_t durableSeq_ = 0; // 已落盘的最大序号
+  bool dirty_ = false;      // 有未落盘的确认记录
+  bool failed_ = false;
+  bool stopping_ = false;
+  std::thread flusher_;
+};
+
+#endif // OUTBOUND_SPOOL_HPP
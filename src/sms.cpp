@@ -1,20 +1,26 @@
-#include "SignUtils.hpp"
+#include "Forwarder.hpp"
+#include "IoScheduler.hpp"
+#include "MessageArchive.hpp"
+#include "OutboundSpool.hpp"
 #include "SmsReader.hpp"
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
 #include <csignal>
+#include <future>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <thread>
+#include <utility>
+#include <vector>
 
 #include <glog/logging.h>
 #include <ixwebsocket/IXNetSystem.h>
-#include <ixwebsocket/IXWebSocket.h>
-#include <nlohmann/json.hpp>
 #include <yaml-cpp/yaml.h>
 
-using json = nlohmann::json;
-
 namespace {
 std::atomic<bool> g_running{true}; // 全局运行状态标志
 }
@@ -22,29 +28,326 @@ std::atomic<bool> g_running{true}; // 全局运行状态标志
 // 信号处理
 void stop_signal_handler(int /*signal*/) { g_running.store(false); }
 
+// 单个调制解调器的配置
+struct DeviceConfig {
+  std::string path;
+  std::string id; // 写入转发短信的 device 字段，单设备配置时为空
+};
+
 // 配置结构体
 struct AppConfig {
-  std::string devicePath;
+  std::vector<DeviceConfig> devices;
+  int ioThreads = 1; // 所有设备共享的 I/O 线程数
   std::string wsUrl;
   std::string caCertPath;
   std::string secret;
   bool deleteAfterRead;
+  bool markReadAfterForward = false; // 不删除时将已转发的短信标记为已读
   bool debugEnabled;
+  ListenMode listenMode = ListenMode::Indication; // 监听模式
+  int pollInterval = 60; // 轮询周期（秒），指示模式下为兜底轮询周期
+  int readWindow = 4;    // 同时在途的原始读取请求数
+  double storageHighWater = 0.8; // 存储占用达到该比例时进入清空模式
+  double storageLowWater = 0.5;  // 回落到该比例以下时退出清空模式
+  int drainPollInterval = 5;     // 清空模式下的轮询周期（秒）
+  // 读取的存储：SIM 卡（uim）与调制解调器自身（nv）
+  std::vector<SmsStorage> storages{SmsStorage::Uim, SmsStorage::Nv};
+  int multipartTimeout = 3600;          // 分段短信等待其余分段的超时（秒）
+  bool deliverPartialMultipart = false; // 超时后是否投递不完整的分段短信
+  int seenCapacity = 16384;             // 每个设备去重表记录的短信数
+  std::string spoolDir = "spool";       // 出站日志目录
+  std::string archiveDir = "archive";   // 本地短信归档目录，为空时不归档
+  int archiveMaxMb = 256;               // 归档总大小上限（MiB）
+  int archiveMaxDays = 90;              // 归档保留天数
+  int forwardCreditWindow = 32; // 服务器授予信用前的在途短信上限
+  int forwardBatchSize = 16;    // 单个 send_batch 帧最多携带的短信数
+  int ackTimeout = 30;          // 等待服务器确认的超时（秒）
+  double sendRate = 1.0;        // 每个设备每秒提交的发送分段数，0 表示不限
+  int sendBurst = 4;            // 空闲后可连续提交的分段数
+  int sendWindow = 2;           // 每个设备同时在途的发送请求数
+  int sendQueueLimit = 10000;   // 每个设备排队等待发送的短信数上限
 };
 
 // 加载配置
 AppConfig loadConfig(const std::string &configPath) {
   AppConfig config;
   YAML::Node root = YAML::LoadFile(configPath);
-  config.devicePath = root["device_path"].as<std::string>();
+  // devices 列表中每项可以是设备路径，或 {path, id}；id 缺省为路径
+  if (root["devices"]) {
+    for (const auto &node : root["devices"]) {
+      DeviceConfig device;
+      if (node.IsScalar()) {
+        device.path = node.as<std::string>();
+      } else {
+        device.path = node["path"].as<std::string>();
+        if (node["id"])
+          device.id = node["id"].as<std::string>();
+      }
+      if (device.id.empty())
+        device.id = device.path;
+      config.devices.push_back(std::move(device));
+    }
+  } else {
+    config.devices.push_back(
+        DeviceConfig{root["device_path"].as<std::string>(), ""});
+  }
+  if (config.devices.empty()) {
+    throw std::runtime_error("未配置任何设备");
+  }
+  if (root["io_threads"]) {
+    config.ioThreads = root["io_threads"].as<int>();
+  }
   config.wsUrl = root["websocket_url"].as<std::string>();
   config.caCertPath = root["ca_cert_path"].as<std::string>();
   config.secret = root["secret_key"].as<std::string>();
   config.deleteAfterRead = root["delete_after_read"].as<bool>();
   config.debugEnabled = root["debug"].as<bool>();
+  if (root["mark_read_after_forward"]) {
+    config.markReadAfterForward = root["mark_read_after_forward"].as<bool>();
+  }
+  if (root["listen_mode"]) {
+    std::string mode = root["listen_mode"].as<std::string>();
+    if (mode == "polling") {
+      config.listenMode = ListenMode::Polling;
+    } else if (mode == "indication") {
+      config.listenMode = ListenMode::Indication;
+    } else {
+      throw std::runtime_error("未知的 listen_mode: " + mode);
+    }
+  }
+  if (root["poll_interval"]) {
+    config.pollInterval = root["poll_interval"].as<int>();
+  }
+  if (root["read_window"]) {
+    config.readWindow = root["read_window"].as<int>();
+  }
+  if (root["storage_high_water"]) {
+    config.storageHighWater = root["storage_high_water"].as<double>();
+  }
+  if (root["storage_low_water"]) {
+    config.storageLowWater = root["storage_low_water"].as<double>();
+  }
+  if (root["drain_poll_interval"]) {
+    config.drainPollInterval = root["drain_poll_interval"].as<int>();
+  }
+  if (root["storages"]) {
+    config.storages.clear();
+    for (const auto &node : root["storages"]) {
+      std::string storage = node.as<std::string>();
+      if (storage == "uim") {
+        config.storages.push_back(SmsStorage::Uim);
+      } else if (storage == "nv") {
+        config.storages.push_back(SmsStorage::Nv);
+      } else {
+        throw std::runtime_error("未知的 storages 项: " + storage);
+      }
+    }
+    if (config.storages.empty()) {
+      throw std::runtime_error("storages 不能为空");
+    }
+  }
+  if (root["multipart_timeout"]) {
+    config.multipartTimeout = root["multipart_timeout"].as<int>();
+  }
+  if (root["deliver_partial_multipart"]) {
+    config.deliverPartialMultipart =
+        root["deliver_partial_multipart"].as<bool>();
+  }
+  if (root["seen_capacity"]) {
+    config.seenCapacity = root["seen_capacity"].as<int>();
+  }
+  if (root["spool_dir"]) {
+    config.spoolDir = root["spool_dir"].as<std::string>();
+  }
+  if (root["archive_dir"]) {
+    config.archiveDir = root["archive_dir"].as<std::string>();
+  }
+  if (root["archive_max_mb"]) {
+    config.archiveMaxMb = root["archive_max_mb"].as<int>();
+  }
+  if (root["archive_max_days"]) {
+    config.archiveMaxDays = root["archive_max_days"].as<int>();
+  }
+  if (root["forward_credit_window"]) {
+    config.forwardCreditWindow = root["forward_credit_window"].as<int>();
+  }
+  if (root["forward_batch_size"]) {
+    config.forwardBatchSize = root["forward_batch_size"].as<int>();
+  }
+  if (root["ack_timeout"]) {
+    config.ackTimeout = root["ack_timeout"].as<int>();
+  }
+  if (root["send_rate"]) {
+    config.sendRate = root["send_rate"].as<double>();
+  }
+  if (root["send_burst"]) {
+    config.sendBurst = root["send_burst"].as<int>();
+  }
+  if (root["send_window"]) {
+    config.sendWindow = root["send_window"].as<int>();
+  }
+  if (root["send_queue_limit"]) {
+    config.sendQueueLimit = root["send_queue_limit"].as<int>();
+  }
   return config;
 }
 
+// 单个归档查询最多返回的短信数
+constexpr size_t kMaxArchiveQueryLimit = 1000;
+
+// 持续突发时一批最多积累的短信数，到达后不等投递队列清空即等待落盘
+constexpr size_t kMaxDurableBatch = 64;
+
+// 一个设备的投递线程上已追加到出站日志、尚未等待落盘的短信
+struct DurableBatch {
+  // 序号与短信；序号为 0 表示写入失败
+  std::vector<std::pair<uint64_t, CompleteSMS>> messages;
+};
+
+// 处理服务器发来的 query_archive 帧，以 archive_result 帧回复查询结果
+void handleArchiveQuery(const MessageArchive &archive, Forwarder &forwarder,
+                        const nlohmann::json &frame) {
+  MessageArchive::Query query;
+  query.fromMs = frame.value("from", int64_t{0});
+  if (frame.contains("to")) {
+    query.toMs = frame["to"].get<int64_t>();
+  }
+  query.sender = frame.value("sender", std::string());
+  query.textPrefix = frame.value("text_prefix", std::string());
+  query.deviceId = frame.value("device", std::string());
+  query.limit = static_cast<size_t>(
+      std::clamp(frame.value("limit", int64_t{100}), int64_t{0},
+                 static_cast<int64_t>(kMaxArchiveQueryLimit)));
+  bool raw = frame.value("raw", false);
+
+  auto begin = std::chrono::steady_clock::now();
+  auto entries = archive.query(query);
+  nlohmann::json messages = nlohmann::json::array();
+  for (const auto &entry : entries) {
+    const CompleteSMS &sms = entry.sms;
+    nlohmann::json item;
+    item["received_at"] = entry.receivedAtMs;
+    item["sender"] = sms.sender;
+    item["text"] = sms.fullText;
+    item["timestamp"] = sms.timestamp;
+    if (!sms.complete) {
+      item["partial"] = true;
+    }
+    if (!sms.deviceId.empty()) {
+      item["device"] = sms.deviceId;
+    }
+    nlohmann::json parts = nlohmann::json::array();
+    for (const auto &part : sms.parts) {
+      nlohmann::json p;
+      p["storage"] = smsStorageName(part.slot.storage);
+      p["index"] = part.slot.index;
+      p["part"] = part.partNumber;
+      p["total"] = part.totalParts;
+      if (raw) {
+        p["pdu"] = part.hexPDU();
+      }
+      parts.push_back(std::move(p));
+    }
+    item["parts"] = std::move(parts);
+    messages.push_back(std::move(item));
+  }
+  VLOG(1) << "[归档] 查询返回 " << entries.size() << " 条，用时 "
+          << std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - begin)
+                 .count()
+          << " ms";
+
+  nlohmann::json reply;
+  reply["action"] = "archive_result";
+  if (frame.contains("request_id")) {
+    reply["request_id"] = frame["request_id"];
+  }
+  reply["messages"] = std::move(messages);
+  if (!forwarder.sendFrame(reply.dump())) {
+    LOG(WARNING) << "[归档] 发送查询结果失败";
+  }
+}
+
+// 以 send_result 帧回报一条 send_sms 请求的结果
+void replySendResult(Forwarder &forwarder, const nlohmann::json &requestId,
+                     const std::string &deviceId, const SendResult &result) {
+  nlohmann::json reply;
+  reply["action"] = "send_result";
+  reply["request_id"] = requestId;
+  reply["success"] = result.success;
+  if (!deviceId.empty()) {
+    reply["device"] = deviceId;
+  }
+  reply["parts"] = result.parts;
+  reply["parts_sent"] = result.partsSent;
+  reply["message_ids"] = result.messageIds;
+  reply["queue_ms"] = result.queueTime.count() / 1000.0;
+  reply["submit_ms"] = result.submitTime.count() / 1000.0;
+  if (!result.success) {
+    reply["error"] = result.error;
+  }
+  if (!forwarder.sendFrame(reply.dump())) {
+    LOG(WARNING) << "[发送] 回报发送结果失败: " << reply.dump();
+  }
+}
+
+// 处理服务器发来的 send_sms 帧：指定 device 时由该设备发送，否则交给排队
+// 最少的设备。结果在设备的 I/O 线程上以 send_result 帧回报
+void handleSendSms(const std::vector<std::unique_ptr<QmiSmsReader>> &readers,
+                   Forwarder &forwarder, const nlohmann::json &frame) {
+  nlohmann::json requestId = frame.value("request_id", nlohmann::json());
+  std::string to = frame.value("to", std::string());
+  std::string text = frame.value("text", std::string());
+  std::string device = frame.value("device", std::string());
+  auto fail = [&](const char *error) {
+    SendResult result;
+    result.error = error;
+    replySendResult(forwarder, requestId, device, result);
+  };
+  if (to.empty()) {
+    fail("invalid");
+    return;
+  }
+  if (readers.empty()) {
+    fail("not_ready");
+    return;
+  }
+  QmiSmsReader *target = nullptr;
+  if (!device.empty()) {
+    for (const auto &reader : readers) {
+      if (reader->deviceId() == device) {
+        target = reader.get();
+        break;
+      }
+    }
+    if (!target) {
+      fail("no_device");
+      return;
+    }
+  } else {
+    size_t fewest = 0;
+    for (const auto &reader : readers) {
+      size_t queued = reader->sendStats().queued;
+      if (!target || queued < fewest) {
+        target = reader.get();
+        fewest = queued;
+      }
+    }
+  }
+  target->sendMessage(
+      to, text,
+      [&forwarder, requestId,
+       deviceId = target->deviceId()](SendResult result) {
+        VLOG(1) << "[" << deviceId << "] 发送"
+                << (result.success ? "成功" : "失败") << "，"
+                << result.partsSent << "/" << result.parts << " 个分段，排队 "
+                << result.queueTime.count() / 1000.0 << " ms，提交 "
+                << result.submitTime.count() / 1000.0 << " ms"
+                << (result.success ? "" : "，" + result.error);
+        replySendResult(forwarder, requestId, deviceId, result);
+      });
+}
+
 void init_logger(bool enable_debug) {
   FLAGS_logtostderr = 1;
   if (enable_debug) {
@@ -53,6 +356,64 @@ void init_logger(bool enable_debug) {
   google::InitGoogleLogging("QmiSms");
 }
 
+// 从 begin 到 end 的毫秒数，end 尚未到达时为 -1
+double elapsedMs(std::chrono::steady_clock::time_point begin,
+                 std::chrono::steady_clock::time_point end) {
+  if (end == std::chrono::steady_clock::time_point()) {
+    return -1;
+  }
+  return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+
+// WebSocket 已连接且各设备首轮读取都已结束时输出启动用时并返回 true
+bool reportTimeToReady(
+    std::chrono::steady_clock::time_point begin, const Forwarder &forwarder,
+    const std::vector<std::unique_ptr<QmiSmsReader>> &readers) {
+  auto connectedAt = forwarder.firstConnectedAt();
+  if (!connectedAt) {
+    return false;
+  }
+  auto readyAt = *connectedAt;
+  auto backlogReadAt = std::chrono::steady_clock::time_point();
+  for (const auto &reader : readers) {
+    auto backlogRead = reader->startupStats().backlogRead;
+    if (backlogRead == std::chrono::steady_clock::time_point()) {
+      return false;
+    }
+    backlogReadAt = std::max(backlogReadAt, backlogRead);
+  }
+  readyAt = std::max(readyAt, backlogReadAt);
+  auto firstDeliveredAt = std::chrono::steady_clock::time_point();
+  for (const auto &reader : readers) {
+    auto firstDelivered = reader->startupStats().firstDelivered;
+    if (firstDelivered != std::chrono::steady_clock::time_point() &&
+        (firstDeliveredAt == std::chrono::steady_clock::time_point() ||
+         firstDelivered < firstDeliveredAt)) {
+      firstDeliveredAt = firstDelivered;
+    }
+  }
+  LOG(INFO) << "启动就绪用时 " << elapsedMs(begin, readyAt)
+            << " ms（WebSocket 连接 " << elapsedMs(begin, *connectedAt)
+            << " ms，SIM 积压读取 " << elapsedMs(begin, backlogReadAt)
+            << " ms，首条短信 " << elapsedMs(begin, firstDeliveredAt)
+            << " ms）";
+  return true;
+}
+
+// 输出各设备首轮读取（清空 SIM 中的积压短信）的进度
+void reportDrainProgress(
+    const std::vector<std::unique_ptr<QmiSmsReader>> &readers) {
+  for (const auto &reader : readers) {
+    PipelineStats pipeline = reader->pipelineStats();
+    if (pipeline.cycles > 0) {
+      continue;
+    }
+    LOG(INFO) << "[" << reader->deviceId() << "] 读取 SIM 中的积压短信 "
+              << pipeline.cycleReadsDone << "/" << pipeline.cycleReads
+              << "，已投递 " << pipeline.delivered << " 条";
+  }
+}
+
 int main() {
   ix::initNetSystem();
 
@@ -72,108 +433,304 @@ int main() {
   // 初始化日志
   init_logger(appConfig.debugEnabled);
 
-  // 创建 WebSocket 对象
-  ix::WebSocket webSocket;
-  webSocket.setUrl(appConfig.wsUrl);
-
-  if (appConfig.wsUrl.find("wss://") == 0) {
-    ix::SocketTLSOptions tlsOptions;
-    tlsOptions.tls = true;
-    tlsOptions.caFile = appConfig.caCertPath;
-    webSocket.setTLSOptions(tlsOptions);
-  }
-
-  // 设置回调函数，处理连接事件、接收消息和错误
-  webSocket.setOnMessageCallback([&webSocket, &appConfig](
-                                     const ix::WebSocketMessagePtr &msg) {
-    switch (msg->type) {
-    case ix::WebSocketMessageType::Open:
-      LOG(INFO) << "[WebSocket] 连接已建立";
-      break;
-    case ix::WebSocketMessageType::Message:
-      // To-Do
-      break;
-    case ix::WebSocketMessageType::Error:
-      LOG(WARNING) << "[WebSocket] 连接错误: " << msg->errorInfo.reason;
-      // 以 json 形式打印 errorInfo
-      {
-        json errorInfoJson;
-        errorInfoJson["reason"] = msg->errorInfo.reason;
-        errorInfoJson["retries"] = msg->errorInfo.retries;
-        errorInfoJson["wait_time"] = msg->errorInfo.wait_time;
-        errorInfoJson["http_status"] = msg->errorInfo.http_status;
-        errorInfoJson["decompressionError"] = msg->errorInfo.decompressionError;
-        VLOG(1) << "errorInfo: " << errorInfoJson.dump();
+  // 打开出站日志，恢复上次未被确认的短信
+  std::unique_ptr<OutboundSpool> spool;
+  try {
+    OutboundSpool::Options spoolOptions;
+    spoolOptions.directory = appConfig.spoolDir;
+    spool = std::make_unique<OutboundSpool>(spoolOptions);
+  } catch (const std::exception &e) {
+    LOG(ERROR) << "打开出站日志失败: " << e.what();
+    return 1;
+  }
+
+  // 打开本地归档；归档只用于查询历史，打开失败时不影响转发
+  std::unique_ptr<MessageArchive> archive;
+  if (!appConfig.archiveDir.empty()) {
+    try {
+      MessageArchive::Options archiveOptions;
+      archiveOptions.directory = appConfig.archiveDir;
+      archiveOptions.maxBytes =
+          static_cast<uint64_t>(appConfig.archiveMaxMb) << 20;
+      archiveOptions.maxAge = std::chrono::hours(24 * appConfig.archiveMaxDays);
+      archive = std::make_unique<MessageArchive>(archiveOptions);
+      auto stats = archive->stats();
+      LOG(INFO) << "[归档] 已加载 " << stats.segments << " 个段，"
+                << stats.messages << " 条短信";
+    } catch (const std::exception &e) {
+      LOG(ERROR) << "打开短信归档失败: " << e.what();
+    }
+  }
+
+  // 创建转发器，服务器确认后退役出站日志中的记录
+  Forwarder::Options forwardOptions;
+  forwardOptions.url = appConfig.wsUrl;
+  forwardOptions.caCertPath = appConfig.caCertPath;
+  forwardOptions.secret = appConfig.secret;
+  forwardOptions.creditWindow = appConfig.forwardCreditWindow;
+  forwardOptions.maxBatch = static_cast<size_t>(appConfig.forwardBatchSize);
+  forwardOptions.ackTimeout = std::chrono::seconds(appConfig.ackTimeout);
+  Forwarder forwarder(forwardOptions);
+  // 不可重试的拒绝同样退役，避免无限重发
+  forwarder.setOnAcked(
+      [&spool](uint64_t id, bool /*accepted*/) { spool->retire(id); });
+  // 所有设备共享的 I/O 线程；读取器析构时仍要在其上收尾，须先于 readers
+  // 声明，后于 readers 销毁
+  IoScheduler ioScheduler(static_cast<size_t>(appConfig.ioThreads));
+  // 服务器发来的帧在连接线程上处理；设备在启动完成后加入 readers，
+  // 由 readersMutex 保护
+  std::vector<std::unique_ptr<QmiSmsReader>> readers;
+  std::mutex readersMutex;
+  // 服务器可按时间、发件人或正文前缀查询本地归档，或经某个设备发送短信
+  forwarder.setOnFrame([&](const nlohmann::json &frame) {
+    std::string action = frame.value("action", std::string());
+    if (action == "send_sms") {
+      try {
+        std::lock_guard lock(readersMutex);
+        handleSendSms(readers, forwarder, frame);
+      } catch (const nlohmann::json::exception &e) {
+        LOG(WARNING) << "[发送] 发送帧格式错误: " << e.what();
       }
-      break;
-    case ix::WebSocketMessageType::Close:
-      LOG(INFO) << "[WebSocket] 连接关闭";
-      break;
-    default:
-      break;
+      return;
+    }
+    if (action != "query_archive") {
+      VLOG(1) << "[WebSocket] 未处理的消息: " << frame.dump();
+      return;
+    }
+    if (!archive) {
+      LOG(WARNING) << "[归档] 未启用归档，忽略查询";
+      return;
+    }
+    try {
+      handleArchiveQuery(*archive, forwarder, frame);
+    } catch (const nlohmann::json::exception &e) {
+      LOG(WARNING) << "[归档] 查询帧格式错误: " << e.what();
     }
   });
 
-  // 启动 WebSocket
-  webSocket.start();
-
-  while (webSocket.getReadyState() != ix::ReadyState::Open) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  // 重发所有未确认的短信；断线期间转发器会保留它们直到重连
+  auto backlog = spool->pending();
+  if (!backlog.empty()) {
+    LOG(INFO) << "[WebSocket] 重发 " << backlog.size() << " 条未确认的短信";
+  }
+  for (const auto &[seq, sms] : backlog) {
+    forwarder.submit(seq, sms);
   }
 
-  // 初始化短信读取器
-  QmiSmsReader reader(appConfig.devicePath);
+  // 启动 WebSocket。握手在后台进行，不等待连接建立：期间读取到的短信照常
+  // 写入出站日志，并在转发队列中等待连接
+  auto startupBegin = std::chrono::steady_clock::now();
+  forwarder.start();
 
-  LOG(INFO) << "\n启动异步监听，按 Ctrl+C 停止程序...\n" << std::endl;
+  // 一批短信统一等待一次落盘，之后才转发并删除设备中的副本
+  auto flushDurable = [&](QmiSmsReader &reader, DurableBatch &batch) {
+    if (batch.messages.empty()) {
+      return;
+    }
+    // 序号单调递增，等待最大的序号即等待整批
+    uint64_t last = 0;
+    for (const auto &entry : batch.messages) {
+      last = std::max(last, entry.first);
+    }
+    bool synced = last != 0 && spool->waitDurable(last);
+    for (const auto &[seq, sms] : batch.messages) {
+      bool durable = synced && seq != 0;
+      if (!durable) {
+        LOG(ERROR) << "短信写入出站日志失败，保留设备中的副本";
+      }
+
+      forwarder.submit(durable ? seq : 0, sms);
+
+      if (archive && !archive->append(sms)) {
+        LOG(WARNING) << "[归档] 短信写入归档失败";
+      }
+
+      // 存储接近占满（清空模式）时即使配置为保留也删除，出站日志中已有副本
+      if ((appConfig.deleteAfterRead || reader.draining()) && durable) {
+        // 交给删除队列，不阻塞本批其余短信的转发
+        for (const auto &part : sms.parts) {
+          reader.deleteMessageAsync(part.slot);
+        }
+      } else if (appConfig.markReadAfterForward && durable) {
+        // 保留 SIM 中的副本，但不再出现在未读列表中；本批处理完后由读取器
+        // 一并提交
+        for (const auto &part : sms.parts) {
+          reader.markMessageRead(part.slot);
+        }
+      }
+    }
+    batch.messages.clear();
+  };
 
   // 每次监听到新短信时的回调
-  reader.startListening(std::chrono::seconds(1), [&](const CompleteSMS &sms) {
+  auto onNewSms = [&](QmiSmsReader &reader, DurableBatch &batch,
+                      const CompleteSMS &sms) {
     VLOG(1) << "-------------------------------------" << std::endl
             << "[监听到新短信]" << std::endl
+            << "设备: " << reader.devicePath() << std::endl
             << "发件人: " << sms.sender << std::endl
             << "时间戳: " << sms.timestamp << std::endl
             << "完整内容: " << sms.fullText;
     for (const auto &part : sms.parts) {
-      VLOG(1) << "  [索引 " << part.memoryIndex
+      VLOG(1) << "  [" << part.slot
               << "] 分段号: " << part.partNumber << ", 内容: " << part.text;
     }
+    VLOG(1) << "等待中的分段数: " << reader.pendingSegmentCount();
     VLOG(1) << "-------------------------------------";
 
-    // 签名
-    std::string currentTimestamp = sms.timestamp;
-    std::string sign = generateSign(currentTimestamp, appConfig.secret);
-
-    // payload
-    json msgPayload;
-    msgPayload["sender"] = sms.sender;
-    msgPayload["text"] = sms.fullText;
-    msgPayload["timestamp"] = currentTimestamp;
-    msgPayload["sign"] = sign;
-
-    // 外层 JSON
-    json wsMessage;
-    wsMessage["action"] = "send_message";
-    wsMessage["payload"] = msgPayload;
-
-    webSocket.send(wsMessage.dump());
-
-    if (appConfig.deleteAfterRead) {
-      for (const auto &part : sms.parts) {
-        reader.deleteMessage(part.memoryIndex);
-      }
+    // 先追加到出站日志；落盘在投递队列清空（或本批积满）时统一等待，
+    // 突发到达的短信共用一次组提交
+    batch.messages.emplace_back(spool->append(sms), sms);
+    if (batch.messages.size() >= kMaxDurableBatch) {
+      flushDurable(reader, batch);
     }
-  });
+  };
+  // 各设备并发打开、预热 client 并开始监听，首轮读取即清空 SIM 中的积压；
+  // 所有设备共享一组 I/O 线程与同一个转发连接
+  std::vector<std::future<std::unique_ptr<QmiSmsReader>>> starting;
+  for (const auto &device : appConfig.devices) {
+    IoContext *io = &ioScheduler.acquire();
+    starting.push_back(std::async(
+        std::launch::async,
+        [&appConfig, &onNewSms, &flushDurable, &device,
+         io]() -> std::unique_ptr<QmiSmsReader> {
+          try {
+            auto reader = std::make_unique<QmiSmsReader>(device.path, io);
+            reader->setDeviceId(device.id);
+            reader->setReadWindow(appConfig.readWindow);
+            reader->setStorages(appConfig.storages);
+            CapacityOptions capacity;
+            capacity.highWater = appConfig.storageHighWater;
+            capacity.lowWater = appConfig.storageLowWater;
+            capacity.drainPollInterval =
+                std::chrono::seconds(appConfig.drainPollInterval);
+            reader->setCapacityOptions(capacity);
+            reader->setMultipartTimeout(
+                std::chrono::seconds(appConfig.multipartTimeout),
+                appConfig.deliverPartialMultipart);
+            reader->setSeenCapacity(
+                static_cast<size_t>(appConfig.seenCapacity));
+            SendOptions send;
+            send.partsPerSecond = appConfig.sendRate;
+            send.burst = appConfig.sendBurst;
+            send.maxInFlight = appConfig.sendWindow;
+            send.maxQueued = static_cast<size_t>(appConfig.sendQueueLimit);
+            reader->setSendOptions(send);
+            QmiSmsReader *r = reader.get();
+            // 只在该设备的投递线程上访问
+            auto batch = std::make_shared<DurableBatch>();
+            r->setOnDeliveryIdle(
+                [&flushDurable, r, batch] { flushDurable(*r, *batch); });
+            r->startListening(
+                std::chrono::seconds(appConfig.pollInterval),
+                [&onNewSms, r, batch](const CompleteSMS &sms) {
+                  onNewSms(*r, *batch, sms);
+                },
+                appConfig.listenMode);
+            return reader;
+          } catch (const std::exception &e) {
+            LOG(ERROR) << "设备 " << device.path << " 初始化失败: " << e.what();
+            return nullptr;
+          }
+        }));
+  }
+  for (auto &future : starting) {
+    if (auto reader = future.get()) {
+      std::lock_guard lock(readersMutex);
+      readers.push_back(std::move(reader));
+    }
+  }
+  if (readers.empty()) {
+    forwarder.stop();
+    return 1;
+  }
 
-  // 主循环，等待退出信号
+  for (const auto &reader : readers) {
+    StartupStats startup = reader->startupStats();
+    LOG(INFO) << "[" << reader->deviceId() << "] 设备打开 "
+              << elapsedMs(startupBegin, startup.deviceOpened)
+              << " ms，client 就绪 "
+              << elapsedMs(startupBegin, startup.clientReady)
+              << " ms，开始监听 " << elapsedMs(startupBegin, startup.listening)
+              << " ms";
+  }
+  LOG(INFO) << "\n启动异步监听（" << readers.size() << " 个设备，"
+            << ioScheduler.size() << " 个 I/O 线程），按 Ctrl+C 停止程序...\n"
+            << std::endl;
+
+  // 主循环，等待退出信号；每分钟输出一次各阶段的队列深度
+  auto lastReport = std::chrono::steady_clock::now();
+  bool ready = false;
+  auto lastProgress = lastReport;
   while (g_running) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    auto now = std::chrono::steady_clock::now();
+    if (!ready) {
+      ready = reportTimeToReady(startupBegin, forwarder, readers);
+      // 积压短信边读边投递，读取期间每秒输出一次进度
+      if (!ready && now - lastProgress >= std::chrono::seconds(1)) {
+        lastProgress = now;
+        reportDrainProgress(readers);
+      }
+    }
+    if (!VLOG_IS_ON(1) || now - lastReport < std::chrono::minutes(1)) {
+      continue;
+    }
+    lastReport = now;
+    for (const auto &reader : readers) {
+      PipelineStats pipeline = reader->pipelineStats();
+      VLOG(1) << "[" << reader->deviceId() << "] 读取批次 "
+              << pipeline.fetchQueueDepth << " 待解码，短信 "
+              << pipeline.deliveryQueueDepth << " 待回调；已读取 "
+              << pipeline.cycles << " 轮，投递 " << pipeline.delivered
+              << " 条，读取推迟 " << pipeline.fetchStalls << " 次，解码等待 "
+              << pipeline.deliveryStalls << " 次";
+      WatchdogStats watchdog = reader->watchdogStats();
+      if (watchdog.recoveries > 0 || watchdog.failedRecoveries > 0) {
+        VLOG(1) << "[" << reader->deviceId() << "] 设备已重新打开 "
+                << watchdog.recoveries << " 次，失败 "
+                << watchdog.failedRecoveries << " 次，最近一次用时 "
+                << watchdog.lastRecoveryTime.count() / 1000.0 << " ms";
+      }
+      CapacityStats capacity = reader->capacityStats();
+      for (const auto &usage : capacity.storages) {
+        if (usage.capacity == 0)
+          continue;
+        VLOG(1) << "[" << reader->deviceId() << "] "
+                << smsStorageName(usage.storage) << " 存储占用 "
+                << usage.unread + usage.read << "/" << usage.capacity
+                << "（未读 " << usage.unread << "）"
+                << (capacity.draining ? "，清空模式" : "");
+      }
+      RetryPolicy::Stats retry = reader->retryStats();
+      for (size_t i = 0; i < kWmsOperationCount; ++i) {
+        if (retry.timeouts[i] == 0 && retry.giveUps[i] == 0)
+          continue;
+        VLOG(1) << "[" << reader->deviceId() << "] "
+                << wmsOperationName(static_cast<WmsOperation>(i)) << " 超时 "
+                << retry.timeouts[i] << " 次，重试 " << retry.retries[i]
+                << " 次，放弃 " << retry.giveUps[i] << " 次，当前超时 "
+                << retry.currentTimeouts[i].count() << " ms";
+      }
+      SendStats send = reader->sendStats();
+      if (send.sent > 0 || send.failed > 0 || send.queued > 0) {
+        VLOG(1) << "[" << reader->deviceId() << "] 发送排队 " << send.queued
+                << " 条，成功 " << send.sent << " 条，失败 " << send.failed
+                << " 条，已提交 " << send.partsSent << " 个分段";
+      }
+    }
+    Forwarder::Stats forward = forwarder.stats();
+    VLOG(1) << "[WebSocket] 待发送 " << forward.queued << " 条，待确认 "
+            << forward.inFlight << " 条";
   }
 
   LOG(INFO) << "\n接收到停止信号，停止监听..." << std::endl;
-  reader.stopListening();
+  for (auto &reader : readers) {
+    reader->stopListening();
+  }
 
   // 停止 WebSocket
-  webSocket.stop();
+  forwarder.stop();
   LOG(INFO) << "程序退出" << std::endl;
 
   return 0;
@@ -5,7 +5,7 @@ add_requires("yaml-cpp", {configs = {shared = false}})
 add_requires("glog", {configs = {shared = false}})
 add_requires("glib-2.0", {system = true})
 add_requires("qmi-glib", {system = true})
-add_requires("cppcodec", "nlohmann_json")
+add_requires("nlohmann_json")
 
 add_repositories("local-repo build")
 add_requires("ixwebsocket-custom", {configs = {use_tls = true, ssl = "mbedtls"}})
@@ -18,14 +18,16 @@ target("qmi_sms_reader")
     add_includedirs("src/SmsReader")
     add_files("src/SignUtils/*.cpp")
     add_includedirs("src/SignUtils")
+    add_files("src/Spool/*.cpp")
+    add_includedirs("src/Spool")
+    add_files("src/Archive/*.cpp")
+    add_includedirs("src/Archive")
+    add_files("src/Forwarder/*.cpp")
+    add_includedirs("src/Forwarder")
 
     set_languages("c++20")
 
-    add_includedirs("PDUlib/src")
-    add_defines("DESKTOP_PDU")
-    add_files("PDUlib/src/*.cpp")
-
-    add_packages("openssl", "cppcodec", "yaml-cpp", "ixwebsocket-custom", "nlohmann_json", "glog", "glib-2.0", "qmi-glib")
+    add_packages("openssl", "yaml-cpp", "ixwebsocket-custom", "nlohmann_json", "glog", "glib-2.0", "qmi-glib")
     add_links("gio-2.0", "gobject-2.0", "glib-2.0")
 
     add_ldflags("-static-libgcc", "-static-libstdc++", "-Wl,-Bstatic -lc -Wl,-Bdynamic")
@@ -50,14 +52,16 @@ target("qmi_sms_reader_musl")
     add_includedirs("src/SmsReader")
     add_files("src/SignUtils/*.cpp")
     add_includedirs("src/SignUtils")
+    add_files("src/Spool/*.cpp")
+    add_includedirs("src/Spool")
+    add_files("src/Archive/*.cpp")
+    add_includedirs("src/Archive")
+    add_files("src/Forwarder/*.cpp")
+    add_includedirs("src/Forwarder")
 
     set_languages("c++20")
 
-    add_packages("openssl", "cppcodec", "yaml-cpp", "ixwebsocket-custom", "nlohmann_json", "glog")
-
-    add_includedirs("PDUlib/src")
-    add_defines("DESKTOP_PDU")
-    add_files("PDUlib/src/*.cpp")
+    add_packages("openssl", "yaml-cpp", "ixwebsocket-custom", "nlohmann_json", "glog")
 
     add_packages("pkgconfig::glib-2.0", "pkgconfig::qmi-glib")
     add_links("gio-2.0", "gobject-2.0", "glib-2.0", "qmi-glib")
@@ -82,3 +86,77 @@ target("qmi_sms_reader_musl")
         staging_dir .. "/target-aarch64_generic_musl/usr/include/glib-2.0",
         staging_dir .. "/target-aarch64_generic_musl/usr/include/libqmi-glib",
         staging_dir .. "/target-aarch64_generic_musl/usr/include/libqrtr-glib")
+
+-- 原始读取在途窗口基准测试（模拟设备，无需 libqmi）
+target("qmi_sms_window_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/read_window_bench.cpp")
+    add_includedirs("src/SmsReader")
+    set_languages("c++20")
+
+-- 转发吞吐量与确认延迟基准测试（本地桥接服务器替身）
+target("qmi_sms_forward_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/forward_bench.cpp")
+    add_files("src/Forwarder/*.cpp")
+    add_files("src/SignUtils/*.cpp")
+    add_includedirs("bench", "src/Forwarder", "src/SignUtils", "src/SmsReader")
+    set_languages("c++20")
+    add_packages("openssl", "ixwebsocket-custom", "nlohmann_json", "glog")
+
+-- 端到端吞吐量与延迟基准测试（模拟 WMS 设备 + 本地桥接服务器替身，无需 libqmi）
+target("qmi_sms_bench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/qmi_sms_bench.cpp", "bench/SimulatedTransport.cpp")
+    add_files("src/SmsReader/*.cpp|LibqmiTransport.cpp")
+    add_files("src/Forwarder/*.cpp")
+    add_files("src/SignUtils/*.cpp")
+    add_files("src/Archive/*.cpp")
+    add_includedirs("bench", "src/SmsReader", "src/Forwarder", "src/SignUtils",
+                    "src/Archive", "src/Spool")
+    set_languages("c++20")
+    add_packages("openssl", "ixwebsocket-custom", "nlohmann_json", "glog", "glib-2.0")
+    add_links("glib-2.0")
+
+-- 出站日志重启检查（序号跨重启单调递增、未确认短信回放）
+target("qmi_sms_spool_check")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/spool_restart_check.cpp")
+    add_files("src/Spool/*.cpp")
+    add_includedirs("src/Spool", "src/SmsReader")
+    set_languages("c++20")
+
+-- 自适应超时检查（设备变慢后超时时间能重新放宽）
+target("qmi_sms_retry_check")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/retry_timeout_check.cpp", "src/SmsReader/RetryPolicy.cpp")
+    add_includedirs("src/SmsReader")
+    set_languages("c++20")
+
+-- UCS-2 解码检查（不成对的代理项替换为 U+FFFD）
+target("qmi_sms_pdu_check")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/pdu_decode_check.cpp", "src/SmsReader/PduCodec.cpp")
+    add_includedirs("bench", "src/SmsReader")
+    set_languages("c++20")
+
+-- 单条短信 CPU 路径微基准测试（解码、重组、签名、载荷构造、归档的 ns/op 与分配次数）
+target("qmi_sms_microbench")
+    set_kind("binary")
+    set_default(false)
+    add_files("bench/micro_bench.cpp")
+    add_files("src/SmsReader/PduCodec.cpp", "src/SmsReader/MultipartAssembler.cpp",
+              "src/SmsReader/SeenSet.cpp")
+    add_files("src/Forwarder/*.cpp")
+    add_files("src/SignUtils/*.cpp")
+    add_files("src/Archive/*.cpp")
+    add_includedirs("bench", "src/SmsReader", "src/Forwarder", "src/SignUtils",
+                    "src/Archive", "src/Spool")
+    set_languages("c++20")
+    add_packages("openssl", "ixwebsocket-custom", "nlohmann_json", "glog")